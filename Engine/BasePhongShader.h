@@ -1,6 +1,10 @@
 #pragma once
 #include "Colors.h"
 #include "Vec3.h"
+#include "Vec3Packet.h"
+#include "GBuffer.h"
+#include "LightClusters.h"
+#include <cmath>
 
 struct DefaultPointDiffuseParams
 {
@@ -22,6 +26,10 @@ public:
 	template<class Input>
 	Color Shade( const Input& in,const Vec3& material_color ) const
 	{
+		if( pLights )
+		{
+			return ShadeClustered( in,material_color );
+		}
 		// re-normalize interpolated surface normal
 		const auto surf_norm = in.n.GetNormalized();
 		// vertex to light data
@@ -41,6 +49,48 @@ public:
 		// add diffuse+ambient, filter by material color, saturate and scale
 		return Color( material_color.GetHadamard( d + light_ambient + s ).Saturate() * 255.0f );
 	}
+	// FloatPacket::size wide version of Shade, inputs in SoA form (one pixel per lane)
+	// same math as the scalar version, so results agree within float rounding, which
+	// can move a channel by 1 (out of 255) when it lands right on an integer boundary
+	// (whole number specular powers use repeated squaring instead of std::pow)
+	void ShadePacket( const Vec3Packet& n,const Vec3Packet& worldPos,const Vec3Packet& material_color,Color* pOut ) const
+	{
+		if( pLights )
+		{
+			ShadePacketClustered( n,worldPos,material_color,pOut );
+			return;
+		}
+		// re-normalize interpolated surface normal
+		const auto surf_norm = n.GetNormalized();
+		// vertex to light data
+		const auto v_to_l = Vec3Packet( light_pos ) - worldPos;
+		const auto dist = v_to_l.Len();
+		const auto dir = v_to_l / dist;
+		// calculate attenuation
+		const auto attenuation = FloatPacket( 1.0f ) /
+			(FloatPacket( PointDiffuse::constant_attenuation ) + dist * PointDiffuse::linear_attenuation + dist * dist * PointDiffuse::quadradic_attenuation);
+		// calculate intensity based on angle of incidence and attenuation
+		const auto d = Vec3Packet( light_diffuse ) * attenuation * max( 0.0f,surf_norm * dir );
+		// reflected light vector
+		const auto w = surf_norm * (v_to_l * surf_norm);
+		const auto r = w * 2.0f - v_to_l;
+		// calculate specular intensity based on angle between viewing vector and reflection vector, narrow with power function
+		const auto cos_rv = max( 0.0f,-r.GetNormalized() * worldPos.GetNormalized() );
+		const auto s = Vec3Packet( light_diffuse * Specular::specular_intensity ) * SpecularPow( cos_rv );
+		// add diffuse+ambient, filter by material color, saturate and scale
+		(material_color.GetHadamard( d + Vec3Packet( light_ambient ) + s ).Saturate() * 255.0f).StoreColors( pOut );
+	}
+	// lighting pass of deferred shading, same math as Shade / ShadePacket on what the
+	// geometry pass stored, so a pixel comes out the same whether it was shaded deferred or not
+	Color Light( const GBufferTexel& in ) const
+	{
+		return Shade( in,in.material );
+	}
+	void Light( const GBufferTexel* in,Color* out ) const
+	{
+		ShadePacket( Vec3Packet::Gather( in,&GBufferTexel::n ),Vec3Packet::Gather( in,&GBufferTexel::worldPos ),
+			Vec3Packet::Gather( in,&GBufferTexel::material ),out );
+	}
 	void SetDiffuseLight( const Vec3& c )
 	{
 		light_diffuse = c;
@@ -53,8 +103,183 @@ public:
 	{
 		light_pos = pos_in;
 	}
+	// shade with the point lights of a light list instead of the single light (ambient still
+	// applies), each pixel looping only over the lights listed for its cluster
+	// the list is read while shading, it has to stay alive and unchanged until the frame is done
+	// (for deferred shading that's after Graphics::EndFrame)
+	void BindLights( const LightClusters& lights )
+	{
+		pLights = &lights;
+	}
+	// back to the single light
+	void UnbindLights()
+	{
+		pLights = nullptr;
+	}
+	// lights a pixel at in.worldPos is shaded with (for pipeline statistics)
+	template<class Input>
+	size_t LightCount( const Input& in ) const
+	{
+		return pLights ? pLights->GetLights( in.worldPos ).size() : 1u;
+	}
+	// lights each lane of a packet of FloatPacket::size inputs is shaded with by ShadePacket,
+	// which runs every lane through the merged list of all the lanes' clusters
+	template<class Input>
+	size_t PacketLightCount( const Input* in ) const
+	{
+		if( !pLights )
+		{
+			return 1u;
+		}
+		size_t count = 0;
+		ForEachPacketLight( Vec3Packet::Gather( in,&Input::worldPos ),[&count]( const PointLight& )
+		{
+			count++;
+		} );
+		return count;
+	}
+	// distance at which a light of color c has faded below cutoff (the default is
+	// 1 step out of 255, so nothing visible is lost by ignoring the light beyond it)
+	// clustered lights are faded out to exactly zero by there
+	static float LightRadius( const Vec3& c,float cutoff = 1.0f / 256.0f )
+	{
+		// solve constant + linear * d + quadratic * d^2 == brightest channel / cutoff
+		const float k = PointDiffuse::constant_attenuation - std::max( { c.x,c.y,c.z } ) / cutoff;
+		if constexpr( PointDiffuse::quadradic_attenuation > 0.0f )
+		{
+			constexpr float a = PointDiffuse::quadradic_attenuation;
+			constexpr float b = PointDiffuse::linear_attenuation;
+			return std::max( (-b + std::sqrt( b * b - 4.0f * a * k )) / (2.0f * a),0.0f );
+		}
+		else
+		{
+			static_assert( PointDiffuse::linear_attenuation > 0.0f,"lights need some falloff to have a radius" );
+			return std::max( -k / PointDiffuse::linear_attenuation,0.0f );
+		}
+	}
+private:
+	// multiple light version of Shade
+	// unlike the single light, the specular term is attenuated as well, and the attenuation
+	// is windowed to reach zero at the light's radius, so leaving out lights beyond it
+	// (as cluster culling does) never changes the result
+	template<class Input>
+	Color ShadeClustered( const Input& in,const Vec3& material_color ) const
+	{
+		const auto surf_norm = in.n.GetNormalized();
+		const auto view_dir = in.worldPos.GetNormalized();
+		Vec3 lit = light_ambient;
+		for( const auto i : pLights->GetLights( in.worldPos ) )
+		{
+			const PointLight& l = pLights->GetLight( i );
+			// vertex to light data
+			const auto v_to_l = l.pos - in.worldPos;
+			const auto dist = v_to_l.Len();
+			const auto dir = v_to_l / dist;
+			const auto attenuation = Window( dist / l.radius ) /
+				(PointDiffuse::constant_attenuation + PointDiffuse::linear_attenuation * dist + PointDiffuse::quadradic_attenuation * sq( dist ));
+			// diffuse and specular (see Shade)
+			const auto d = std::max( 0.0f,surf_norm * dir );
+			const auto w = surf_norm * (v_to_l * surf_norm);
+			const auto r = w * 2.0f - v_to_l;
+			const auto s = Specular::specular_intensity * std::pow( std::max( 0.0f,-r.GetNormalized() * view_dir ),Specular::specular_power );
+			lit += l.color * (attenuation * (d + s));
+		}
+		return Color( material_color.GetHadamard( lit ).Saturate() * 255.0f );
+	}
+	// multiple light version of ShadePacket
+	// the lanes can be in different clusters, the packet loops over the lights of all of
+	// them (each once), which is safe since a light contributes nothing where it doesn't reach
+	void ShadePacketClustered( const Vec3Packet& n,const Vec3Packet& worldPos,const Vec3Packet& material_color,Color* pOut ) const
+	{
+		const auto surf_norm = n.GetNormalized();
+		const auto view_dir = worldPos.GetNormalized();
+		Vec3Packet lit = Vec3Packet( light_ambient );
+		ForEachPacketLight( worldPos,[&]( const PointLight& l )
+		{
+			// vertex to light data
+			const auto v_to_l = Vec3Packet( l.pos ) - worldPos;
+			const auto dist = v_to_l.Len();
+			const auto dir = v_to_l / dist;
+			const auto attenuation = Window( dist * (1.0f / l.radius) ) /
+				(FloatPacket( PointDiffuse::constant_attenuation ) + dist * PointDiffuse::linear_attenuation + dist * dist * PointDiffuse::quadradic_attenuation);
+			// diffuse and specular (see Shade)
+			const auto d = max( 0.0f,surf_norm * dir );
+			const auto w = surf_norm * (v_to_l * surf_norm);
+			const auto r = w * 2.0f - v_to_l;
+			const auto s = SpecularPow( max( 0.0f,-r.GetNormalized() * view_dir ) ) * Specular::specular_intensity;
+			lit += Vec3Packet( l.color ) * (attenuation * (d + s));
+		} );
+		(material_color.GetHadamard( lit ).Saturate() * 255.0f).StoreColors( pOut );
+	}
+	// calls f( light ) for every light in the clusters of the packet's lanes, once each
+	// (cluster lists are sorted, so this is a merge of up to FloatPacket::size lists)
+	template<class F>
+	void ForEachPacketLight( const Vec3Packet& worldPos,F&& f ) const
+	{
+		std::span<const unsigned int> lists[FloatPacket::size];
+		int nLists = 0;
+		int clusters[FloatPacket::size];
+		for( int i = 0; i < FloatPacket::size; i++ )
+		{
+			const int c = pLights->GetCluster( { worldPos.x[i],worldPos.y[i],worldPos.z[i] } );
+			if( std::find( clusters,clusters + nLists,c ) == clusters + nLists )
+			{
+				clusters[nLists] = c;
+				lists[nLists++] = pLights->GetClusterLights( c );
+			}
+		}
+		size_t cursors[FloatPacket::size] = {};
+		while( true )
+		{
+			unsigned int next = ~0u;
+			for( int i = 0; i < nLists; i++ )
+			{
+				if( cursors[i] < lists[i].size() )
+				{
+					next = std::min( next,lists[i][cursors[i]] );
+				}
+			}
+			if( next == ~0u )
+			{
+				return;
+			}
+			f( pLights->GetLight( next ) );
+			for( int i = 0; i < nLists; i++ )
+			{
+				if( cursors[i] < lists[i].size() && lists[i][cursors[i]] == next )
+				{
+					cursors[i]++;
+				}
+			}
+		}
+	}
+	// fades attenuation out towards the light's radius, t is distance / radius
+	// (1 at the light, 0 from the radius on, smooth at both ends)
+	static float Window( float t )
+	{
+		return sq( std::max( 1.0f - sq( sq( t ) ),0.0f ) );
+	}
+	static FloatPacket Window( const FloatPacket& t )
+	{
+		const auto t2 = t * t;
+		const auto fade = max( FloatPacket( 1.0f ) - t2 * t2,0.0f );
+		return fade * fade;
+	}
+	static FloatPacket SpecularPow( const FloatPacket& x )
+	{
+		if constexpr( Specular::specular_power >= 0.0f &&
+			Specular::specular_power == float( static_cast<unsigned int>( Specular::specular_power ) ) )
+		{
+			return pow( x,static_cast<unsigned int>( Specular::specular_power ) );
+		}
+		else
+		{
+			return pow( x,Specular::specular_power );
+		}
+	}
 private:
 	Vec3 light_pos = { 0.0f,0.0f,0.5f };
 	Vec3 light_diffuse = { 1.0f,1.0f,1.0f };
 	Vec3 light_ambient = { 0.1f,0.1f,0.1f };
+	const LightClusters* pLights = nullptr;
 };
\ No newline at end of file
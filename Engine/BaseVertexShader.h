@@ -20,6 +20,10 @@ public:
 	{
 		return proj;
 	}
+	const Mat4& GetWorldViewProj() const
+	{
+		return worldViewProj;
+	}
 protected:
 	Mat4 proj = Mat4::Identity();
 	Mat4 worldView = Mat4::Identity();
@@ -0,0 +1,1417 @@
+/******************************************************************************************
+*	Chili DirectX Framework Version 16.10.01											  *
+*	Benchmark.cpp																		  *
+*	Copyright 2016 PlanetChili <http://www.planetchili.net>								  *
+*																						  *
+*	This file is part of The Chili DirectX Framework.									  *
+*																						  *
+*	The Chili DirectX Framework is free software: you can redistribute it and/or modify	  *
+*	it under the terms of the GNU General Public License as published by				  *
+*	the Free Software Foundation, either version 3 of the License, or					  *
+*	(at your option) any later version.													  *
+*																						  *
+*	The Chili DirectX Framework is distributed in the hope that it will be useful,		  *
+*	but WITHOUT ANY WARRANTY; without even the implied warranty of						  *
+*	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the						  *
+*	GNU General Public License for more details.										  *
+*																						  *
+*	You should have received a copy of the GNU General Public License					  *
+*	along with The Chili DirectX Framework.  If not, see <http://www.gnu.org/licenses/>.  *
+******************************************************************************************/
+// headless throughput benchmark: runs each scene for a fixed number of frames with a
+// fixed dt and a scripted camera, then reports frame time stats and triangle / pixel
+// throughput as json
+//
+// this is the entry point of headless builds (instead of Main.cpp / Game.cpp / MainWindow.cpp), e.g.
+//   g++ -std=c++20 -O2 -pthread -DCHILI_HEADLESS Benchmark.cpp GraphicsHeadless.cpp Surface.cpp
+//     SurfaceHeadless.cpp FrameTimer.cpp Keyboard.cpp Mouse.cpp tiny_obj_loader.cpp MappedFile.cpp
+//     ObjReader.cpp -o benchmark
+// run it from the Engine directory so the scenes find Images/ and models/
+//
+// usage: benchmark [--frames n] [--warmup n] [--scene name] [--out file.json]
+//                  [--ppm prefix | --raw file]
+//
+// with --load-obj (repeatable) and/or --synthetic-tris it instead times obj parsing,
+// tinyobj against ObjReader (neither going through the mesh cache), e.g.
+//   benchmark --load-obj models/bunny.obj --load-obj models/suzanne.obj --synthetic-tris 10000000
+// the synthetic model is a height field grid written to the temp directory and deleted after
+// it also reports the vertex cache miss ratio (acmr) before and after IndexedTriangleList::Optimize
+//
+// with --floor-texture (repeatable) and/or --synthetic-texture it instead times trilinear
+// sampling of a floor seen at a grazing angle (eye height, fov and texture scale of the
+// SpecularPhongPointScene floor, turned 30 degrees so the texture runs diagonally on screen),
+// once with each TexelLayout, e.g.
+//   benchmark --floor-texture Images/floor.png --synthetic-texture 2048
+// cache misses come from a model of a 32 kB 8 way l1 fed with the texel addresses of the walk,
+// and from the hardware l1d miss counter where the os lets us read it (-1 otherwise)
+//
+// with --raster-coverage it instead draws a triangulated square from that many random views
+// with each rasterizer, serial and tiled, and fails unless every pixel of it was covered by
+// exactly one triangle (the fill rule at work on shared edges), e.g.
+//   benchmark --raster-coverage 200
+// (it counts overlaps with the pipeline statistics, so it refuses to run when those are compiled out)
+//
+// with --vertex-cache (repeatable) it instead draws the model with lazy vertex shading, with
+// each PostTransformCache policy at a few sizes, in the obj's own triangle order and optimized,
+// and reports the cache's hit rate and vs invocations saved next to the optimizer's acmr for
+// the triangles left after culling, which are all the cache gets to see (it fails if a fifo
+// cache doesn't miss exactly as often as that acmr says), e.g.
+//   benchmark --vertex-cache models/suzanne.obj --vertex-cache models/bunny.obj
+//
+// with --occlusion it instead draws a room of three walls with spheres inside and outside it
+// from that many random views, once with occlusion culling and once without, serial and tiled,
+// and fails unless the frames match and culling skipped some of the spheres, e.g.
+//   benchmark --occlusion 200
+#ifdef CHILI_HEADLESS
+#include "Graphics.h"
+#include "FrameSink.h"
+#include "FrameTimer.h"
+#include "ScriptedInput.h"
+#include "SpecularPhongPointScene.h"
+#include "ClusteredLightsScene.h"
+#include "VertexWaveScene.h"
+#include "CubeSkinScene.h"
+#include "SolidEffect.h"
+#include "Plane.h"
+#include "Sphere.h"
+#include <algorithm>
+#include <functional>
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <thread>
+#include <random>
+#include <array>
+#include <cstdint>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include <cstring>
+#endif
+
+namespace
+{
+	struct SceneEntry
+	{
+		const char* name;
+		std::function<std::unique_ptr<Scene>( Graphics& )> make;
+	};
+
+	// scenes that can be benchmarked (same set that Game cycles through, plus SpecularPhongPointScene
+	// with its depth prepass switched on), all on one thread pool like in Game
+	std::vector<SceneEntry> MakeSceneList( std::shared_ptr<ThreadPool> pPool )
+	{
+		return {
+			{ "SpecularPhongPointScene",[pPool]( Graphics& gfx ) { return std::make_unique<SpecularPhongPointScene>( gfx,pPool ); } },
+			{ "SpecularPhongPointSceneDepthPrepass",[pPool]( Graphics& gfx )
+				{
+					auto pScene = std::make_unique<SpecularPhongPointScene>( gfx,pPool );
+					pScene->SetDepthPrepass( true );
+					return pScene;
+				} },
+			{ "ClusteredLightsScene",[pPool]( Graphics& gfx ) { return std::make_unique<ClusteredLightsScene>( gfx,pPool ); } },
+			{ "VertexWaveScene",[]( Graphics& gfx ) { return std::make_unique<VertexWaveScene>( gfx ); } },
+			{ "CubeSkinScene",[]( Graphics& gfx ) { return std::make_unique<CubeSkinScene>( gfx,L"Images\\dice_skin.png" ); } }
+		};
+	}
+
+	struct Options
+	{
+		int frames = 600;
+		int warmup = 60;
+		std::string scene;
+		std::string out;
+		std::string ppmPrefix;
+		std::string rawFile;
+		std::vector<std::string> objFiles;
+		size_t syntheticTris = 0;
+		int loadRuns = 3;
+		std::vector<std::string> textureFiles;
+		unsigned int syntheticTexture = 0;
+		int textureRuns = 5;
+		int coverageViews = 0;
+		std::vector<std::string> vertexCacheFiles;
+		int occlusionViews = 0;
+	};
+
+	struct Result
+	{
+		std::string name;
+		int frames;
+		double meanMs;
+		double medianMs;
+		double p99Ms;
+		double minMs;
+		double maxMs;
+		double seconds;
+		PipelineStats work;
+	};
+
+	struct LoadResult
+	{
+		std::string file;
+		size_t bytes;
+		size_t vertices;
+		size_t triangles;
+		// best of the runs
+		double tinyObjMs;
+		double objReaderMs;
+		// both loaders produced the same vertices and indices
+		bool identical;
+		// IndexedTriangleList::Optimize with default options on the loaded mesh
+		double optimizeMs;
+		MeshOptimizer::Report acmr;
+	};
+
+	// what Load fills for a positions-only vertex type
+	struct LoadVertex
+	{
+		LoadVertex() = default;
+		LoadVertex( const Vec3& pos )
+			:
+			pos( pos )
+		{}
+		Vec3 pos;
+	};
+
+	// writes a (cols x rows) quad grid height field with per-vertex normals,
+	// as close to nTris triangles as the grid allows
+	void WriteSyntheticObj( const std::string& path,size_t nTris )
+	{
+		const size_t cols = std::max( size_t( std::ceil( std::sqrt( double( nTris ) / 2.0 ) ) ),size_t( 1 ) );
+		const size_t rows = std::max( (nTris + 2u * cols - 1u) / (2u * cols),size_t( 1 ) );
+		std::FILE* pFile = std::fopen( path.c_str(),"wb" );
+		if( pFile == nullptr )
+		{
+			throw std::runtime_error( "could not create " + path );
+		}
+		std::fprintf( pFile,"# synthetic height field %zu x %zu\n",cols,rows );
+		for( size_t y = 0; y <= rows; y++ )
+		{
+			for( size_t x = 0; x <= cols; x++ )
+			{
+				const double fx = double( x ) / double( cols );
+				const double fy = double( y ) / double( rows );
+				std::fprintf( pFile,"v %.6f %.6f %.6f\n",fx,0.05 * std::sin( fx * 40.0 ) * std::cos( fy * 40.0 ),fy );
+			}
+		}
+		for( size_t y = 0; y <= rows; y++ )
+		{
+			for( size_t x = 0; x <= cols; x++ )
+			{
+				const double fx = double( x ) / double( cols );
+				const double fy = double( y ) / double( rows );
+				const double dx = 2.0 * std::cos( fx * 40.0 ) * std::cos( fy * 40.0 );
+				const double dz = -2.0 * std::sin( fx * 40.0 ) * std::sin( fy * 40.0 );
+				const double len = std::sqrt( dx * dx + 1.0 + dz * dz );
+				std::fprintf( pFile,"vn %.6f %.6f %.6f\n",-dx / len,1.0 / len,-dz / len );
+			}
+		}
+		size_t written = 0;
+		for( size_t y = 0; y < rows && written < nTris; y++ )
+		{
+			for( size_t x = 0; x < cols && written < nTris; x++ )
+			{
+				// obj indices are 1-based
+				const size_t i0 = y * (cols + 1u) + x + 1u;
+				const size_t i1 = i0 + 1u;
+				const size_t i2 = i0 + cols + 1u;
+				const size_t i3 = i2 + 1u;
+				std::fprintf( pFile,"f %zu//%zu %zu//%zu %zu//%zu\n",i0,i0,i2,i2,i1,i1 );
+				if( ++written < nTris )
+				{
+					std::fprintf( pFile,"f %zu//%zu %zu//%zu %zu//%zu\n",i1,i1,i2,i2,i3,i3 );
+					written++;
+				}
+			}
+		}
+		const bool ok = std::ferror( pFile ) == 0;
+		if( std::fclose( pFile ) != 0 || !ok )
+		{
+			throw std::runtime_error( "could not write " + path );
+		}
+	}
+
+	LoadResult RunLoad( const std::string& file,int nRuns )
+	{
+		using List = IndexedTriangleList<LoadVertex>;
+		LoadResult r;
+		r.file = file;
+		r.bytes = size_t( std::filesystem::file_size( file ) );
+		r.tinyObjMs = 1e30;
+		r.objReaderMs = 1e30;
+		List tinyObj;
+		List objReader;
+		FrameTimer ft;
+		for( int i = 0; i < nRuns; i++ )
+		{
+			bool isCCW;
+			// drop the previous result first so both loaders start with the same free memory
+			tinyObj = List{};
+			ft.Mark();
+			tinyObj = List::ParseObj( file,isCCW );
+			r.tinyObjMs = std::min( r.tinyObjMs,double( ft.Mark() ) * 1000.0 );
+			objReader = List{};
+			ft.Mark();
+			objReader = List::ReadObj( file,isCCW );
+			r.objReaderMs = std::min( r.objReaderMs,double( ft.Mark() ) * 1000.0 );
+		}
+		r.vertices = objReader.vertices.size();
+		r.triangles = objReader.indices.size() / 3u;
+		r.identical = tinyObj.vertices.size() == objReader.vertices.size() &&
+			tinyObj.indices.size() == objReader.indices.size();
+		for( size_t i = 0; r.identical && i < objReader.vertices.size(); i++ )
+		{
+			r.identical = tinyObj.vertices[i].pos == objReader.vertices[i].pos;
+		}
+		for( size_t i = 0; r.identical && i < objReader.indices.size(); i++ )
+		{
+			r.identical = tinyObj.indices[i] == objReader.indices[i];
+		}
+		ft.Mark();
+		r.acmr = objReader.Optimize();
+		r.optimizeMs = double( ft.Mark() ) * 1000.0;
+		return r;
+	}
+
+	void WriteLoadJson( std::ostream& os,const std::vector<LoadResult>& results )
+	{
+		os << "{\n";
+		os << "  \"threads\": " << std::max( std::thread::hardware_concurrency(),1u ) << ",\n";
+		os << "  \"obj_loads\": [";
+		for( size_t i = 0; i < results.size(); i++ )
+		{
+			const auto& r = results[i];
+			os << (i == 0 ? "\n" : ",\n");
+			os << "    {\n";
+			os << "      \"file\": \"" << r.file << "\",\n";
+			os << "      \"bytes\": " << r.bytes << ",\n";
+			os << "      \"vertices\": " << r.vertices << ",\n";
+			os << "      \"triangles\": " << r.triangles << ",\n";
+			os << "      \"tinyobj_ms\": " << r.tinyObjMs << ",\n";
+			os << "      \"objreader_ms\": " << r.objReaderMs << ",\n";
+			os << "      \"speedup\": " << r.tinyObjMs / r.objReaderMs << ",\n";
+			os << "      \"identical\": " << (r.identical ? "true" : "false") << ",\n";
+			os << "      \"optimize_ms\": " << r.optimizeMs << ",\n";
+			os << "      \"acmr\": { \"before\": " << r.acmr.acmrBefore << ", \"after\": " << r.acmr.acmrAfter << " }\n";
+			os << "    }";
+		}
+		os << "\n  ]\n}\n";
+	}
+
+	// l1 data cache model, set associative with lru replacement
+	class CacheModel
+	{
+	public:
+		void Access( uintptr_t address )
+		{
+			const uintptr_t line = address / lineSize;
+			auto& set = sets[line % nSets];
+			accesses++;
+			const auto it = std::find( set.begin(),set.end(),line );
+			if( it == set.end() )
+			{
+				misses++;
+				std::rotate( set.begin(),set.end() - 1,set.end() );
+				set.front() = line;
+			}
+			else
+			{
+				// move to the front (most recently used)
+				std::rotate( set.begin(),it,it + 1 );
+			}
+		}
+	public:
+		size_t accesses = 0;
+		size_t misses = 0;
+	private:
+		static constexpr size_t lineSize = 64;
+		static constexpr size_t nWays = 8;
+		static constexpr size_t nSets = 32 * 1024 / (lineSize * nWays);
+		std::array<std::array<uintptr_t,nWays>,nSets> sets = {};
+	};
+
+	// hardware l1d read misses of this thread between Start and Stop, -1 if not available
+	class L1dMissCounter
+	{
+	public:
+		L1dMissCounter()
+		{
+#ifdef __linux__
+			perf_event_attr attr;
+			std::memset( &attr,0,sizeof( attr ) );
+			attr.size = sizeof( attr );
+			attr.type = PERF_TYPE_HW_CACHE;
+			attr.config = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+			attr.disabled = 1;
+			attr.exclude_kernel = 1;
+			attr.exclude_hv = 1;
+			fd = int( syscall( __NR_perf_event_open,&attr,0,-1,-1,0 ) );
+#endif
+		}
+		~L1dMissCounter()
+		{
+#ifdef __linux__
+			if( fd >= 0 )
+			{
+				close( fd );
+			}
+#endif
+		}
+		L1dMissCounter( const L1dMissCounter& ) = delete;
+		L1dMissCounter& operator=( const L1dMissCounter& ) = delete;
+		void Start()
+		{
+#ifdef __linux__
+			if( fd >= 0 )
+			{
+				ioctl( fd,PERF_EVENT_IOC_RESET,0 );
+				ioctl( fd,PERF_EVENT_IOC_ENABLE,0 );
+			}
+#endif
+		}
+		long long Stop()
+		{
+#ifdef __linux__
+			long long count = 0;
+			if( fd >= 0 )
+			{
+				ioctl( fd,PERF_EVENT_IOC_DISABLE,0 );
+				if( read( fd,&count,sizeof( count ) ) == sizeof( count ) )
+				{
+					return count;
+				}
+			}
+#endif
+			return -1;
+		}
+	private:
+		int fd = -1;
+	};
+
+	struct LayoutResult
+	{
+		// best of the runs
+		double ms;
+		CacheModel model;
+		// of the best run
+		long long hwMisses;
+	};
+
+	struct TextureWalkResult
+	{
+		std::string texture;
+		unsigned int width;
+		unsigned int height;
+		size_t samples;
+		LayoutResult linear;
+		LayoutResult tiled;
+	};
+
+	// texture coordinates of the 2x2 quads of a frame that show the floor, as in the
+	// SpecularPhongPointScene: eye 0.875 above it, 85 degree hfov, one repeat per 0.65 units
+	// looking level (the floor meets the horizon) and turned 30 degrees
+	// quads reaching the horizon or past the far plane are left out
+	std::vector<std::array<Vec2,4>> MakeGrazingFloorQuads()
+	{
+		constexpr float eyeHeight = 0.875f;
+		constexpr float tScale = 0.65f;
+		constexpr float farZ = 6.0f;
+		const float tanHalfH = std::tan( to_rad( 85.0f ) / 2.0f );
+		const float tanHalfV = tanHalfH * float( Graphics::ScreenHeight ) / float( Graphics::ScreenWidth );
+		const float yawSin = std::sin( to_rad( 30.0f ) );
+		const float yawCos = std::cos( to_rad( 30.0f ) );
+		std::vector<std::array<Vec2,4>> quads;
+		for( unsigned int y = 0; y + 1u < Graphics::ScreenHeight; y += 2u )
+		{
+			for( unsigned int x = 0; x + 1u < Graphics::ScreenWidth; x += 2u )
+			{
+				std::array<Vec2,4> quad;
+				bool onFloor = true;
+				for( unsigned int lane = 0; lane < 4u && onFloor; lane++ )
+				{
+					const float px = float( x + (lane & 1u) ) + 0.5f;
+					const float py = float( y + (lane >> 1u) ) + 0.5f;
+					const float dirX = (2.0f * px / float( Graphics::ScreenWidth ) - 1.0f) * tanHalfH;
+					const float dirY = (1.0f - 2.0f * py / float( Graphics::ScreenHeight )) * tanHalfV;
+					// distance along the view axis to where the ray meets the floor
+					const float z = dirY < 0.0f ? eyeHeight / -dirY : farZ;
+					onFloor = z < farZ;
+					const float hitX = dirX * z;
+					quad[lane] = Vec2{ hitX * yawCos - z * yawSin,hitX * yawSin + z * yawCos } / tScale;
+				}
+				if( onFloor )
+				{
+					quads.push_back( quad );
+				}
+			}
+		}
+		return quads;
+	}
+
+	// feeds the texel addresses a wrapping trilinear Sampler reads for the walk to the cache model
+	void ModelTexelFetches( const MipTexture& tex,const std::vector<std::array<Vec2,4>>& quads,CacheModel& model )
+	{
+		const auto Wrap = []( int i,int size )
+		{
+			const int m = i % size;
+			return m < 0 ? m + size : m;
+		};
+		const auto FetchBilinear = [&]( const MipTexture::Level& level,const Vec2& tc )
+		{
+			const int w = int( level.GetWidth() );
+			const int h = int( level.GetHeight() );
+			const int x = int( std::floor( tc.x * float( w ) - 0.5f ) );
+			const int y = int( std::floor( tc.y * float( h ) - 0.5f ) );
+			for( int dy = 0; dy < 2; dy++ )
+			{
+				for( int dx = 0; dx < 2; dx++ )
+				{
+					const size_t offset = level.Offset( unsigned( Wrap( x + dx,w ) ),unsigned( Wrap( y + dy,h ) ) );
+					model.Access( uintptr_t( level.GetTexels() + offset ) );
+				}
+			}
+		};
+		for( const auto& q : quads )
+		{
+			const float lod = tex.ComputeLod( q[1] - q[0],q[2] - q[0] );
+			const size_t level = size_t( lod );
+			const bool blend = (unsigned int)((lod - float( level )) * 256.0f) != 0u && level + 1u < tex.GetLevelCount();
+			for( const auto& tc : q )
+			{
+				FetchBilinear( tex.GetLevel( level ),tc );
+				if( blend )
+				{
+					FetchBilinear( tex.GetLevel( level + 1u ),tc );
+				}
+			}
+		}
+	}
+
+	LayoutResult RunTextureWalk( const MipTexture& tex,const std::vector<std::array<Vec2,4>>& quads,int nRuns )
+	{
+		const Sampler<TextureAddress::Wrap,TextureFilter::Trilinear> sampler( tex );
+		LayoutResult r;
+		r.ms = 1e30;
+		r.hwMisses = -1;
+		L1dMissCounter counter;
+		FrameTimer ft;
+		// summed so the samples can't be optimized out
+		volatile float sink = 0.0f;
+		for( int i = 0; i < nRuns; i++ )
+		{
+			float sum = 0.0f;
+			counter.Start();
+			ft.Mark();
+			for( const auto& q : quads )
+			{
+				const float lod = sampler.ComputeLod( q[1] - q[0],q[2] - q[0] );
+				Vec3 colors[4];
+				sampler.Sample( q.data(),lod,colors );
+				for( const auto& c : colors )
+				{
+					sum += c.x;
+				}
+			}
+			const double ms = double( ft.Mark() ) * 1000.0;
+			const long long misses = counter.Stop();
+			sink = sink + sum;
+			if( ms < r.ms )
+			{
+				r.ms = ms;
+				r.hwMisses = misses;
+			}
+		}
+		ModelTexelFetches( tex,quads,r.model );
+		return r;
+	}
+
+	TextureWalkResult RunTextureWalks( const std::string& name,const Surface& texture,int nRuns )
+	{
+		const auto quads = MakeGrazingFloorQuads();
+		TextureWalkResult r;
+		r.texture = name;
+		r.width = texture.GetWidth();
+		r.height = texture.GetHeight();
+		r.samples = quads.size() * 4u;
+		const auto Build = [&texture]( TexelLayout layout )
+		{
+			Surface copy( texture.GetWidth(),texture.GetHeight() );
+			copy.Copy( texture );
+			return MipTexture( std::move( copy ),layout );
+		};
+		{
+			const MipTexture tex = Build( TexelLayout::Linear );
+			r.linear = RunTextureWalk( tex,quads,nRuns );
+		}
+		{
+			const MipTexture tex = Build( TexelLayout::Tiled );
+			r.tiled = RunTextureWalk( tex,quads,nRuns );
+		}
+		return r;
+	}
+
+	// n x n random texels, so nothing about it is cache friendly by itself
+	Surface MakeNoiseTexture( unsigned int n )
+	{
+		Surface s( n,n );
+		std::mt19937 rng( 1 );
+		for( unsigned int y = 0; y < n; y++ )
+		{
+			for( unsigned int x = 0; x < n; x++ )
+			{
+				s.PutPixel( x,y,Color( (unsigned int)rng() & 0xFFFFFFu ) );
+			}
+		}
+		return s;
+	}
+
+	void WriteTextureJson( std::ostream& os,const std::vector<TextureWalkResult>& results )
+	{
+		const auto WriteLayout = [&os]( const char* name,const LayoutResult& r,bool last )
+		{
+			os << "      \"" << name << "\": { \"ms\": " << r.ms << ", \"model_accesses\": " << r.model.accesses
+				<< ", \"model_misses\": " << r.model.misses << ", \"model_miss_rate\": "
+				<< double( r.model.misses ) / double( std::max( r.model.accesses,size_t( 1 ) ) )
+				<< ", \"hw_l1d_misses\": " << r.hwMisses << " }" << (last ? "\n" : ",\n");
+		};
+		os << "{\n";
+		os << "  \"texture_walks\": [";
+		for( size_t i = 0; i < results.size(); i++ )
+		{
+			const auto& r = results[i];
+			os << (i == 0 ? "\n" : ",\n");
+			os << "    {\n";
+			os << "      \"texture\": \"" << r.texture << "\",\n";
+			os << "      \"width\": " << r.width << ",\n";
+			os << "      \"height\": " << r.height << ",\n";
+			os << "      \"samples\": " << r.samples << ",\n";
+			WriteLayout( "linear",r.linear,false );
+			WriteLayout( "tiled",r.tiled,false );
+			os << "      \"speedup\": " << r.linear.ms / r.tiled.ms << "\n";
+			os << "    }";
+		}
+		os << "\n  ]\n}\n";
+	}
+
+	typedef Pipeline<SolidEffect> SolidPipeline;
+
+	struct CoverageResult
+	{
+		std::string rasterizer;
+		bool tiled;
+		int views;
+		// distinct pixels covered over all views
+		size_t pixels;
+		// pixels covered more than once (pixels_covered counts beyond the distinct ones)
+		size_t overlaps;
+		// uncovered pixels between covered ones on a row (the square covers each row in one
+		// span, so any of these is a crack between triangles)
+		size_t gaps;
+		// views where the square folded over (see RunCoverage), not counted
+		int skipped;
+	};
+
+	// draws a watertight mesh, a square triangulated on a jittered grid so that its edges run in
+	// all directions, from nViews random views and checks that every pixel of it is covered by
+	// exactly one triangle
+	// (a flat mesh, where a closed solid folds over at its silhouette and snapping to the subpixel
+	//  grid can make front facing triangles there overlap; views keep the square in front of the
+	//  near plane, near clipping makes new vertices that neighboring triangles don't share)
+	CoverageResult RunCoverage( Graphics& gfx,SolidPipeline::Rasterizer rasterizer,bool tiled,int nViews )
+	{
+		auto pZb = std::make_shared<ZBuffer>( gfx.ScreenWidth,gfx.ScreenHeight );
+		SolidPipeline pipeline( gfx,pZb );
+		pipeline.SetRasterizer( rasterizer );
+		if( tiled )
+		{
+			pipeline.SetThreadPool( std::make_shared<ThreadPool>() );
+		}
+		std::mt19937 rng( 1337 );
+		std::uniform_real_distribution<float> unit( 0.0f,1.0f );
+		constexpr int divisions = 16;
+		auto square = Plane::GetPlain<SolidEffect::Vertex>( divisions,divisions );
+		for( int y = 1; y < divisions; y++ )
+		{
+			for( int x = 1; x < divisions; x++ )
+			{
+				square.vertices[y * (divisions + 1) + x].pos += Vec3{ unit( rng ) - 0.5f,unit( rng ) - 0.5f,0.0f } * (0.4f / float( divisions ));
+			}
+		}
+		square.ComputeBounds();
+		pipeline.effect.vs.BindProjection( Mat4::ProjectionHFOV( 90.0f,1.33333f,0.5f,40.0f ) );
+
+		CoverageResult r = { rasterizer == SolidPipeline::Rasterizer::Scanline ? "scanline" : "half_space",tiled,nViews,0,0,0,0 };
+		for( int i = 0; i < nViews; i++ )
+		{
+			// facing the eye at up to 45 degrees, from a few pixels a cell to filling the screen,
+			// some hanging off its edges
+			const float z = 1.5f + 8.0f * unit( rng );
+			const float scale = z * (0.3f + 0.7f * unit( rng ));
+			const Vec3 offset = { (unit( rng ) - 0.5f) * 2.4f * z,(unit( rng ) - 0.5f) * 1.8f * z,z };
+			pipeline.effect.vs.BindWorldView(
+				Mat4::RotationZ( 2.0f * PI * unit( rng ) ) *
+				Mat4::RotationX( (unit( rng ) - 0.5f) * PI / 2.0f ) *
+				Mat4::RotationY( (unit( rng ) - 0.5f) * PI / 2.0f ) *
+				Mat4::Scaling( scale ) *
+				Mat4::Translation( offset )
+			);
+			pZb->Clear();
+			pipeline.BeginFrame();
+			const PipelineStats before = pipeline.GetStats();
+			pipeline.Draw( square );
+			const PipelineStats work = pipeline.GetStats() - before;
+			// the square is all front facing or all back facing, a triangle culled on its own was
+			// seen so close to edge on that snapping turned it around, folding the mesh over
+			// onto its neighbors (no fill rule helps with that)
+			if( work.backfaceCulled > 0u )
+			{
+				r.skipped++;
+				continue;
+			}
+
+			size_t pixels = 0;
+			for( int y = 0; y < int( gfx.ScreenHeight ); y++ )
+			{
+				int first = -1;
+				int last = -1;
+				size_t row = 0;
+				for( int x = 0; x < int( gfx.ScreenWidth ); x++ )
+				{
+					if( pZb->At( x,y ) != std::numeric_limits<float>::infinity() )
+					{
+						first = first < 0 ? x : first;
+						last = x;
+						row++;
+					}
+				}
+				pixels += row;
+				r.gaps += row > 0u ? size_t( last - first + 1 ) - row : 0u;
+			}
+			r.pixels += pixels;
+			r.overlaps += work.pixelsCovered - pixels;
+		}
+		return r;
+	}
+
+	void WriteCoverageJson( std::ostream& os,const std::vector<CoverageResult>& results )
+	{
+		os << "{\n";
+		os << "  \"raster_coverage\": [";
+		for( size_t i = 0; i < results.size(); i++ )
+		{
+			const auto& r = results[i];
+			os << (i == 0 ? "\n" : ",\n");
+			os << "    { \"rasterizer\": \"" << r.rasterizer << "\", \"tiled\": " << (r.tiled ? "true" : "false")
+				<< ", \"views\": " << r.views << ", \"pixels\": " << r.pixels
+				<< ", \"overlaps\": " << r.overlaps << ", \"gaps\": " << r.gaps << ", \"skipped\": " << r.skipped << " }";
+		}
+		os << "\n  ]\n}\n";
+	}
+
+	struct VertexCacheResult
+	{
+		std::string file;
+		// "loaded" (the obj's own order) or "optimized" (after IndexedTriangleList::Optimize)
+		std::string order;
+		std::string policy;
+		size_t cacheSize;
+		size_t vertices;
+		size_t triangles;
+		// triangles left after backface and frustum culling, the only ones whose vertices get shaded
+		size_t visibleTriangles;
+		// what MeshOptimizer reports for the visible triangles in that order, a fifo cache of cacheSize entries
+		double acmr;
+		// vs invocations per visible triangle the pipeline's cache actually came to
+		double acmrMeasured;
+		float hitRate;
+		long long saved;
+	};
+
+	// draws the mesh once with lazy vertex shading for each cache policy and size, in the
+	// obj's own triangle order and then optimized
+	// a fifo cache is what ComputeAcmr models, so for it the draw has to come out the same
+	// the index stream with the triangles the pipeline culls before shading taken out
+	template<class Index>
+	std::vector<Index> VisibleIndices( const SolidPipeline& pipeline,const std::vector<SolidEffect::Vertex>& vertices,
+		const std::vector<Index>& indices )
+	{
+		std::vector<Vec4> positions;
+		positions.reserve( vertices.size() );
+		for( const auto& v : vertices )
+		{
+			positions.push_back( pipeline.effect.vs.Position( v ) );
+		}
+		const auto eyepos = Vec4{ 0.0f,0.0f,0.0f,1.0f } * pipeline.effect.vs.GetProj();
+		std::vector<Index> visible;
+		for( size_t i = 0; i + 2 < indices.size(); i += 3 )
+		{
+			const auto& p0 = positions[indices[i]];
+			const auto& p1 = positions[indices[i + 1]];
+			const auto& p2 = positions[indices[i + 2]];
+			if( SolidPipeline::FacesEye( p0,p1,p2,eyepos ) && !SolidPipeline::OutsideFrustum( p0,p1,p2 ) )
+			{
+				visible.insert( visible.end(),{ indices[i],indices[i + 1],indices[i + 2] } );
+			}
+		}
+		return visible;
+	}
+
+	std::vector<VertexCacheResult> RunVertexCache( Graphics& gfx,const std::string& file )
+	{
+		bool isCCW;
+		auto mesh = IndexedTriangleList<SolidEffect::Vertex>::ReadObj( file,isCCW );
+		mesh.AdjustToTrueCenter();
+		auto pZb = std::make_shared<ZBuffer>( gfx.ScreenWidth,gfx.ScreenHeight );
+		SolidPipeline pipeline( gfx,pZb );
+		pipeline.effect.vs.BindProjection( Mat4::ProjectionHFOV( 90.0f,1.33333f,0.5f,40.0f ) );
+		// fills the screen's height, all of it in view
+		pipeline.effect.vs.BindWorldView( Mat4::Scaling( 1.0f / mesh.GetRadius() ) * Mat4::Translation( 0.0f,0.0f,2.0f ) );
+
+		std::vector<VertexCacheResult> results;
+		for( const char* order : { "loaded","optimized" } )
+		{
+			if( order == std::string( "optimized" ) )
+			{
+				mesh.Optimize();
+			}
+			for( const auto policy : { PostTransformCache<SolidEffect::VSOutput>::Policy::DirectMapped,
+				PostTransformCache<SolidEffect::VSOutput>::Policy::Fifo } )
+			{
+				for( const size_t cacheSize : { size_t( 8 ),size_t( 16 ),size_t( 32 ) } )
+				{
+					pipeline.SetLazyVertexShading( policy,cacheSize );
+					pZb->Clear();
+					pipeline.BeginFrame();
+					pipeline.Draw( mesh );
+					const auto& stats = pipeline.GetVertexCacheStats();
+					VertexCacheResult r;
+					r.file = file;
+					r.order = order;
+					r.policy = policy == PostTransformCache<SolidEffect::VSOutput>::Policy::Fifo ? "fifo" : "direct_mapped";
+					r.cacheSize = cacheSize;
+					r.vertices = mesh.vertices.size();
+					r.triangles = mesh.indices.size() / 3u;
+					mesh.indices.Visit( [&]( const auto& indices )
+					{
+						// the cache only sees the indices of triangles that survive culling
+						const auto visible = VisibleIndices( pipeline,mesh.vertices,indices );
+						r.visibleTriangles = visible.size() / 3u;
+						r.acmr = MeshOptimizer::ComputeAcmr( visible,mesh.vertices.size(),cacheSize );
+					} );
+					r.acmrMeasured = r.visibleTriangles == 0u ? 0.0 : double( stats.misses ) / double( r.visibleTriangles );
+					r.hitRate = stats.HitRate();
+					r.saved = stats.SavedInvocations();
+					results.push_back( r );
+				}
+			}
+		}
+		return results;
+	}
+
+	void WriteVertexCacheJson( std::ostream& os,const std::vector<VertexCacheResult>& results )
+	{
+		os << "{\n";
+		os << "  \"vertex_cache\": [";
+		for( size_t i = 0; i < results.size(); i++ )
+		{
+			const auto& r = results[i];
+			os << (i == 0 ? "\n" : ",\n");
+			os << "    { \"file\": \"" << r.file << "\", \"order\": \"" << r.order << "\", \"policy\": \"" << r.policy
+				<< "\", \"cache_size\": " << r.cacheSize << ", \"vertices\": " << r.vertices << ", \"triangles\": " << r.triangles
+				<< ", \"visible_triangles\": " << r.visibleTriangles
+				<< ", \"acmr\": " << r.acmr << ", \"acmr_measured\": " << r.acmrMeasured
+				<< ", \"hit_rate\": " << r.hitRate << ", \"vs_saved\": " << r.saved << " }";
+		}
+		os << "\n  ]\n}\n";
+	}
+
+	struct OcclusionResult
+	{
+		bool tiled;
+		int views;
+		// sphere draws with occlusion culling on, and how many of them were skipped
+		size_t draws;
+		size_t drawsOccluded;
+		// views whose frame came out different with occlusion culling on
+		int mismatches;
+	};
+
+	// keeps the pixels of the last frame, for comparing renders
+	class CaptureFrameSink : public FrameSink
+	{
+	public:
+		void Consume( const Surface& frame ) override
+		{
+			pixels.clear();
+			for( unsigned int y = 0; y < frame.GetHeight(); y++ )
+			{
+				for( unsigned int x = 0; x < frame.GetWidth(); x++ )
+				{
+					pixels.push_back( frame.GetPixel( x,y ).dword );
+				}
+			}
+		}
+	public:
+		std::vector<unsigned int> pixels;
+	};
+
+	// a room of three walls (drawn as occluders first, then for real) with spheres scattered
+	// inside and outside it, seen from random views in the room; the open side lets some of the
+	// spheres outside show, the walls hide the rest
+	// culling may only skip spheres that would have ended up hidden anyway, so every view
+	// has to come out the same with occlusion culling as without
+	OcclusionResult RunOcclusion( bool tiled,int nViews )
+	{
+		typedef ::Pipeline<::SpecularPhongPointEffect<PointDiffuseParams,SpecularParams>> PropPipeline;
+		typedef ::Pipeline<::VertexLightTexturedEffect<PointDiffuseParams>> WallPipeline;
+		auto pSink = std::make_unique<CaptureFrameSink>();
+		CaptureFrameSink& sink = *pSink;
+		Graphics gfx( std::move( pSink ) );
+		auto pZb = std::make_shared<ZBuffer>( gfx.ScreenWidth,gfx.ScreenHeight );
+		auto pArena = std::make_shared<FrameArena>();
+		PropPipeline pPipeline( gfx,pZb,pArena );
+		WallPipeline wPipeline( gfx,pZb,pArena );
+		if( tiled )
+		{
+			auto pPool = std::make_shared<ThreadPool>();
+			pPipeline.SetThreadPool( pPool );
+			wPipeline.SetThreadPool( pPool );
+		}
+		const MipTexture texture( MakeNoiseTexture( 64 ) );
+		wPipeline.effect.ps.BindTexture( texture );
+		const auto proj = Mat4::ProjectionHFOV( 85.0f,1.33333f,0.2f,12.0f );
+		pPipeline.effect.vs.BindProjection( proj );
+		wPipeline.effect.vs.BindProjection( proj );
+		wPipeline.effect.vs.SetAmbientLight( { 0.35f,0.35f,0.35f } );
+		wPipeline.effect.vs.SetDiffuseLight( { 1.0f,1.0f,1.0f } );
+
+		auto sphere = Sphere::GetPlainNormals<PropPipeline::Vertex>( 0.3f );
+		sphere.ComputeBounds();
+		constexpr float width = 4.0f;
+		constexpr float height = 1.75f;
+		const Vec4 light = { 0.3f,0.2f,0.8f,1.0f };
+		const auto wall = Plane::GetSkinnedNormals<WallPipeline::Vertex>( 20,20,width,height,0.65f );
+		const auto occluder = Plane::GetPlain<WallPipeline::Vertex>( 1,1,width,height );
+		std::vector<Mat4> walls;
+		for( int i = 0; i < 3; i++ )
+		{
+			walls.push_back( Mat4::Translation( 0.0f,0.0f,width / 2.0f ) * Mat4::RotationY( float( i ) * PI / 2.0f ) );
+		}
+
+		std::mt19937 rng( 5 );
+		std::uniform_real_distribution<float> unit( -1.0f,1.0f );
+		OcclusionResult r = { tiled,nViews,0,0,0 };
+		for( int i = 0; i < nViews; i++ )
+		{
+			const Vec3 eye = { unit( rng ) * 1.5f,unit( rng ) * 0.5f,unit( rng ) * 1.5f };
+			const Mat4 view = Mat4::Translation( -eye ) * Mat4::RotationY( unit( rng ) * PI ) * Mat4::RotationX( unit( rng ) * 0.4f );
+			// out to twice the room's size in x and z
+			std::vector<Vec3> props;
+			for( int k = 0; k < 8; k++ )
+			{
+				props.push_back( { unit( rng ) * width,unit( rng ) * 0.6f,unit( rng ) * width } );
+			}
+			std::vector<unsigned int> frames[2];
+			for( const bool culling : { false,true } )
+			{
+				gfx.BeginFrame();
+				pPipeline.BeginFrame();
+				pPipeline.SetOcclusionCulling( culling );
+				pPipeline.effect.ps.SetLightPosition( light * view );
+				wPipeline.effect.vs.SetLightPosition( light * view );
+				for( const auto& world : walls )
+				{
+					wPipeline.effect.vs.BindWorldView( world * view );
+					wPipeline.DrawOccluder( occluder );
+				}
+				const PipelineStats before = pPipeline.GetStats();
+				for( const auto& pos : props )
+				{
+					pPipeline.effect.vs.BindWorldView( Mat4::Translation( pos ) * view );
+					pPipeline.Draw( sphere );
+				}
+				if( culling )
+				{
+					r.draws += props.size();
+					r.drawsOccluded += (pPipeline.GetStats() - before).drawsOccluded;
+				}
+				for( const auto& world : walls )
+				{
+					wPipeline.effect.vs.BindWorldView( world * view );
+					wPipeline.Draw( wall );
+				}
+				gfx.EndFrame();
+				frames[culling] = sink.pixels;
+			}
+			r.mismatches += frames[0] != frames[1] ? 1 : 0;
+		}
+		return r;
+	}
+
+	void WriteOcclusionJson( std::ostream& os,const std::vector<OcclusionResult>& results )
+	{
+		os << "{\n";
+		os << "  \"occlusion\": [";
+		for( size_t i = 0; i < results.size(); i++ )
+		{
+			const auto& r = results[i];
+			os << (i == 0 ? "\n" : ",\n");
+			os << "    { \"tiled\": " << (r.tiled ? "true" : "false") << ", \"views\": " << r.views
+				<< ", \"draws\": " << r.draws << ", \"draws_occluded\": " << r.drawsOccluded
+				<< ", \"mismatches\": " << r.mismatches << " }";
+		}
+		os << "\n  ]\n}\n";
+	}
+
+	// camera script, the same input on the same frame every run
+	// moves forward, pans right, backs off to the left, then looks down and up
+	void DriveInput( ScriptedInput& input,int frame,int nFrames )
+	{
+		const int quarter = std::max( nFrames / 4,1 );
+		const int phase = std::min( frame / quarter,3 );
+		const int step = frame - phase * quarter;
+		// mouse drags start from the screen center
+		const int cx = int( Graphics::ScreenWidth / 2 );
+		const int cy = int( Graphics::ScreenHeight / 2 );
+		if( step == 0 )
+		{
+			input.ReleaseAllKeys();
+			input.ReleaseLeft( cx,cy );
+		}
+		switch( phase )
+		{
+		case 0:
+			input.PressKey( 'W' );
+			break;
+		case 1:
+			if( step == 0 )
+			{
+				input.PressLeft( cx,cy );
+			}
+			input.MoveMouse( cx + step % 200,cy );
+			break;
+		case 2:
+			input.PressKey( 'S' );
+			input.PressKey( 'A' );
+			break;
+		case 3:
+			if( step == 0 )
+			{
+				input.PressLeft( cx,cy );
+			}
+			// triangle wave so the view comes back up
+			input.MoveMouse( cx,cy + 60 - std::abs( step % 240 - 120 ) );
+			break;
+		}
+	}
+
+	Result RunScene( Graphics& gfx,const SceneEntry& entry,const Options& opt )
+	{
+		Keyboard kbd;
+		Mouse mouse;
+		ScriptedInput input( kbd,mouse );
+		auto pScene = entry.make( gfx );
+		constexpr float dt = 1.0f / 60.0f;
+
+		// warmup frames get the scene into steady state (arena sizes, caches) and are not timed
+		for( int i = 0; i < opt.warmup; i++ )
+		{
+			gfx.BeginFrame();
+			pScene->Update( kbd,mouse,dt );
+			pScene->Draw();
+			gfx.EndFrame();
+		}
+
+		std::vector<float> times;
+		times.reserve( opt.frames );
+		const PipelineStats workBefore = pScene->GetPipelineStats();
+		FrameTimer ft;
+		for( int i = 0; i < opt.frames; i++ )
+		{
+			DriveInput( input,i,opt.frames );
+			ft.Mark();
+			gfx.BeginFrame();
+			pScene->Update( kbd,mouse,dt );
+			pScene->Draw();
+			gfx.EndFrame();
+			times.push_back( ft.Mark() );
+		}
+
+		Result r;
+		r.name = entry.name;
+		r.frames = opt.frames;
+		r.work = pScene->GetPipelineStats() - workBefore;
+		r.seconds = 0.0;
+		for( const float t : times )
+		{
+			r.seconds += t;
+		}
+		std::sort( times.begin(),times.end() );
+		// nearest rank percentile
+		const auto Percentile = [&times]( double p )
+		{
+			const size_t rank = size_t( std::ceil( p * double( times.size() ) ) );
+			return double( times[std::clamp( rank,size_t( 1 ),times.size() ) - 1] ) * 1000.0;
+		};
+		r.meanMs = r.seconds * 1000.0 / double( times.size() );
+		r.medianMs = Percentile( 0.5 );
+		r.p99Ms = Percentile( 0.99 );
+		r.minMs = double( times.front() ) * 1000.0;
+		r.maxMs = double( times.back() ) * 1000.0;
+		return r;
+	}
+
+	void WriteJson( std::ostream& os,const Options& opt,const std::vector<Result>& results )
+	{
+		os << "{\n";
+		os << "  \"width\": " << Graphics::ScreenWidth << ",\n";
+		os << "  \"height\": " << Graphics::ScreenHeight << ",\n";
+		os << "  \"frames\": " << opt.frames << ",\n";
+		os << "  \"warmup\": " << opt.warmup << ",\n";
+		os << "  \"scenes\": [";
+		for( size_t i = 0; i < results.size(); i++ )
+		{
+			const auto& r = results[i];
+			os << (i == 0 ? "\n" : ",\n");
+			os << "    {\n";
+			os << "      \"name\": \"" << r.name << "\",\n";
+			os << "      \"frame_ms\": { \"mean\": " << r.meanMs << ", \"median\": " << r.medianMs
+				<< ", \"p99\": " << r.p99Ms << ", \"min\": " << r.minMs << ", \"max\": " << r.maxMs << " },\n";
+			os << "      \"fps\": " << double( r.frames ) / r.seconds << ",\n";
+			os << "      \"triangles_per_sec\": " << double( r.work.trianglesAssembled ) / r.seconds << ",\n";
+			os << "      \"pixels_per_sec\": " << double( r.work.psInvocations ) / r.seconds << ",\n";
+			// totals over the timed frames
+			os << "      \"pipeline_stats\": {";
+			const char* separator = "\n";
+			PipelineStats::ForEachCounter( [&]( size_t PipelineStats::* c,const char* name )
+			{
+				os << separator << "        \"" << name << "\": " << r.work.*c;
+				separator = ",\n";
+			} );
+			os << "\n      }\n";
+			os << "    }";
+		}
+		os << "\n  ]\n}\n";
+	}
+
+	bool ParseArgs( int argc,char** argv,Options& opt )
+	{
+		for( int i = 1; i < argc; i++ )
+		{
+			const std::string arg = argv[i];
+			if( i + 1 >= argc )
+			{
+				return false;
+			}
+			const std::string val = argv[++i];
+			if( arg == "--frames" )
+			{
+				opt.frames = std::stoi( val );
+			}
+			else if( arg == "--warmup" )
+			{
+				opt.warmup = std::stoi( val );
+			}
+			else if( arg == "--scene" )
+			{
+				opt.scene = val;
+			}
+			else if( arg == "--out" )
+			{
+				opt.out = val;
+			}
+			else if( arg == "--ppm" )
+			{
+				opt.ppmPrefix = val;
+			}
+			else if( arg == "--raw" )
+			{
+				opt.rawFile = val;
+			}
+			else if( arg == "--load-obj" )
+			{
+				opt.objFiles.push_back( val );
+			}
+			else if( arg == "--synthetic-tris" )
+			{
+				opt.syntheticTris = size_t( std::stoull( val ) );
+			}
+			else if( arg == "--load-runs" )
+			{
+				opt.loadRuns = std::stoi( val );
+			}
+			else if( arg == "--floor-texture" )
+			{
+				opt.textureFiles.push_back( val );
+			}
+			else if( arg == "--synthetic-texture" )
+			{
+				opt.syntheticTexture = (unsigned int)std::stoul( val );
+			}
+			else if( arg == "--texture-runs" )
+			{
+				opt.textureRuns = std::stoi( val );
+			}
+			else if( arg == "--raster-coverage" )
+			{
+				opt.coverageViews = std::stoi( val );
+			}
+			else if( arg == "--vertex-cache" )
+			{
+				opt.vertexCacheFiles.push_back( val );
+			}
+			else if( arg == "--occlusion" )
+			{
+				opt.occlusionViews = std::stoi( val );
+			}
+			else
+			{
+				return false;
+			}
+		}
+		return opt.frames > 0 && opt.warmup >= 0 && opt.loadRuns > 0 && opt.textureRuns > 0;
+	}
+}
+
+int main( int argc,char** argv )
+{
+	Options opt;
+	if( !ParseArgs( argc,argv,opt ) )
+	{
+		std::cerr << "usage: " << argv[0] << " [--frames n] [--warmup n] [--scene name] [--out file.json]"
+			" [--ppm prefix | --raw file]\n"
+			"       " << argv[0] << " [--load-obj file]... [--synthetic-tris n] [--load-runs n] [--out file.json]\n"
+			"       " << argv[0] << " [--floor-texture file]... [--synthetic-texture n] [--texture-runs n] [--out file.json]\n"
+			"       " << argv[0] << " --raster-coverage n [--out file.json]\n"
+			"       " << argv[0] << " [--vertex-cache file]... [--out file.json]\n"
+			"       " << argv[0] << " --occlusion n [--out file.json]\n";
+		return 1;
+	}
+
+	try
+	{
+		if( !opt.objFiles.empty() || opt.syntheticTris > 0u )
+		{
+			std::vector<LoadResult> results;
+			for( const auto& file : opt.objFiles )
+			{
+				std::cerr << "loading " << file << "...\n";
+				results.push_back( RunLoad( file,opt.loadRuns ) );
+			}
+			if( opt.syntheticTris > 0u )
+			{
+				const auto path = (std::filesystem::temp_directory_path() /
+					("synthetic_" + std::to_string( opt.syntheticTris ) + ".obj")).string();
+				std::cerr << "writing " << path << "...\n";
+				WriteSyntheticObj( path,opt.syntheticTris );
+				std::cerr << "loading " << path << "...\n";
+				try
+				{
+					results.push_back( RunLoad( path,opt.loadRuns ) );
+				}
+				catch( ... )
+				{
+					std::filesystem::remove( path );
+					throw;
+				}
+				std::filesystem::remove( path );
+			}
+			if( opt.out.empty() )
+			{
+				WriteLoadJson( std::cout,results );
+			}
+			else
+			{
+				std::ofstream file( opt.out );
+				WriteLoadJson( file,results );
+			}
+			return 0;
+		}
+
+		if( !opt.textureFiles.empty() || opt.syntheticTexture > 0u )
+		{
+			std::vector<TextureWalkResult> results;
+			for( const auto& file : opt.textureFiles )
+			{
+				std::cerr << "sampling " << file << "...\n";
+				const Surface texture = Surface::FromFile( std::wstring( file.begin(),file.end() ) );
+				results.push_back( RunTextureWalks( file,texture,opt.textureRuns ) );
+			}
+			if( opt.syntheticTexture > 0u )
+			{
+				const std::string name = "noise " + std::to_string( opt.syntheticTexture );
+				std::cerr << "sampling " << name << "...\n";
+				results.push_back( RunTextureWalks( name,MakeNoiseTexture( opt.syntheticTexture ),opt.textureRuns ) );
+			}
+			if( opt.out.empty() )
+			{
+				WriteTextureJson( std::cout,results );
+			}
+			else
+			{
+				std::ofstream file( opt.out );
+				WriteTextureJson( file,results );
+			}
+			return 0;
+		}
+
+		if( opt.coverageViews > 0 )
+		{
+			// overlaps and folded over views are read off the pipeline statistics
+			if constexpr( !PipelineStats::enabled )
+			{
+				std::cerr << "--raster-coverage needs pipeline statistics, rebuild without CHILI_NO_PIPELINE_STATS\n";
+				return 1;
+			}
+			Graphics gfx( std::make_unique<DiscardFrameSink>() );
+			std::vector<CoverageResult> results;
+			bool exact = true;
+			for( const auto rasterizer : { SolidPipeline::Rasterizer::Scanline,SolidPipeline::Rasterizer::HalfSpace } )
+			{
+				for( const bool tiled : { false,true } )
+				{
+					results.push_back( RunCoverage( gfx,rasterizer,tiled,opt.coverageViews ) );
+					exact = exact && results.back().overlaps == 0u && results.back().gaps == 0u;
+				}
+			}
+			if( opt.out.empty() )
+			{
+				WriteCoverageJson( std::cout,results );
+			}
+			else
+			{
+				std::ofstream file( opt.out );
+				WriteCoverageJson( file,results );
+			}
+			if( !exact )
+			{
+				std::cerr << "pixels covered more than once or not at all\n";
+				return 1;
+			}
+			return 0;
+		}
+
+		if( !opt.vertexCacheFiles.empty() )
+		{
+			Graphics gfx( std::make_unique<DiscardFrameSink>() );
+			std::vector<VertexCacheResult> results;
+			bool matches = true;
+			for( const auto& file : opt.vertexCacheFiles )
+			{
+				std::cerr << "drawing " << file << "...\n";
+				for( const auto& r : RunVertexCache( gfx,file ) )
+				{
+					matches = matches && (r.policy != std::string( "fifo" ) || r.acmrMeasured == r.acmr);
+					results.push_back( r );
+				}
+			}
+			if( opt.out.empty() )
+			{
+				WriteVertexCacheJson( std::cout,results );
+			}
+			else
+			{
+				std::ofstream file( opt.out );
+				WriteVertexCacheJson( file,results );
+			}
+			if( !matches )
+			{
+				std::cerr << "fifo vertex cache misses differ from the optimizer's acmr\n";
+				return 1;
+			}
+			return 0;
+		}
+
+		if( opt.occlusionViews > 0 )
+		{
+			// skipped draws are read off the pipeline statistics
+			if constexpr( !PipelineStats::enabled )
+			{
+				std::cerr << "--occlusion needs pipeline statistics, rebuild without CHILI_NO_PIPELINE_STATS\n";
+				return 1;
+			}
+			std::vector<OcclusionResult> results;
+			bool pass = true;
+			for( const bool tiled : { false,true } )
+			{
+				results.push_back( RunOcclusion( tiled,opt.occlusionViews ) );
+				pass = pass && results.back().mismatches == 0 && results.back().drawsOccluded > 0u;
+			}
+			if( opt.out.empty() )
+			{
+				WriteOcclusionJson( std::cout,results );
+			}
+			else
+			{
+				std::ofstream file( opt.out );
+				WriteOcclusionJson( file,results );
+			}
+			if( !pass )
+			{
+				std::cerr << "occlusion culling changed the frame or never skipped a draw\n";
+				return 1;
+			}
+			return 0;
+		}
+
+		std::unique_ptr<FrameSink> pSink;
+		if( !opt.ppmPrefix.empty() )
+		{
+			pSink = std::make_unique<PpmFrameSink>( opt.ppmPrefix );
+		}
+		else if( !opt.rawFile.empty() )
+		{
+			pSink = std::make_unique<RawFrameSink>( opt.rawFile );
+		}
+		else
+		{
+			pSink = std::make_unique<DiscardFrameSink>();
+		}
+		Graphics gfx( std::move( pSink ) );
+
+		std::vector<Result> results;
+		for( const auto& entry : MakeSceneList( std::make_shared<ThreadPool>() ) )
+		{
+			if( opt.scene.empty() || opt.scene == entry.name )
+			{
+				std::cerr << "running " << entry.name << "...\n";
+				results.push_back( RunScene( gfx,entry,opt ) );
+			}
+		}
+		if( results.empty() )
+		{
+			std::cerr << "no scene named " << opt.scene << "\n";
+			return 1;
+		}
+
+		if( opt.out.empty() )
+		{
+			WriteJson( std::cout,opt,results );
+		}
+		else
+		{
+			std::ofstream file( opt.out );
+			WriteJson( file,opt,results );
+		}
+	}
+	catch( const ChiliException& e )
+	{
+		const std::wstring msg = e.GetFullMessage();
+		std::cerr << std::string( msg.begin(),msg.end() ) << "\n";
+		return 1;
+	}
+	catch( const std::exception& e )
+	{
+		std::cerr << e.what() << "\n";
+		return 1;
+	}
+	return 0;
+}
+#endif
\ No newline at end of file
@@ -0,0 +1,10 @@
+#pragma once
+
+#include "Vec3.h"
+
+// sphere enclosing all of a mesh's vertex positions
+struct BoundingSphere
+{
+	Vec3 center;
+	float radius;
+};
\ No newline at end of file
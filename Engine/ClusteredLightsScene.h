@@ -0,0 +1,171 @@
+#pragma once
+
+#include "Scene.h"
+#include "Mat.h"
+#include "Pipeline.h"
+#include "SpecularPhongPointEffect.h"
+#include "SolidEffect.h"
+#include "Sphere.h"
+#include "Plane.h"
+#include "LightClusters.h"
+
+// fast falloff so each light only lights a patch of the floor
+struct ClusteredLightDiffuseParams
+{
+	static constexpr float linear_attenuation = 0.0f;
+	static constexpr float quadradic_attenuation = 24.0f;
+	static constexpr float constant_attenuation = 0.3f;
+};
+
+// dozens of colored point lights circling over a floor with a few suzannes on it,
+// shaded through a LightClusters list rebuilt every frame
+class ClusteredLightsScene : public Scene
+{
+	using Effect = ::SpecularPhongPointEffect<ClusteredLightDiffuseParams,DefaultSpecularParams>;
+public:
+	typedef ::Pipeline<Effect> Pipeline;
+	typedef ::Pipeline<SolidEffect> LightIndicatorPipeline;
+	typedef Pipeline::Vertex Vertex;
+public:
+	// the pipelines rasterize in tiles on the threads of pPool (shared with the other scenes)
+	ClusteredLightsScene( Graphics& gfx,std::shared_ptr<ThreadPool> pPool_in )
+		:
+		Scene( "clustered lights scene" ),
+		pZb( std::make_shared<ZBuffer>( gfx.ScreenWidth,gfx.ScreenHeight ) ),
+		pPool( std::move( pPool_in ) ),
+		pArena( std::make_shared<FrameArena>() ),
+		pipeline( gfx,pZb,pArena ),
+		liPipeline( gfx,pZb,pArena )
+	{
+		pipeline.SetThreadPool( pPool );
+		liPipeline.SetThreadPool( pPool );
+		// suzannes only cover a few thousand pixels, the full 15k triangles are mostly subpixel
+		pipeline.SetLodSelection( 1.0f );
+		suzanne.AdjustToTrueCenter();
+		suzanne.ComputeBounds();
+		// indicators of lights that are out of view don't get drawn
+		lightIndicator.ComputeBounds();
+		pipeline.effect.ps.SetAmbientLight( ambient );
+		pipeline.effect.ps.BindLights( clusters );
+		// floor pixels the suzannes get drawn over are never lit with their dozens of lights
+		// (the light list is rebuilt at the start of Draw, so it's the same for every draw of a frame)
+		pipeline.SetDeferredShading( true );
+		// rings of lights, alternate rings going the other way round
+		for( int i = 0; i < nLights; i++ )
+		{
+			const int ring = i % nRings;
+			const float hue = float( i ) / float( nLights );
+			const Vec3 color = HueToRgb( hue ) * 1.5f;
+			orbits.push_back( {
+				1.0f + float( ring ) * 1.1f,
+				float( i / nRings ) * 2.0f * PI / float( nLights / nRings ) + float( ring ),
+				(ring % 2 == 0 ? 0.4f : -0.3f) * (1.0f + float( i % 3 ) * 0.2f),
+				color
+			} );
+		}
+	}
+	virtual void Update( Keyboard&,Mouse&,float dt ) override
+	{
+		t += dt;
+	}
+	virtual void Draw() override
+	{
+		pipeline.BeginFrame();
+
+		const auto proj = Mat4::ProjectionHFOV( hfov,aspect_ratio,0.2f,20.0f );
+		const auto view = Mat4::Translation( -cam_pos ) * Mat4::RotationX( cam_pitch );
+
+		// light list for this frame, in view space
+		// (cut off at 1/32, the long tail of the falloff would otherwise have every light reach
+		//  most of the floor; the windowing still fades them out smoothly)
+		lights.clear();
+		for( const auto& o : orbits )
+		{
+			lights.push_back( { Vec3( OrbitPosition( o ) * view ),o.color,Effect::PixelShader::LightRadius( o.color,1.0f / 32.0f ) } );
+		}
+		clusters.Build( lights,proj );
+
+		pipeline.effect.vs.BindProjection( proj );
+		// floor
+		pipeline.effect.vs.BindWorldView( Mat4::RotationX( PI / 2.0f ) * view );
+		pipeline.Draw( floor );
+		// suzannes
+		suzanneWorldViews.clear();
+		for( int i = 0; i < 5; i++ )
+		{
+			const float angle = float( i ) * 2.0f * PI / 5.0f;
+			suzanneWorldViews.push_back(
+				Mat4::RotationY( -angle + t * 0.3f ) *
+				Mat4::Scaling( 0.35f ) *
+				Mat4::Translation( 2.6f * std::cos( angle ),0.35f,2.6f * std::sin( angle ) ) *
+				view
+			);
+		}
+		pipeline.DrawInstanced( suzanne,suzanneWorldViews );
+
+		// light indicators
+		liPipeline.effect.vs.BindProjection( proj );
+		for( const auto& o : orbits )
+		{
+			for( auto& v : lightIndicator.vertices )
+			{
+				v.color = Color( (o.color / 1.5f) * 255.0f );
+			}
+			liPipeline.effect.vs.BindWorldView( Mat4::Translation( Vec3( OrbitPosition( o ) ) ) * view );
+			liPipeline.Draw( lightIndicator );
+		}
+	}
+	virtual PipelineStats GetPipelineStats() const override
+	{
+		return pipeline.GetStats() + liPipeline.GetStats();
+	}
+private:
+	struct Orbit
+	{
+		float radius;
+		float phase;
+		// radians per second
+		float speed;
+		Vec3 color;
+	};
+	Vec4 OrbitPosition( const Orbit& o ) const
+	{
+		const float angle = o.phase + o.speed * t;
+		return { o.radius * std::cos( angle ),lightHeight,o.radius * std::sin( angle ),1.0f };
+	}
+	static Vec3 HueToRgb( float hue )
+	{
+		const auto Channel = [hue]( float offset )
+		{
+			return std::clamp( std::abs( std::fmod( hue * 6.0f + offset,6.0f ) - 3.0f ) - 1.0f,0.0f,1.0f );
+		};
+		return { Channel( 0.0f ),Channel( 4.0f ),Channel( 2.0f ) };
+	}
+private:
+	float t = 0.0f;
+	// pipelines
+	std::shared_ptr<ZBuffer> pZb;
+	std::shared_ptr<ThreadPool> pPool;
+	std::shared_ptr<FrameArena> pArena;
+	Pipeline pipeline;
+	LightIndicatorPipeline liPipeline;
+	// fov
+	static constexpr float aspect_ratio = 1.33333f;
+	static constexpr float hfov = 85.0f;
+	// camera above the floor looking down at it
+	Vec3 cam_pos = { 0.0f,3.2f,-5.5f };
+	float cam_pitch = -0.5f;
+	// lights
+	static constexpr int nLights = 48;
+	static constexpr int nRings = 4;
+	static constexpr float lightHeight = 0.2f;
+	Vec3 ambient = { 0.05f,0.05f,0.05f };
+	std::vector<Orbit> orbits;
+	std::vector<PointLight> lights;
+	LightClusters clusters;
+	IndexedTriangleList<SolidEffect::Vertex> lightIndicator = Sphere::GetPlain<SolidEffect::Vertex>( 0.04f );
+	// geometry
+	IndexedTriangleList<Vertex> floor = Plane::GetNormals<Vertex>( 40,40,12.0f,12.0f );
+	IndexedTriangleList<Vertex> suzanne = IndexedTriangleList<Vertex>::LoadNormals( "models\\suzanne.obj",false,5 );
+	std::vector<Mat4> suzanneWorldViews;
+};
\ No newline at end of file
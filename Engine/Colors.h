@@ -50,7 +50,7 @@ public:
 	{}
 	explicit Color( const Vec3& cf )
 		:
-		Color( unsigned char( cf.x ),unsigned char( cf.y ),unsigned char( cf.z ) )
+		Color( static_cast<unsigned char>( cf.x ),static_cast<unsigned char>( cf.y ),static_cast<unsigned char>( cf.z ) )
 	{}
 	explicit operator Vec3() const
 	{
@@ -10,18 +10,19 @@
 class CubeSkinScene : public Scene
 {
 public:
-	typedef Pipeline<TextureEffect> Pipeline;
+	// trilinear, the cube can be moved back until its faces are a fraction of their texels across
+	typedef ::Pipeline<TextureEffect<TextureFilter::Trilinear>> Pipeline;
 	typedef Pipeline::Vertex Vertex;
 public:
 	CubeSkinScene( Graphics& gfx,const std::wstring& filename )
 		:
+		Scene( "Textured Cube skinned using texture: " + std::string( filename.begin(),filename.end() ) ),
 		itlist( Cube::GetSkinned<Vertex>() ),
-		pipeline( gfx ),
-		Scene( "Textured Cube skinned using texture: " + std::string( filename.begin(),filename.end() ) )
+		pipeline( gfx )
 	{
 		pipeline.effect.ps.BindTexture( filename );
 	}
-	virtual void Update( Keyboard& kbd,Mouse& mouse,float dt ) override
+	virtual void Update( Keyboard& kbd,Mouse&,float dt ) override
 	{
 		if( kbd.KeyIsPressed( 'Q' ) )
 		{
@@ -61,21 +62,26 @@ public:
 		pipeline.BeginFrame();
 		// generate rotation matrix from euler angles
 		// translation from offset
-		const Mat3 rot =
-			Mat3::RotationX( theta_x ) *
-			Mat3::RotationY( theta_y ) *
-			Mat3::RotationZ( theta_z );
-		const Vec3 trans = { 0.0f,0.0f,offset_z };
+		const Mat4 rot =
+			Mat4::RotationX( theta_x ) *
+			Mat4::RotationY( theta_y ) *
+			Mat4::RotationZ( theta_z );
 		// set pipeline transform
-		pipeline.effect.vs.BindRotation( rot );
-		pipeline.effect.vs.BindTranslation( trans );
+		pipeline.effect.vs.BindWorldView( rot * Mat4::Translation( 0.0f,0.0f,offset_z ) );
+		pipeline.effect.vs.BindProjection( Mat4::ProjectionHFOV( hfov,aspect_ratio,0.5f,4.0f ) );
 		// render triangles
 		pipeline.Draw( itlist );
 	}
+	virtual PipelineStats GetPipelineStats() const override
+	{
+		return pipeline.GetStats();
+	}
 private:
 	IndexedTriangleList<Vertex> itlist;
 	Pipeline pipeline;
 	static constexpr float dTheta = PI;
+	static constexpr float aspect_ratio = 1.33333f;
+	static constexpr float hfov = 100.0f;
 	float offset_z = 2.0f;
 	float theta_x = 0.0f;
 	float theta_y = 0.0f;
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <xmmintrin.h>
+#include <emmintrin.h>
+#include <cmath>
+
+// 4 floats processed in lockstep (one SSE register)
+// used for shading several pixels at once in SoA form
+class FloatPacket
+{
+public:
+	static constexpr int size = 4;
+public:
+	FloatPacket() = default;
+	FloatPacket( float f )
+		:
+		v( _mm_set1_ps( f ) )
+	{}
+	FloatPacket( __m128 v )
+		:
+		v( v )
+	{}
+	FloatPacket( float f0,float f1,float f2,float f3 )
+		:
+		v( _mm_setr_ps( f0,f1,f2,f3 ) )
+	{}
+	FloatPacket	operator-() const
+	{
+		return _mm_sub_ps( _mm_setzero_ps(),v );
+	}
+	FloatPacket&	operator+=( const FloatPacket& rhs )
+	{
+		v = _mm_add_ps( v,rhs.v );
+		return *this;
+	}
+	FloatPacket&	operator-=( const FloatPacket& rhs )
+	{
+		v = _mm_sub_ps( v,rhs.v );
+		return *this;
+	}
+	FloatPacket&	operator*=( const FloatPacket& rhs )
+	{
+		v = _mm_mul_ps( v,rhs.v );
+		return *this;
+	}
+	FloatPacket&	operator/=( const FloatPacket& rhs )
+	{
+		v = _mm_div_ps( v,rhs.v );
+		return *this;
+	}
+	FloatPacket	operator+( const FloatPacket& rhs ) const
+	{
+		return FloatPacket( *this ) += rhs;
+	}
+	FloatPacket	operator-( const FloatPacket& rhs ) const
+	{
+		return FloatPacket( *this ) -= rhs;
+	}
+	FloatPacket	operator*( const FloatPacket& rhs ) const
+	{
+		return FloatPacket( *this ) *= rhs;
+	}
+	FloatPacket	operator/( const FloatPacket& rhs ) const
+	{
+		return FloatPacket( *this ) /= rhs;
+	}
+	void Store( float* pOut ) const
+	{
+		_mm_storeu_ps( pOut,v );
+	}
+	float operator[]( int i ) const
+	{
+		alignas( 16 ) float lanes[size];
+		_mm_store_ps( lanes,v );
+		return lanes[i];
+	}
+	friend FloatPacket sqrt( const FloatPacket& p )
+	{
+		return _mm_sqrt_ps( p.v );
+	}
+	friend FloatPacket min( const FloatPacket& a,const FloatPacket& b )
+	{
+		return _mm_min_ps( a.v,b.v );
+	}
+	friend FloatPacket max( const FloatPacket& a,const FloatPacket& b )
+	{
+		return _mm_max_ps( a.v,b.v );
+	}
+	// x^p for a non-negative whole number p by repeated squaring
+	friend FloatPacket pow( FloatPacket x,unsigned int p )
+	{
+		FloatPacket result = 1.0f;
+		for( ; p != 0u; p >>= 1,x *= x )
+		{
+			if( p & 1u )
+			{
+				result *= x;
+			}
+		}
+		return result;
+	}
+	// x^p for any p, one lane at a time
+	friend FloatPacket pow( const FloatPacket& x,float p )
+	{
+		alignas( 16 ) float lanes[size];
+		_mm_store_ps( lanes,x.v );
+		for( auto& l : lanes )
+		{
+			l = std::pow( l,p );
+		}
+		return _mm_load_ps( lanes );
+	}
+public:
+	__m128 v;
+};
\ No newline at end of file
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <cstddef>
+#include <cassert>
+#include <algorithm>
+#include <type_traits>
+
+// bump allocator for per-draw scratch memory (vs output etc.)
+// memory is handed out from a chain of blocks that are kept for the life of the
+// arena; a draw takes a marker before allocating and rewinds to it when done,
+// so once the blocks have grown to fit the heaviest draw nothing is ever
+// allocated from the heap again
+// can be shared by pipelines that draw one after the other (not concurrently)
+class FrameArena
+{
+public:
+	class Marker
+	{
+		friend FrameArena;
+	private:
+		size_t block;
+		size_t offset;
+	};
+public:
+	FrameArena( size_t blockSize = 1u << 20 )
+		:
+		blockSize( (blockSize + alignment - 1) & ~(alignment - 1) )
+	{}
+	FrameArena( const FrameArena& ) = delete;
+	FrameArena& operator=( const FrameArena& ) = delete;
+	// uninitialized storage for count Ts, valid until the arena is rewound past it
+	template<class T>
+	T* Allocate( size_t count )
+	{
+		static_assert( std::is_trivially_destructible_v<T>,"arena never runs destructors" );
+		static_assert( alignof( T ) <= alignment,"arena blocks are only 16-byte aligned" );
+		const size_t size = (sizeof( T ) * count + alignment - 1) & ~(alignment - 1);
+		// find a block with room, starting at the current one
+		while( iBlock < blocks.size() && offset + size > blocks[iBlock].size )
+		{
+			iBlock++;
+			offset = 0;
+		}
+		if( iBlock == blocks.size() )
+		{
+			const size_t newSize = std::max( size,blockSize );
+			blocks.push_back( { std::make_unique<Chunk[]>( newSize / alignment ),newSize } );
+			allocationsThisFrame++;
+			allocations++;
+		}
+		auto* const p = reinterpret_cast<T*>( reinterpret_cast<std::byte*>( blocks[iBlock].pData.get() ) + offset );
+		offset += size;
+		return p;
+	}
+	Marker GetMarker() const
+	{
+		Marker m;
+		m.block = iBlock;
+		m.offset = offset;
+		return m;
+	}
+	// frees everything allocated since the marker was taken
+	void Rewind( const Marker& m )
+	{
+		iBlock = m.block;
+		offset = m.offset;
+	}
+	// frame boundary: everything should have been rewound by now
+	// in debug builds, asserts that no frame after the first had to grow the arena
+	// (if a scene's heaviest draw only shows up later, Reserve for it up front)
+	void BeginFrame()
+	{
+		assert( iBlock == 0 && offset == 0 );
+		assert( framesStarted < 2 || allocationsThisFrame == 0 );
+		allocationsThisFrame = 0;
+		framesStarted++;
+	}
+	// makes sure a single allocation of size bytes can be served without growing
+	void Reserve( size_t size )
+	{
+		const auto m = GetMarker();
+		Allocate<std::byte>( size );
+		Rewind( m );
+	}
+	// number of heap allocations the arena has made, ever / since the last BeginFrame
+	size_t GetAllocationCount() const
+	{
+		return allocations;
+	}
+	size_t GetAllocationCountThisFrame() const
+	{
+		return allocationsThisFrame;
+	}
+private:
+	static constexpr size_t alignment = 16;
+	struct alignas( alignment ) Chunk
+	{
+		std::byte bytes[alignment];
+	};
+	struct Block
+	{
+		std::unique_ptr<Chunk[]> pData;
+		size_t size;
+	};
+	size_t blockSize;
+	std::vector<Block> blocks;
+	size_t iBlock = 0;
+	size_t offset = 0;
+	size_t allocations = 0;
+	size_t allocationsThisFrame = 0;
+	size_t framesStarted = 0;
+};
\ No newline at end of file
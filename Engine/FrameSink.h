@@ -0,0 +1,88 @@
+#pragma once
+
+#include "Surface.h"
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <stdexcept>
+#include <vector>
+
+// receives finished frames from a headless Graphics at EndFrame
+class FrameSink
+{
+public:
+	virtual ~FrameSink() = default;
+	virtual void Consume( const Surface& frame ) = 0;
+};
+
+// throws frames away (for measuring throughput)
+class DiscardFrameSink : public FrameSink
+{
+public:
+	void Consume( const Surface& ) override
+	{}
+};
+
+// appends every frame's raw pixels (32-bit xrgb, little endian, no padding) to one file
+class RawFrameSink : public FrameSink
+{
+public:
+	RawFrameSink( const std::string& filename )
+		:
+		file( filename,std::ios::binary )
+	{
+		if( !file )
+		{
+			throw std::runtime_error( "RawFrameSink could not open file: " + filename );
+		}
+	}
+	void Consume( const Surface& frame ) override
+	{
+		const Color* pBuffer = frame.GetBufferPtrConst();
+		for( unsigned int y = 0; y < frame.GetHeight(); y++ )
+		{
+			file.write( reinterpret_cast<const char*>( &pBuffer[y * frame.GetPitch()] ),
+				std::streamsize( frame.GetWidth() * sizeof( Color ) ) );
+		}
+	}
+private:
+	std::ofstream file;
+};
+
+// writes each frame to its own binary ppm file, <prefix>0000.ppm, <prefix>0001.ppm, etc.
+class PpmFrameSink : public FrameSink
+{
+public:
+	PpmFrameSink( const std::string& prefix )
+		:
+		prefix( prefix )
+	{}
+	void Consume( const Surface& frame ) override
+	{
+		std::stringstream name;
+		name << prefix << std::setw( 4 ) << std::setfill( '0' ) << frameIndex++ << ".ppm";
+		std::ofstream file( name.str(),std::ios::binary );
+		if( !file )
+		{
+			throw std::runtime_error( "PpmFrameSink could not open file: " + name.str() );
+		}
+		file << "P6\n" << frame.GetWidth() << " " << frame.GetHeight() << "\n255\n";
+		row.resize( frame.GetWidth() * 3u );
+		for( unsigned int y = 0; y < frame.GetHeight(); y++ )
+		{
+			for( unsigned int x = 0; x < frame.GetWidth(); x++ )
+			{
+				const Color c = frame.GetPixel( x,y );
+				row[x * 3u + 0u] = char( c.GetR() );
+				row[x * 3u + 1u] = char( c.GetG() );
+				row[x * 3u + 2u] = char( c.GetB() );
+			}
+			file.write( row.data(),std::streamsize( row.size() ) );
+		}
+	}
+private:
+	std::string prefix;
+	unsigned int frameIndex = 0;
+	std::vector<char> row;
+};
\ No newline at end of file
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "Vec3.h"
+#include "ZBuffer.h"
+#include <vector>
+#include <limits>
+#include <cassert>
+
+// surface attributes of one pixel for deferred shading
+// n / worldPos are named like the pixel shader inputs they stand in for, so lighting
+// code written against interpolated attributes (BasePhongShader) takes a texel as is
+struct GBufferTexel
+{
+	Vec3 n;
+	// position the lighting is done in (view space for the phong effects)
+	Vec3 worldPos;
+	// 0..1 per channel
+	Vec3 material;
+	// screen depth the texel was written with, nan once it has been lit
+	float depth;
+};
+
+// per pixel surface attributes written by the geometry pass of deferred shading, lit later
+// in one pass over what is still visible
+// written texels are tracked per 8x8 tile (the zbuffer's hi-z tiles, so a tile only ever
+// belongs to one rasterizer thread), the lighting pass only visits tiles marked written
+class GBuffer
+{
+public:
+	static constexpr int tileSize = ZBuffer::tileSize;
+public:
+	GBuffer( int width,int height )
+		:
+		width( width ),
+		height( height ),
+		tilesX( (width + tileSize - 1) / tileSize ),
+		tilesY( (height + tileSize - 1) / tileSize ),
+		texels( size_t( width ) * height,GBufferTexel{ {},{},{},std::numeric_limits<float>::quiet_NaN() } ),
+		written( size_t( tilesX ) * tilesY,(unsigned char)0 )
+	{}
+	GBufferTexel& At( int x,int y )
+	{
+		assert( x >= 0 );
+		assert( x < width );
+		assert( y >= 0 );
+		assert( y < height );
+		return texels[size_t( y ) * width + x];
+	}
+	// call for every texel written, so the lighting pass gets to its tile
+	void MarkWritten( int x,int y )
+	{
+		written[(y / tileSize) * tilesX + x / tileSize] = 1;
+	}
+	// whether anything in the tile was written since it was last taken (and clears that)
+	bool TakeWritten( int tx,int ty )
+	{
+		unsigned char& w = written[ty * tilesX + tx];
+		const bool was = w != 0;
+		w = 0;
+		return was;
+	}
+	int GetWidth() const
+	{
+		return width;
+	}
+	int GetHeight() const
+	{
+		return height;
+	}
+private:
+	int width;
+	int height;
+	int tilesX;
+	int tilesY;
+	std::vector<GBufferTexel> texels;
+	std::vector<unsigned char> written;
+};
\ No newline at end of file
@@ -22,11 +22,11 @@
 #include "Game.h"
 #include "Sphere.h"
 #include "TestTriangle.h"
-//#include "CubeSkinScene.h"
+#include "CubeSkinScene.h"
 //#include "CubeVertexColorScene.h"
 //#include "CubeSolidScene.h"
 //#include "DoubleCubeScene.h"
-//#include "VertexWaveScene.h"
+#include "VertexWaveScene.h"
 //#include "CubeVertexPositionColorScene.h"
 //#include "CubeSolidGeometryScene.h"
 //#include "CubeFlatIndependentScene.h"
@@ -35,6 +35,7 @@
 //#include "GouraudPointScene.h"
 //#include "PhongPointScene.h"
 #include "SpecularPhongPointScene.h"
+#include "ClusteredLightsScene.h"
 #include <sstream>
 
 Game::Game( MainWindow& wnd )
@@ -42,7 +43,10 @@ Game::Game( MainWindow& wnd )
 	wnd( wnd ),
 	gfx( wnd )
 {
-	scenes.push_back( std::make_unique<SpecularPhongPointScene>( gfx ) );
+	scenes.push_back( std::make_unique<SpecularPhongPointScene>( gfx,pPool ) );
+	scenes.push_back( std::make_unique<ClusteredLightsScene>( gfx,pPool ) );
+	scenes.push_back( std::make_unique<VertexWaveScene>( gfx ) );
+	scenes.push_back( std::make_unique<CubeSkinScene>( gfx,L"Images\\dice_skin.png" ) );
 	curScene = scenes.begin();
 	OutputSceneName();
 }
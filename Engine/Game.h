@@ -25,6 +25,7 @@
 #include <vector>
 #include "Scene.h"
 #include "FrameTimer.h"
+#include "ThreadPool.h"
 
 class Game
 {
@@ -48,6 +49,8 @@ private:
 	/********************************/
 	/*  User Variables              */
 	FrameTimer ft;
+	// one set of worker threads for all of the scenes
+	std::shared_ptr<ThreadPool> pPool = std::make_shared<ThreadPool>();
 	std::vector<std::unique_ptr<Scene>> scenes;
 	std::vector<std::unique_ptr<Scene>>::iterator curScene;
 	/********************************/
@@ -18,6 +18,7 @@
 *	You should have received a copy of the GNU General Public License					  *
 *	along with The Chili DirectX Framework.  If not, see <http://www.gnu.org/licenses/>.  *
 ******************************************************************************************/
+#ifndef CHILI_HEADLESS
 #include "MainWindow.h"
 #include "Graphics.h"
 #include "DXErr.h"
@@ -250,6 +251,11 @@ void Graphics::EndFrame()
 {
 	HRESULT hr;
 
+	for( auto& pass : endFramePasses )
+	{
+		pass.second();
+	}
+
 	// lock and map the adapter memory for copying over the sysbuffer
 	if( FAILED( hr = pImmediateContext->Map( pSysBufferTexture.Get(),0u,
 		D3D11_MAP_WRITE_DISCARD,0u,&mappedSysBufferTexture ) ) )
@@ -327,4 +333,5 @@ std::wstring Graphics::Exception::GetErrorDescription() const
 std::wstring Graphics::Exception::GetExceptionType() const
 {
 	return L"Chili Graphics Exception";
-}
\ No newline at end of file
+}
+#endif
\ No newline at end of file
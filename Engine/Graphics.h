@@ -19,19 +19,33 @@
 *	along with The Chili DirectX Framework.  If not, see <http://www.gnu.org/licenses/>.  *
 ******************************************************************************************/
 #pragma once
+// define CHILI_HEADLESS to build without a window / D3D11: frames are rendered into
+// the system memory buffer as usual and handed to a FrameSink at EndFrame
+#ifndef CHILI_HEADLESS
 #include <d3d11.h>
 #include <wrl.h>
 #include "GDIPlusManager.h"
+#else
+#include "FrameSink.h"
+#include <memory>
+#endif
 #include "ChiliException.h"
 #include "Surface.h"
 #include "Colors.h"
 #include "Vec2.h"
 #include "ZBuffer.h"
+#include <cmath>
+#include <functional>
+#include <vector>
+#include <utility>
 
+#ifndef CHILI_HEADLESS
 #define CHILI_GFX_EXCEPTION( hr,note ) Graphics::Exception( hr,note,_CRT_WIDE(__FILE__),__LINE__ )
+#endif
 
 class Graphics
 {
+#ifndef CHILI_HEADLESS
 public:
 	class Exception : public ChiliException
 	{
@@ -53,13 +67,31 @@ private:
 	};
 public:
 	Graphics( class HWNDKey& key );
+#else
+public:
+	Graphics( std::unique_ptr<FrameSink> pSink );
+	// finished frames go to the new sink from the next EndFrame on
+	void SetFrameSink( std::unique_ptr<FrameSink> pSink_in );
+#endif
 	Graphics( const Graphics& ) = delete;
 	Graphics& operator=( const Graphics& ) = delete;
 	void EndFrame();
+	// work that has to happen on the finished frame before it is presented (deferred
+	// lighting), EndFrame runs the passes in the order they were added
+	// returns a handle for RemoveEndFramePass, which the owner must call before going away
+	size_t AddEndFramePass( std::function<void()> pass )
+	{
+		endFramePasses.emplace_back( nextEndFramePass,std::move( pass ) );
+		return nextEndFramePass++;
+	}
+	void RemoveEndFramePass( size_t handle )
+	{
+		std::erase_if( endFramePasses,[handle]( const auto& p ) { return p.first == handle; } );
+	}
 	void BeginFrame();
 	void PutPixel( int x,int y,int r,int g,int b )
 	{
-		PutPixel( x,y,{ unsigned char( r ),unsigned char( g ),unsigned char( b ) } );
+		PutPixel( x,y,{ static_cast<unsigned char>( r ),static_cast<unsigned char>( g ),static_cast<unsigned char>( b ) } );
 	}
 	void PutPixel( int x,int y,Color c )
 	{
@@ -121,6 +153,7 @@ public:
 		}
 	}
 private:
+#ifndef CHILI_HEADLESS
 	GDIPlusManager										gdipMan;
 	Microsoft::WRL::ComPtr<IDXGISwapChain>				pSwapChain;
 	Microsoft::WRL::ComPtr<ID3D11Device>				pDevice;
@@ -134,7 +167,12 @@ private:
 	Microsoft::WRL::ComPtr<ID3D11InputLayout>			pInputLayout;
 	Microsoft::WRL::ComPtr<ID3D11SamplerState>			pSamplerState;
 	D3D11_MAPPED_SUBRESOURCE							mappedSysBufferTexture;
+#else
+	std::unique_ptr<FrameSink>							pSink;
+#endif
 	Surface												sysBuffer;
+	std::vector<std::pair<size_t,std::function<void()>>>	endFramePasses;
+	size_t												nextEndFramePass = 0;
 public:
 	static constexpr unsigned int ScreenWidth = 640u;
 	static constexpr unsigned int ScreenHeight = 480u;
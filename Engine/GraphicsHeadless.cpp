@@ -0,0 +1,57 @@
+/******************************************************************************************
+*	Chili DirectX Framework Version 16.10.01											  *
+*	GraphicsHeadless.cpp																  *
+*	Copyright 2016 PlanetChili <http://www.planetchili.net>								  *
+*																						  *
+*	This file is part of The Chili DirectX Framework.									  *
+*																						  *
+*	The Chili DirectX Framework is free software: you can redistribute it and/or modify	  *
+*	it under the terms of the GNU General Public License as published by				  *
+*	the Free Software Foundation, either version 3 of the License, or					  *
+*	(at your option) any later version.													  *
+*																						  *
+*	The Chili DirectX Framework is distributed in the hope that it will be useful,		  *
+*	but WITHOUT ANY WARRANTY; without even the implied warranty of						  *
+*	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the						  *
+*	GNU General Public License for more details.										  *
+*																						  *
+*	You should have received a copy of the GNU General Public License					  *
+*	along with The Chili DirectX Framework.  If not, see <http://www.gnu.org/licenses/>.  *
+******************************************************************************************/
+// Graphics without a window or gpu: frames are drawn into sysBuffer as usual
+// and EndFrame hands the finished frame to a FrameSink instead of presenting it
+#ifdef CHILI_HEADLESS
+#include "Graphics.h"
+#include <assert.h>
+
+Graphics::Graphics( std::unique_ptr<FrameSink> pSink )
+	:
+	pSink( std::move( pSink ) ),
+	sysBuffer( ScreenWidth,ScreenHeight )
+{
+	assert( this->pSink );
+}
+
+Graphics::~Graphics()
+{}
+
+void Graphics::SetFrameSink( std::unique_ptr<FrameSink> pSink_in )
+{
+	assert( pSink_in );
+	pSink = std::move( pSink_in );
+}
+
+void Graphics::EndFrame()
+{
+	for( auto& pass : endFramePasses )
+	{
+		pass.second();
+	}
+	pSink->Consume( sysBuffer );
+}
+
+void Graphics::BeginFrame()
+{
+	sysBuffer.Clear( Colors::Red );
+}
+#endif
\ No newline at end of file
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cassert>
+#include <limits>
+#include <algorithm>
+#include <utility>
+#include <iterator>
+#include <initializer_list>
+
+// triangle list indices, stored as 16 bit while every index fits and 32 bit otherwise
+// (starts out 16 bit and switches over on the first index that doesn't fit)
+class IndexBuffer
+{
+public:
+	enum class Format
+	{
+		U16,
+		U32
+	};
+public:
+	IndexBuffer() = default;
+	IndexBuffer( std::initializer_list<size_t> indices_in )
+	{
+		Append( indices_in.begin(),indices_in.end() );
+	}
+	IndexBuffer( const std::vector<size_t>& indices_in )
+	{
+		Append( indices_in.begin(),indices_in.end() );
+	}
+	Format GetFormat() const
+	{
+		return format;
+	}
+	size_t size() const
+	{
+		return format == Format::U16 ? indices16.size() : indices32.size();
+	}
+	bool empty() const
+	{
+		return size() == 0;
+	}
+	size_t GetSizeInBytes() const
+	{
+		return format == Format::U16 ? indices16.size() * sizeof( uint16_t ) : indices32.size() * sizeof( uint32_t );
+	}
+	void reserve( size_t n )
+	{
+		if( format == Format::U16 )
+		{
+			indices16.reserve( n );
+		}
+		else
+		{
+			indices32.reserve( n );
+		}
+	}
+	void push_back( size_t index )
+	{
+		assert( index <= std::numeric_limits<uint32_t>::max() );
+		if( format == Format::U16 && index > std::numeric_limits<uint16_t>::max() )
+		{
+			Widen();
+		}
+		if( format == Format::U16 )
+		{
+			indices16.push_back( uint16_t( index ) );
+		}
+		else
+		{
+			indices32.push_back( uint32_t( index ) );
+		}
+	}
+	// element access that checks the format on every call,
+	// use Visit for loops over the whole buffer
+	size_t operator[]( size_t i ) const
+	{
+		return format == Format::U16 ? size_t( indices16[i] ) : size_t( indices32[i] );
+	}
+	void Swap( size_t i,size_t j )
+	{
+		if( format == Format::U16 )
+		{
+			std::swap( indices16[i],indices16[j] );
+		}
+		else
+		{
+			std::swap( indices32[i],indices32[j] );
+		}
+	}
+	// raw index data, size() indices in the buffer's format
+	const void* GetData() const
+	{
+		return format == Format::U16 ? static_cast<const void*>( indices16.data() ) : static_cast<const void*>( indices32.data() );
+	}
+	// replaces the contents with count indices of the given format copied from pData
+	void Assign( Format format_in,const void* pData,size_t count )
+	{
+		format = format_in;
+		if( format == Format::U16 )
+		{
+			const auto p = static_cast<const uint16_t*>( pData );
+			indices16.assign( p,p + count );
+			indices32 = {};
+		}
+		else
+		{
+			const auto p = static_cast<const uint32_t*>( pData );
+			indices32.assign( p,p + count );
+			indices16 = {};
+		}
+	}
+	// calls f with the underlying std::vector<uint16_t> or std::vector<uint32_t>,
+	// so the format is only checked once for a whole pass over the indices
+	template<class F>
+	decltype(auto) Visit( F&& f ) const
+	{
+		if( format == Format::U16 )
+		{
+			return f( indices16 );
+		}
+		return f( indices32 );
+	}
+private:
+	template<class It>
+	void Append( It begin,It end )
+	{
+		reserve( size() + size_t( std::distance( begin,end ) ) );
+		for( ; begin != end; ++begin )
+		{
+			push_back( *begin );
+		}
+	}
+	void Widen()
+	{
+		indices32.reserve( std::max( indices16.capacity(),indices16.size() + 1 ) );
+		indices32.assign( indices16.begin(),indices16.end() );
+		indices16 = {};
+		format = Format::U32;
+	}
+private:
+	Format format = Format::U16;
+	std::vector<uint16_t> indices16;
+	std::vector<uint32_t> indices32;
+};
\ No newline at end of file
@@ -2,18 +2,33 @@
 
 #include <vector>
 #include "Vec3.h"
+#include "IndexBuffer.h"
+#include "BoundingSphere.h"
+#include "MeshCache.h"
+#include "MappedFile.h"
+#include "ObjReader.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
 #include "tiny_obj_loader.h"
 #include "Miniball.h"
 #include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
 #include <cctype>
 #include <algorithm>
+#include <optional>
+#include <cstring>
+#include <cstdio>
+#include <cmath>
+#include <type_traits>
 
 template<class T>
 class IndexedTriangleList
 {
 public:
 	IndexedTriangleList() = default;
-	IndexedTriangleList( std::vector<T> verts_in,std::vector<size_t> indices_in )
+	IndexedTriangleList( std::vector<T> verts_in,IndexBuffer indices_in )
 		:
 		vertices( std::move( verts_in ) ),
 		indices( std::move( indices_in ) )
@@ -21,14 +36,42 @@ public:
 		assert( vertices.size() > 2 );
 		assert( indices.size() % 3 == 0 );
 	}
-	static IndexedTriangleList<T> Load( const std::string& filename )
+	// loads positions from an obj file
+	// (goes through the binary mesh cache next to the file, see MeshCache)
+	// optimize runs Optimize with default options before the cache is written, and lodLevels
+	// runs BuildLods, so both only cost anything on the first load
+	static IndexedTriangleList<T> Load( const std::string& filename,bool optimize = false,size_t lodLevels = 0 )
+	{
+		return LoadCached( filename,MeshCache::Layout::Positions,optimize,lodLevels,&ReadObj );
+	}
+	// loads positions and normals from an obj file
+	// (goes through the binary mesh cache next to the file, see MeshCache)
+	static IndexedTriangleList<T> LoadNormals( const std::string& filename,bool optimize = false,size_t lodLevels = 0 )
+	{
+		return LoadCached( filename,MeshCache::Layout::PositionsNormals,optimize,lodLevels,&ReadObjNormals );
+	}
+	// obj parsing without the mesh cache through ObjReader (memory-mapped and tokenized in
+	// parallel), this is what Load/LoadNormals use when the cache is missing or stale
+	// unlike the tinyobj versions below, faces of every object in the file are taken
+	// (the models in models/ are single objects, benchmark --load-obj checks both give the same mesh)
+	static IndexedTriangleList<T> ReadObj( const std::string& filename,bool& isCCW )
+	{
+		return FromObjMesh<false>( ObjReader::Read( NativePath( filename ) ),isCCW );
+	}
+	static IndexedTriangleList<T> ReadObjNormals( const std::string& filename,bool& isCCW )
+	{
+		return FromObjMesh<true>( ObjReader::Read( NativePath( filename ) ),isCCW );
+	}
+	// obj parsing without the mesh cache through tinyobj (single threaded, iostreams)
+	// only the faces of the first object in the file are taken
+	static IndexedTriangleList<T> ParseObj( const std::string& filename,bool& isCCW )
 	{
 		IndexedTriangleList<T> tl;
 
 		// check first line of file to see if CCW winding comment exists
-		bool isCCW = false;
+		isCCW = false;
 		{
-			std::ifstream file( filename );
+			std::ifstream file( NativePath( filename ) );
 			std::string firstline;
 			std::getline( file,firstline );
 			std::transform(firstline.begin(), firstline.end(), firstline.begin(), [](char c) { return static_cast<char>(std::tolower(c)); });
@@ -45,7 +88,7 @@ public:
 		std::string err;
 
 		// load/parse the obj file
-		const bool ret = LoadObj( &attrib,&shapes,nullptr,&err,filename.c_str() );
+		const bool ret = LoadObj( &attrib,&shapes,nullptr,&err,NativePath( filename ).c_str() );
 
 		// check for errors
 		if( !err.empty() && err.substr( 0,4 ) != "WARN" )
@@ -94,7 +137,7 @@ public:
 				throw std::runtime_error( ss.str().c_str() );
 			}
 
-			// load set of 3 indices for each face into OUR index std::vector
+			// load set of 3 indices for each face into OUR index buffer
 			for( size_t vn = 0; vn < 3u; vn++ )
 			{
 				const auto idx = mesh.indices[f * 3u + vn];
@@ -105,20 +148,20 @@ public:
 			if( isCCW )
 			{
 				// swapping any two indices reverse the winding dir of triangle
-				std::swap( tl.indices.back(),*std::prev( tl.indices.end(),2 ) );
+				tl.indices.Swap( tl.indices.size() - 1,tl.indices.size() - 2 );
 			}
 		}
 
 		return tl;
 	}
-	static IndexedTriangleList<T> LoadNormals( const std::string& filename )
+	static IndexedTriangleList<T> ParseObjNormals( const std::string& filename,bool& isCCW )
 	{
 		IndexedTriangleList<T> tl;
 
 		// check first line of file to see if CCW winding comment exists
-		bool isCCW = false;
+		isCCW = false;
 		{
-			std::ifstream file( filename );
+			std::ifstream file( NativePath( filename ) );
 			std::string firstline;
 			std::getline( file,firstline );
 			std::transform( firstline.begin(),firstline.end(),firstline.begin(), [](char c) { return static_cast<char>(std::tolower(c)); });
@@ -135,7 +178,7 @@ public:
 		std::string err;
 
 		// load/parse the obj file
-		const bool ret = LoadObj( &attrib,&shapes,nullptr,&err,filename.c_str() );
+		const bool ret = LoadObj( &attrib,&shapes,nullptr,&err,NativePath( filename ).c_str() );
 
 		// check for errors
 		if( !err.empty() && err.substr( 0,4 ) != "WARN" )
@@ -184,7 +227,7 @@ public:
 				throw std::runtime_error( ss.str().c_str() );
 			}
 
-			// load set of 3 indices for each face into OUR index std::vector
+			// load set of 3 indices for each face into OUR index buffer
 			for( size_t vn = 0; vn < 3u; vn++ )
 			{
 				const auto idx = mesh.indices[f * 3u + vn];
@@ -201,19 +244,129 @@ public:
 			if( isCCW )
 			{
 				// swapping any two indices reverse the winding dir of triangle
-				std::swap( tl.indices.back(),*std::prev( tl.indices.end(),2 ) );
+				tl.indices.Swap( tl.indices.size() - 1,tl.indices.size() - 2 );
 			}
 		}
 
 		return tl;
 	}
-	void AdjustToTrueCenter()
+	// reorders triangles for post-transform vertex cache hits (and optionally so outward
+	// facing clusters get drawn first), then renumbers the vertices in order of first use
+	// the mesh itself doesn't change, only the order triangles and vertices are stored in
+	MeshOptimizer::Report Optimize( const MeshOptimizer::Options& options = {} )
+	{
+		MeshOptimizer::Report report;
+		indices.Visit( [&]( const auto& src )
+		{
+			using Index = typename std::decay_t<decltype( src )>::value_type;
+			report.acmrBefore = MeshOptimizer::ComputeAcmr( src,vertices.size(),options.cacheSize );
+			std::vector<uint32_t> clusterStarts;
+			auto order = MeshOptimizer::OrderTriangles( src,vertices.size(),options.cacheSize,clusterStarts );
+			if( options.overdraw )
+			{
+				order = MeshOptimizer::SortClustersForOverdraw( src,order,clusterStarts,
+					[this]( size_t i ) { return vertices[i].pos; } );
+			}
+			std::vector<Index> reordered;
+			reordered.reserve( src.size() );
+			for( const uint32_t t : order )
+			{
+				reordered.insert( reordered.end(),src.begin() + t * 3u,src.begin() + t * 3u + 3u );
+			}
+			// tipsify can lose to an order that was already good on odd meshes, keep the better one
+			if( MeshOptimizer::ComputeAcmr( reordered,vertices.size(),options.cacheSize ) > report.acmrBefore )
+			{
+				reordered.assign( src.begin(),src.end() );
+			}
+			const auto remap = MeshOptimizer::RemapVerticesByFirstUse( reordered,vertices.size() );
+			for( auto& index : reordered )
+			{
+				index = Index( remap[index] );
+			}
+			std::vector<T> remapped( vertices.size() );
+			for( size_t v = 0; v < vertices.size(); v++ )
+			{
+				remapped[remap[v]] = vertices[v];
+			}
+			vertices = std::move( remapped );
+			report.acmrAfter = MeshOptimizer::ComputeAcmr( reordered,vertices.size(),options.cacheSize );
+			indices.Assign( indices.GetFormat(),reordered.data(),reordered.size() );
+		} );
+		return report;
+	}
+	// simplified copy of the mesh with at most targetTriangles (see MeshSimplifier), made of a
+	// subset of the vertices as they are; its lodError adds the simplification error to this
+	// mesh's, and it keeps this mesh's bounds (which still enclose it)
+	IndexedTriangleList<T> Simplify( size_t targetTriangles ) const
+	{
+		IndexedTriangleList<T> tl;
+		indices.Visit( [&]( const auto& src )
+		{
+			const auto result = MeshSimplifier::Simplify( src,vertices.size(),targetTriangles,
+				[this]( size_t i ) { return vertices[i].pos; } );
+			// keep only the vertices still used, in order of first use
+			constexpr uint32_t unused = ~0u;
+			std::vector<uint32_t> remap( vertices.size(),unused );
+			tl.indices.reserve( result.indices.size() );
+			for( const uint32_t index : result.indices )
+			{
+				if( remap[index] == unused )
+				{
+					remap[index] = uint32_t( tl.vertices.size() );
+					tl.vertices.push_back( vertices[index] );
+				}
+				tl.indices.push_back( remap[index] );
+			}
+			tl.lodError = lodError + result.error;
+		} );
+		tl.bounds = bounds;
+		return tl;
+	}
+	// fills lods with up to levels simplified versions of the mesh, each with half the
+	// triangles of the one before (fewer if simplifying stops making any headway)
+	// optimize runs Optimize on each of them
+	void BuildLods( size_t levels,bool optimize = false )
+	{
+		lods.clear();
+		size_t target = indices.size() / 3u;
+		for( size_t i = 0; i < levels; i++ )
+		{
+			target /= 2u;
+			auto lod = Simplify( target );
+			const size_t previous = lods.empty() ? indices.size() : lods.back().indices.size();
+			if( lod.indices.size() >= previous || lod.indices.empty() )
+			{
+				break;
+			}
+			if( optimize )
+			{
+				lod.Optimize();
+			}
+			lods.push_back( std::move( lod ) );
+		}
+	}
+	// coarsest level of detail (this mesh or one of lods) whose lodError is at most maxError
+	const IndexedTriangleList<T>& GetLod( float maxError ) const
+	{
+		const IndexedTriangleList<T>* pLod = this;
+		for( const auto& lod : lods )
+		{
+			if( lod.lodError > maxError )
+			{
+				break;
+			}
+			pLod = &lod;
+		}
+		return *pLod;
+	}
+	// finds the minimal sphere enclosing the vertex positions (stored in bounds)
+	void ComputeBounds()
 	{
 		// used to enable miniball to access vertex pos info
 		struct VertexAccessor
 		{
 			// iterator type for iterating over vertices
-			typedef std::vector<T>::const_iterator Pit;
+			typedef typename std::vector<T>::const_iterator Pit;
 			// it type for iterating over components of vertex
 			// (pointer is used to iterate over members of class here)
 			typedef const float* Cit;
@@ -229,12 +382,30 @@ public:
 		// get center of min sphere
 		// result is a pointer to float[3] (what a shitty fuckin interface)
 		const auto pc = mb.center();
-		const Vec3 center = { *pc,*std::next( pc ),*std::next( pc,2 ) };
+		bounds = BoundingSphere{ { *pc,*std::next( pc ),*std::next( pc,2 ) },std::sqrt( float( mb.squared_radius() ) ) };
+	}
+	void AdjustToTrueCenter()
+	{
+		// meshes from the cache come with their bounds already solved
+		if( !bounds )
+		{
+			ComputeBounds();
+		}
+		const Vec3 center = bounds->center;
 		// adjust all vertices so that center of minimal sphere is at 0,0
 		for( auto& v : vertices )
 		{
 			v.pos -= center;
 		}
+		bounds->center = { 0.0f,0.0f,0.0f };
+		for( auto& lod : lods )
+		{
+			for( auto& v : lod.vertices )
+			{
+				v.pos -= center;
+			}
+			lod.bounds = bounds;
+		}
 	}
 	float GetRadius() const
 	{
@@ -246,6 +417,241 @@ public:
 				} 
 		)->pos.Len();
 	}
+private:
+	// loads from the mesh cache if it is there and up to date, otherwise parses
+	// the obj and writes the cache for next time
+	template<class Parse>
+	static IndexedTriangleList<T> LoadCached( const std::string& filename,MeshCache::Layout layout,bool optimize,size_t lodLevels,Parse parse )
+	{
+		const std::string path = NativePath( filename );
+		const std::string cachePath = MeshCache::GetPath( path,layout,optimize,lodLevels );
+		const auto stamp = MeshCache::GetSourceStamp( path );
+		IndexedTriangleList<T> tl;
+		if( tl.ReadCache( cachePath,layout,optimize,lodLevels,stamp ) )
+		{
+			return tl;
+		}
+		bool isCCW;
+		tl = parse( filename,isCCW );
+		if( optimize )
+		{
+			tl.Optimize();
+		}
+		tl.ComputeBounds();
+		tl.BuildLods( lodLevels,optimize );
+		tl.WriteCache( cachePath,layout,optimize,lodLevels,stamp,isCCW );
+		return tl;
+	}
+	// fills this list from a cache file, false if the file is missing or doesn't match
+	// (a cache whose source obj no longer exists is still used)
+	bool ReadCache( const std::string& cachePath,MeshCache::Layout layout,bool optimized,size_t lodLevels,const MeshCache::SourceStamp& stamp )
+	{
+		static_assert( std::is_trivially_copyable_v<T>,"cached vertices are stored as raw bytes" );
+		const MappedFile file( cachePath );
+		if( !file.IsOpen() || file.GetSize() < sizeof( MeshCache::Header ) )
+		{
+			return false;
+		}
+		MeshCache::Header h;
+		std::memcpy( &h,file.GetData(),sizeof( h ) );
+		if( !std::equal( std::begin( h.magic ),std::end( h.magic ),MeshCache::magic ) ||
+			h.version != MeshCache::version ||
+			h.layout != uint32_t( layout ) ||
+			h.vertexSize != sizeof( T ) ||
+			h.vertexTypeHash != MeshCache::GetVertexTypeHash<T>() ||
+			h.optimized != (optimized ? 1u : 0u) ||
+			h.lodLevels != uint32_t( lodLevels ) ||
+			h.lodCount > h.lodLevels ||
+			(stamp.size != 0 && !(stamp == MeshCache::SourceStamp{ h.sourceSize,h.sourceTime })) )
+		{
+			return false;
+		}
+		size_t offset = MeshCache::AlignUp( sizeof( MeshCache::Header ) );
+		if( !ReadMeshData( file,offset,h.vertexCount,h.indexCount,h.indexFormat ) )
+		{
+			return false;
+		}
+		bounds = BoundingSphere{ { h.boundsCenter[0],h.boundsCenter[1],h.boundsCenter[2] },h.boundsRadius };
+		lods.resize( h.lodCount );
+		for( auto& lod : lods )
+		{
+			MeshCache::LodHeader lh;
+			if( offset + sizeof( lh ) > file.GetSize() )
+			{
+				return false;
+			}
+			std::memcpy( &lh,file.GetData() + offset,sizeof( lh ) );
+			offset = MeshCache::AlignUp( offset + sizeof( lh ) );
+			if( !lod.ReadMeshData( file,offset,lh.vertexCount,lh.indexCount,lh.indexFormat ) )
+			{
+				return false;
+			}
+			lod.lodError = lh.error;
+			lod.bounds = bounds;
+		}
+		return true;
+	}
+	// vertices then indices of one mesh in the cache, from offset (left at the end of them)
+	bool ReadMeshData( const MappedFile& file,size_t& offset,uint64_t vertexCount,uint64_t indexCount,uint32_t indexFormat )
+	{
+		if( indexFormat > 1u )
+		{
+			return false;
+		}
+		const size_t indexSize = indexFormat == 0u ? sizeof( uint16_t ) : sizeof( uint32_t );
+		// bound the counts by the file size first so the byte sizes below can't overflow
+		if( vertexCount > file.GetSize() / sizeof( T ) || indexCount > file.GetSize() / indexSize ||
+			indexCount % 3u != 0u )
+		{
+			return false;
+		}
+		const size_t vertexOffset = offset;
+		const size_t indexOffset = MeshCache::AlignUp( vertexOffset + size_t( vertexCount ) * sizeof( T ) );
+		if( indexOffset > file.GetSize() || size_t( indexCount ) * indexSize > file.GetSize() - indexOffset )
+		{
+			return false;
+		}
+		offset = indexOffset + size_t( indexCount ) * indexSize;
+		// straight copies out of the mapping, no parsing
+		vertices.resize( size_t( vertexCount ) );
+		std::memcpy( vertices.data(),file.GetData() + vertexOffset,vertices.size() * sizeof( T ) );
+		indices.Assign( indexFormat == 0u ? IndexBuffer::Format::U16 : IndexBuffer::Format::U32,
+			file.GetData() + indexOffset,size_t( indexCount ) );
+		// a corrupt index would read past the vertices later, so reparse instead
+		const bool inRange = indices.Visit( [&]( const auto& v )
+		{
+			return std::all_of( v.begin(),v.end(),[&]( auto i ) { return size_t( i ) < vertices.size(); } );
+		} );
+		if( !inRange )
+		{
+			return false;
+		}
+		offset = MeshCache::AlignUp( offset );
+		return true;
+	}
+	// best effort, a cache that can't be written just means parsing again next time
+	void WriteCache( const std::string& cachePath,MeshCache::Layout layout,bool optimized,size_t lodLevels,const MeshCache::SourceStamp& stamp,bool isCCW ) const
+	{
+		std::ofstream file( cachePath,std::ios::binary );
+		if( !file )
+		{
+			return;
+		}
+		MeshCache::Header h = {};
+		std::copy( std::begin( MeshCache::magic ),std::end( MeshCache::magic ),h.magic );
+		h.version = MeshCache::version;
+		h.layout = uint32_t( layout );
+		h.vertexSize = sizeof( T );
+		h.vertexTypeHash = MeshCache::GetVertexTypeHash<T>();
+		h.sourceSize = stamp.size;
+		h.sourceTime = stamp.time;
+		h.vertexCount = vertices.size();
+		h.indexCount = indices.size();
+		h.indexFormat = GetCacheIndexFormat();
+		h.ccw = isCCW ? 1u : 0u;
+		h.optimized = optimized ? 1u : 0u;
+		h.boundsCenter[0] = bounds->center.x;
+		h.boundsCenter[1] = bounds->center.y;
+		h.boundsCenter[2] = bounds->center.z;
+		h.boundsRadius = bounds->radius;
+		h.lodLevels = uint32_t( lodLevels );
+		h.lodCount = uint32_t( lods.size() );
+		WriteCacheData( file,&h,sizeof( h ) );
+		WriteMeshData( file );
+		for( const auto& lod : lods )
+		{
+			MeshCache::LodHeader lh = {};
+			lh.vertexCount = lod.vertices.size();
+			lh.indexCount = lod.indices.size();
+			lh.indexFormat = lod.GetCacheIndexFormat();
+			lh.error = lod.lodError;
+			WriteCacheData( file,&lh,sizeof( lh ) );
+			lod.WriteMeshData( file );
+		}
+		if( !file )
+		{
+			file.close();
+			std::remove( cachePath.c_str() );
+		}
+	}
+	void WriteMeshData( std::ofstream& file ) const
+	{
+		WriteCacheData( file,vertices.data(),vertices.size() * sizeof( T ) );
+		WriteCacheData( file,indices.GetData(),indices.GetSizeInBytes() );
+	}
+	// writes size bytes padded out to the cache's data alignment
+	static void WriteCacheData( std::ofstream& file,const void* pData,size_t size )
+	{
+		const char padding[MeshCache::dataAlignment] = {};
+		file.write( static_cast<const char*>( pData ),std::streamsize( size ) );
+		file.write( padding,std::streamsize( MeshCache::AlignUp( size ) - size ) );
+	}
+	uint32_t GetCacheIndexFormat() const
+	{
+		return indices.GetFormat() == IndexBuffer::Format::U16 ? 0u : 1u;
+	}
+	template<bool withNormals>
+	static IndexedTriangleList<T> FromObjMesh( const ObjReader::Mesh& mesh,bool& isCCW )
+	{
+		IndexedTriangleList<T> tl;
+		isCCW = mesh.isCCW;
+		tl.vertices.reserve( mesh.positions.size() / 3u );
+		for( size_t i = 0; i < mesh.positions.size(); i += 3 )
+		{
+			tl.vertices.emplace_back( Vec3{
+				mesh.positions[i + 0],
+				mesh.positions[i + 1],
+				mesh.positions[i + 2]
+			} );
+		}
+		tl.indices.reserve( mesh.refs.size() );
+		for( size_t i = 0; i < mesh.refs.size(); i += 3 )
+		{
+			for( size_t j = 0; j < 3u; j++ )
+			{
+				const auto& ref = mesh.refs[i + j];
+				tl.indices.push_back( size_t( ref.v ) );
+				// write normals into the vertices
+				if constexpr( withNormals )
+				{
+					if( ref.vn >= 0 )
+					{
+						const size_t n = 3u * size_t( ref.vn );
+						tl.vertices[size_t( ref.v )].n = Vec3{
+							mesh.normals[n + 0],
+							mesh.normals[n + 1],
+							mesh.normals[n + 2]
+						};
+					}
+				}
+			}
+			// reverse winding if file marked as CCW
+			if( isCCW )
+			{
+				// swapping any two indices reverse the winding dir of triangle
+				tl.indices.Swap( tl.indices.size() - 1,tl.indices.size() - 2 );
+			}
+		}
+		return tl;
+	}
+	// model paths in the code use windows separators ("models\\suzanne.obj")
+	static std::string NativePath( std::string path )
+	{
+#ifndef _WIN32
+		std::replace( path.begin(),path.end(),'\\','/' );
+#endif
+		return path;
+	}
+public:
 	std::vector<T> vertices;
-	std::vector<size_t> indices;
+	IndexBuffer indices;
+	// minimal sphere enclosing the vertex positions, if it has been worked out
+	// (whoever moves vertices around afterwards is responsible for keeping it right)
+	std::optional<BoundingSphere> bounds;
+	// lower detail versions of the mesh, coarser going down the list (see BuildLods)
+	// Pipeline::SetLodSelection has draws pick one by how big the mesh is on screen
+	std::vector<IndexedTriangleList<T>> lods;
+	// for a level of detail, how far (model units) its surface may be from the mesh it was
+	// simplified from, 0 for a full detail mesh
+	float lodError = 0.0f;
 };
\ No newline at end of file
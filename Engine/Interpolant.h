@@ -0,0 +1,241 @@
+#pragma once
+
+#include <tuple>
+#include <cstddef>
+#include <type_traits>
+#include "Vec2.h"
+#include "Vec3.h"
+#include "Vec4.h"
+#include "FloatPacket.h"
+
+// arithmetic for vertex types that get interpolated across triangles (vertex shader outputs)
+// the type declares the attributes it carries besides pos once,
+//   static constexpr auto Attributes()
+//   {
+//       return std::make_tuple( &VSOutput::n,&VSOutput::worldPos );
+//   }
+// and derives from Interpolant<VSOutput> to get +, -, * and / (and the assignment forms) on
+// pos and those attributes; members not listed (a flat color say) are left as they are
+template<class Derived>
+class Interpolant
+{
+public:
+	// calls f( pointer to member ) for pos and then each attribute
+	template<class F>
+	static void ForEachAttribute( F&& f )
+	{
+		f( &Derived::pos );
+		std::apply( [&f]( auto... members )
+		{
+			(f( members ),...);
+		},Derived::Attributes() );
+	}
+	Derived& operator+=( const Derived& rhs )
+	{
+		Derived& self = static_cast<Derived&>( *this );
+		ForEachAttribute( [&]( auto m ) { self.*m += rhs.*m; } );
+		return self;
+	}
+	Derived operator+( const Derived& rhs ) const
+	{
+		return Derived( static_cast<const Derived&>( *this ) ) += rhs;
+	}
+	Derived& operator-=( const Derived& rhs )
+	{
+		Derived& self = static_cast<Derived&>( *this );
+		ForEachAttribute( [&]( auto m ) { self.*m -= rhs.*m; } );
+		return self;
+	}
+	Derived operator-( const Derived& rhs ) const
+	{
+		return Derived( static_cast<const Derived&>( *this ) ) -= rhs;
+	}
+	Derived& operator*=( float rhs )
+	{
+		Derived& self = static_cast<Derived&>( *this );
+		ForEachAttribute( [&]( auto m ) { self.*m *= rhs; } );
+		return self;
+	}
+	Derived operator*( float rhs ) const
+	{
+		return Derived( static_cast<const Derived&>( *this ) ) *= rhs;
+	}
+	Derived& operator/=( float rhs )
+	{
+		Derived& self = static_cast<Derived&>( *this );
+		ForEachAttribute( [&]( auto m ) { self.*m /= rhs; } );
+		return self;
+	}
+	Derived operator/( float rhs ) const
+	{
+		return Derived( static_cast<const Derived&>( *this ) ) /= rhs;
+	}
+};
+
+// how an attribute flattens to floats (for InterpolantBlock)
+template<class T>
+struct AttributeLayout;
+template<>
+struct AttributeLayout<float>
+{
+	static constexpr size_t size = 1;
+	static void Store( const float& a,float* p )
+	{
+		p[0] = a;
+	}
+	static void Load( const float* p,float& a )
+	{
+		a = p[0];
+	}
+};
+template<>
+struct AttributeLayout<Vec2>
+{
+	static constexpr size_t size = 2;
+	static void Store( const Vec2& a,float* p )
+	{
+		p[0] = a.x;
+		p[1] = a.y;
+	}
+	static void Load( const float* p,Vec2& a )
+	{
+		a.x = p[0];
+		a.y = p[1];
+	}
+};
+template<>
+struct AttributeLayout<Vec3>
+{
+	static constexpr size_t size = 3;
+	static void Store( const Vec3& a,float* p )
+	{
+		p[0] = a.x;
+		p[1] = a.y;
+		p[2] = a.z;
+	}
+	static void Load( const float* p,Vec3& a )
+	{
+		a.x = p[0];
+		a.y = p[1];
+		a.z = p[2];
+	}
+};
+template<>
+struct AttributeLayout<Vec4>
+{
+	static constexpr size_t size = 4;
+	static void Store( const Vec4& a,float* p )
+	{
+		p[0] = a.x;
+		p[1] = a.y;
+		p[2] = a.z;
+		p[3] = a.w;
+	}
+	static void Load( const float* p,Vec4& a )
+	{
+		a.x = p[0];
+		a.y = p[1];
+		a.z = p[2];
+		a.w = p[3];
+	}
+};
+
+// layout of the attribute a pointer to member points to
+template<class Member>
+struct MemberLayout;
+template<class T,class C>
+struct MemberLayout<T C::*> : AttributeLayout<T>
+{};
+
+// an Interpolant packed for the rasterizers' inner loops: pos.z, pos.w and then the
+// attributes flattened to floats, padded out to whole FloatPackets, so that stepping it
+// from pixel to pixel is a few packet adds whatever the attributes are
+// pos.x / pos.y are left out (the rasterizers know where their pixels are), and nothing gets
+// unpacked until the pixel is known to be shaded
+// per float the math is the same as V's own operators, so results are bit for bit the same
+template<class V>
+class InterpolantBlock
+{
+private:
+	template<class Members>
+	struct Floats;
+	template<class... Members>
+	struct Floats<std::tuple<Members...>>
+	{
+		static constexpr size_t size = (size_t( 0 ) + ... + MemberLayout<Members>::size);
+	};
+public:
+	// floats in use, the rest of the last packet is padding
+	static constexpr size_t floatCount = 2u + Floats<decltype( V::Attributes() )>::size;
+	static constexpr size_t packetCount = (floatCount + FloatPacket::size - 1u) / FloatPacket::size;
+public:
+	InterpolantBlock() = default;
+	explicit InterpolantBlock( const V& v )
+	{
+		alignas( 16 ) float floats[packetCount * FloatPacket::size] = {};
+		floats[0] = v.pos.z;
+		floats[1] = v.pos.w;
+		float* p = floats + 2;
+		std::apply( [&]( auto... members )
+		{
+			((MemberLayout<decltype( members )>::Store( v.*members,p ),p += MemberLayout<decltype( members )>::size),...);
+		},V::Attributes() );
+		for( size_t i = 0; i < packetCount; i++ )
+		{
+			packets[i] = _mm_load_ps( floats + i * FloatPacket::size );
+		}
+	}
+	InterpolantBlock& operator+=( const InterpolantBlock& rhs )
+	{
+		for( size_t i = 0; i < packetCount; i++ )
+		{
+			packets[i] += rhs.packets[i];
+		}
+		return *this;
+	}
+	InterpolantBlock operator+( const InterpolantBlock& rhs ) const
+	{
+		return InterpolantBlock( *this ) += rhs;
+	}
+	InterpolantBlock& operator*=( float rhs )
+	{
+		const FloatPacket s = rhs;
+		for( size_t i = 0; i < packetCount; i++ )
+		{
+			packets[i] *= s;
+		}
+		return *this;
+	}
+	InterpolantBlock operator*( float rhs ) const
+	{
+		return InterpolantBlock( *this ) *= rhs;
+	}
+	// the interpolated pos.z / pos.w
+	float Z() const
+	{
+		return _mm_cvtss_f32( packets[0].v );
+	}
+	float W() const
+	{
+		return _mm_cvtss_f32( _mm_shuffle_ps( packets[0].v,packets[0].v,_MM_SHUFFLE( 1,1,1,1 ) ) );
+	}
+	// back to a V, with pos.x / pos.y given and members that aren't attributes copied from flat
+	V Unpack( const V& flat,float x,float y ) const
+	{
+		alignas( 16 ) float floats[packetCount * FloatPacket::size];
+		for( size_t i = 0; i < packetCount; i++ )
+		{
+			_mm_store_ps( floats + i * FloatPacket::size,packets[i].v );
+		}
+		V v = flat;
+		v.pos = { x,y,floats[0],floats[1] };
+		const float* p = floats + 2;
+		std::apply( [&]( auto... members )
+		{
+			((MemberLayout<decltype( members )>::Load( p,v.*members ),p += MemberLayout<decltype( members )>::size),...);
+		},V::Attributes() );
+		return v;
+	}
+private:
+	FloatPacket packets[packetCount];
+};
\ No newline at end of file
@@ -25,6 +25,7 @@
 class Keyboard
 {
 	friend class MainWindow;
+	friend class ScriptedInput;
 public:
 	class Event
 	{
@@ -0,0 +1,176 @@
+#pragma once
+
+#include "Vec3.h"
+#include "Mat.h"
+#include <vector>
+#include <span>
+#include <algorithm>
+#include <cmath>
+
+// point light in view space, contributes nothing beyond radius
+struct PointLight
+{
+	Vec3 pos;
+	Vec3 color;
+	float radius;
+};
+
+// point lights binned into clusters of the view frustum: a grid of screen tiles, each split
+// into depth slices that get exponentially thicker with distance (so clusters stay roughly cube
+// shaped), built once per frame so a pixel shader only loops over the lights that can reach
+// the cluster its view space position falls into
+class LightClusters
+{
+public:
+	static constexpr int tilesX = 16;
+	static constexpr int tilesY = 12;
+	static constexpr int slices = 16;
+	static constexpr int clusterCount = tilesX * tilesY * slices;
+public:
+	// bins the lights (view space) for the given projection (Mat4::Projection / ProjectionHFOV)
+	void Build( const std::vector<PointLight>& lights_in,const Mat4& proj )
+	{
+		lights = lights_in;
+		xScale = proj.elements[0][0];
+		yScale = proj.elements[1][1];
+		// near / far planes back out of the depth mapping z' = (z * f - n * f) / (f - n)
+		zNear = -proj.elements[3][2] / proj.elements[2][2];
+		zFar = proj.elements[3][2] / (1.0f - proj.elements[2][2]);
+		sliceScale = float( slices ) / std::log( zFar / zNear );
+
+		// cluster ranges of each light, counted per cluster, then laid out cluster by cluster
+		// (lights go in in order, so each cluster's list is sorted)
+		ranges.clear();
+		std::fill( offsets.begin(),offsets.end(),0u );
+		for( unsigned int i = 0; i < (unsigned int)lights.size(); i++ )
+		{
+			Range r;
+			if( GetRange( lights[i],r ) )
+			{
+				r.light = i;
+				ranges.push_back( r );
+				ForEachCluster( r,[this]( int c ) { offsets[c + 1]++; } );
+			}
+		}
+		for( int c = 0; c < clusterCount; c++ )
+		{
+			offsets[c + 1] += offsets[c];
+		}
+		indices.resize( offsets[clusterCount] );
+		fill.assign( offsets.begin(),offsets.end() - 1 );
+		for( const auto& r : ranges )
+		{
+			ForEachCluster( r,[this,&r]( int c ) { indices[fill[c]++] = r.light; } );
+		}
+	}
+	// cluster that view space position p falls into (positions outside the frustum
+	// go to the nearest cluster, which has every light that reaches into it)
+	int GetCluster( const Vec3& p ) const
+	{
+		const float zInv = 1.0f / std::max( p.z,zNear );
+		const int tx = Tile( p.x * xScale * zInv,tilesX );
+		const int ty = Tile( p.y * yScale * zInv,tilesY );
+		const int slice = Slice( std::max( p.z,zNear ) );
+		return (slice * tilesY + ty) * tilesX + tx;
+	}
+	// indices of the lights that reach into cluster c, ascending
+	std::span<const unsigned int> GetClusterLights( int c ) const
+	{
+		return { indices.data() + offsets[c],indices.data() + offsets[c + 1] };
+	}
+	std::span<const unsigned int> GetLights( const Vec3& p ) const
+	{
+		return GetClusterLights( GetCluster( p ) );
+	}
+	const PointLight& GetLight( unsigned int i ) const
+	{
+		return lights[i];
+	}
+	size_t GetLightCount() const
+	{
+		return lights.size();
+	}
+	// cluster / light pairs, i.e. the total length of all the clusters' light lists
+	size_t GetEntryCount() const
+	{
+		return indices.size();
+	}
+private:
+	// clusters a light's sphere can touch, a box in tile / slice coordinates (inclusive)
+	struct Range
+	{
+		int x0,x1;
+		int y0,y1;
+		int s0,s1;
+		unsigned int light;
+	};
+	// false if the light can't reach into the frustum
+	bool GetRange( const PointLight& l,Range& r ) const
+	{
+		const float z0 = std::max( l.pos.z - l.radius,zNear );
+		const float z1 = std::min( l.pos.z + l.radius,zFar );
+		if( z0 > z1 )
+		{
+			return false;
+		}
+		// x / z over the sphere's bounding box is smallest at the near or far end of it
+		// depending on the sign of x (same for the largest, and for y)
+		const auto Extent = [z0,z1]( float lo,float hi,float scale,float& ndcLo,float& ndcHi )
+		{
+			ndcLo = lo * scale / (lo >= 0.0f ? z1 : z0);
+			ndcHi = hi * scale / (hi >= 0.0f ? z0 : z1);
+			return ndcHi >= -1.0f && ndcLo <= 1.0f;
+		};
+		float xLo,xHi,yLo,yHi;
+		if( !Extent( l.pos.x - l.radius,l.pos.x + l.radius,xScale,xLo,xHi ) ||
+			!Extent( l.pos.y - l.radius,l.pos.y + l.radius,yScale,yLo,yHi ) )
+		{
+			return false;
+		}
+		r.x0 = Tile( xLo,tilesX );
+		r.x1 = Tile( xHi,tilesX );
+		r.y0 = Tile( yLo,tilesY );
+		r.y1 = Tile( yHi,tilesY );
+		r.s0 = Slice( z0 );
+		r.s1 = Slice( z1 );
+		return true;
+	}
+	template<class F>
+	static void ForEachCluster( const Range& r,F&& f )
+	{
+		for( int s = r.s0; s <= r.s1; s++ )
+		{
+			for( int y = r.y0; y <= r.y1; y++ )
+			{
+				for( int x = r.x0; x <= r.x1; x++ )
+				{
+					f( (s * tilesY + y) * tilesX + x );
+				}
+			}
+		}
+	}
+	// depth slice of view space depth z (>= near)
+	int Slice( float z ) const
+	{
+		return std::min( int( std::log( z / zNear ) * sliceScale ),slices - 1 );
+	}
+	// tile of a -1..1 ndc coordinate (clamped, so anything off screen is in an edge tile)
+	static int Tile( float ndc,int count )
+	{
+		// clamp in float first, ndc can be far outside -1..1
+		return int( std::clamp( (ndc * 0.5f + 0.5f) * float( count ),0.0f,float( count - 1 ) ) );
+	}
+private:
+	std::vector<PointLight> lights;
+	float xScale = 1.0f;
+	float yScale = 1.0f;
+	float zNear = 1.0f;
+	float zFar = 2.0f;
+	float sliceScale = 1.0f;
+	// light list of cluster c is indices[offsets[c]] .. indices[offsets[c + 1]]
+	std::vector<unsigned int> offsets = std::vector<unsigned int>( clusterCount + 1,0u );
+	std::vector<unsigned int> indices;
+	// build scratch
+	std::vector<Range> ranges;
+	std::vector<unsigned int> fill;
+};
\ No newline at end of file
@@ -0,0 +1,82 @@
+#ifdef _WIN32
+#include "ChiliWin.h"
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#include "MappedFile.h"
+
+#ifdef _WIN32
+MappedFile::MappedFile( const std::string& path )
+{
+	hFile = CreateFileA( path.c_str(),GENERIC_READ,FILE_SHARE_READ,nullptr,
+		OPEN_EXISTING,FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,nullptr );
+	if( hFile == INVALID_HANDLE_VALUE )
+	{
+		hFile = nullptr;
+		return;
+	}
+	LARGE_INTEGER fileSize;
+	if( !GetFileSizeEx( hFile,&fileSize ) || fileSize.QuadPart == 0 )
+	{
+		return;
+	}
+	hMapping = CreateFileMappingA( hFile,nullptr,PAGE_READONLY,0,0,nullptr );
+	if( hMapping == nullptr )
+	{
+		return;
+	}
+	pData = static_cast<const unsigned char*>( MapViewOfFile( hMapping,FILE_MAP_READ,0,0,0 ) );
+	if( pData != nullptr )
+	{
+		size = size_t( fileSize.QuadPart );
+	}
+}
+
+MappedFile::~MappedFile()
+{
+	if( pData != nullptr )
+	{
+		UnmapViewOfFile( pData );
+	}
+	if( hMapping != nullptr )
+	{
+		CloseHandle( hMapping );
+	}
+	if( hFile != nullptr )
+	{
+		CloseHandle( hFile );
+	}
+}
+#else
+MappedFile::MappedFile( const std::string& path )
+{
+	const int fd = open( path.c_str(),O_RDONLY );
+	if( fd < 0 )
+	{
+		return;
+	}
+	struct stat st;
+	if( fstat( fd,&st ) == 0 && st.st_size > 0 )
+	{
+		void* const p = mmap( nullptr,size_t( st.st_size ),PROT_READ,MAP_PRIVATE,fd,0 );
+		if( p != MAP_FAILED )
+		{
+			pData = static_cast<const unsigned char*>( p );
+			size = size_t( st.st_size );
+		}
+	}
+	// the mapping keeps its own reference to the file
+	close( fd );
+}
+
+MappedFile::~MappedFile()
+{
+	if( pData != nullptr )
+	{
+		munmap( const_cast<unsigned char*>( pData ),size );
+	}
+}
+#endif
\ No newline at end of file
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+
+// read-only memory mapping of a whole file
+// (the contents are paged in by the os on first touch instead of read through a stream)
+class MappedFile
+{
+public:
+	// check IsOpen to see whether it worked (a missing file is not an error here)
+	MappedFile( const std::string& path );
+	MappedFile( const MappedFile& ) = delete;
+	MappedFile& operator=( const MappedFile& ) = delete;
+	~MappedFile();
+	bool IsOpen() const
+	{
+		return pData != nullptr;
+	}
+	const unsigned char* GetData() const
+	{
+		return pData;
+	}
+	size_t GetSize() const
+	{
+		return size;
+	}
+private:
+	const unsigned char* pData = nullptr;
+	size_t size = 0;
+#ifdef _WIN32
+	void* hFile = nullptr;
+	void* hMapping = nullptr;
+#endif
+};
\ No newline at end of file
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <filesystem>
+#include <system_error>
+#include <typeinfo>
+
+// binary mesh cache file format, written next to an obj the first time it is loaded
+// and used instead of parsing the obj on later loads
+//   Header
+//   vertices (vertexCount * vertexSize bytes, raw vertex structs), at dataAlignment
+//   indices (indexCount 16 or 32 bit ints), at dataAlignment
+//   lodCount times (levels of detail, see IndexedTriangleList::BuildLods):
+//     LodHeader, at dataAlignment
+//     its vertices and indices, as above
+// vertices are stored in the in-memory layout of the vertex type that loaded them,
+// so a cache is only good for the same loader, vertex type and build; anything that
+// doesn't match (or a source obj that changed since) makes the loader re-parse the obj
+// and overwrite the cache
+class MeshCache
+{
+public:
+	static constexpr uint32_t version = 4;
+	static constexpr size_t dataAlignment = 16;
+	// which obj loader filled in the vertices
+	enum class Layout : uint32_t
+	{
+		Positions = 1,
+		PositionsNormals = 2
+	};
+	// size and modification time of the source obj when the cache was written
+	struct SourceStamp
+	{
+		uint64_t size = 0;
+		int64_t time = 0;
+		bool operator==( const SourceStamp& rhs ) const
+		{
+			return size == rhs.size && time == rhs.time;
+		}
+	};
+	struct Header
+	{
+		char magic[4];
+		uint32_t version;
+		uint32_t layout;
+		uint32_t vertexSize;
+		uint64_t vertexTypeHash;
+		uint64_t sourceSize;
+		int64_t sourceTime;
+		uint64_t vertexCount;
+		uint64_t indexCount;
+		// 0 = 16 bit, 1 = 32 bit
+		uint32_t indexFormat;
+		// obj was marked ccw (already reversed in the stored indices)
+		uint32_t ccw;
+		// triangles / vertices were reordered by IndexedTriangleList::Optimize
+		uint32_t optimized;
+		float boundsCenter[3];
+		float boundsRadius;
+		// levels of detail asked for, and how many of them BuildLods made
+		uint32_t lodLevels;
+		uint32_t lodCount;
+	};
+	struct LodHeader
+	{
+		uint64_t vertexCount;
+		uint64_t indexCount;
+		// 0 = 16 bit, 1 = 32 bit
+		uint32_t indexFormat;
+		// IndexedTriangleList::lodError
+		float error;
+	};
+	static constexpr char magic[4] = { 'C','M','S','H' };
+public:
+	static std::string GetPath( const std::string& objPath,Layout layout,bool optimized,size_t lodLevels = 0 )
+	{
+		return objPath + (layout == Layout::Positions ? ".pos" : ".posnorm") + (optimized ? ".opt" : "") +
+			(lodLevels > 0 ? ".lod" + std::to_string( lodLevels ) : "") + ".meshcache";
+	}
+	// stamp of a file that doesn't exist is all zeros
+	static SourceStamp GetSourceStamp( const std::string& path )
+	{
+		SourceStamp stamp;
+		std::error_code ec;
+		const auto size = std::filesystem::file_size( path,ec );
+		if( ec )
+		{
+			return stamp;
+		}
+		const auto time = std::filesystem::last_write_time( path,ec );
+		if( ec )
+		{
+			return stamp;
+		}
+		stamp.size = uint64_t( size );
+		stamp.time = int64_t( time.time_since_epoch().count() );
+		return stamp;
+	}
+	// identifies the vertex type within one build (fnv-1a of its type name)
+	template<class T>
+	static uint64_t GetVertexTypeHash()
+	{
+		uint64_t h = 14695981039346656037ull;
+		for( const char* p = typeid( T ).name(); *p != '\0'; p++ )
+		{
+			h = (h ^ uint64_t( (unsigned char)*p )) * 1099511628211ull;
+		}
+		return h;
+	}
+	static constexpr size_t AlignUp( size_t offset )
+	{
+		return (offset + dataAlignment - 1) & ~(dataAlignment - 1);
+	}
+};
\ No newline at end of file
@@ -0,0 +1,268 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include <numeric>
+#include "Vec3.h"
+
+// reordering passes for indexed triangle lists (applied through IndexedTriangleList::Optimize)
+// all of them only change the order of triangles / vertices, never the mesh itself
+class MeshOptimizer
+{
+public:
+	struct Options
+	{
+		// fifo post-transform cache size the triangle order is tuned for
+		size_t cacheSize = 16;
+		// also sort clusters of triangles so outward facing ones come first
+		bool overdraw = true;
+	};
+	// average cache miss ratio (vertex shader invocations per triangle), before and after
+	struct Report
+	{
+		double acmrBefore;
+		double acmrAfter;
+	};
+public:
+	// acmr of the index order with a fifo cache of cacheSize entries
+	// (same policy as PostTransformCache::Policy::Fifo)
+	// 3 is the worst possible, around 0.5-0.7 is good for a regular closed mesh
+	template<class Index>
+	static double ComputeAcmr( const std::vector<Index>& indices,size_t vertexCount,size_t cacheSize )
+	{
+		if( indices.empty() )
+		{
+			return 0.0;
+		}
+		// a vertex is in the cache if fewer than cacheSize misses came after the one that loaded it
+		// (loadedAt is that miss's number, counting from 1)
+		std::vector<size_t> loadedAt( vertexCount,0 );
+		size_t misses = 0;
+		for( const auto index : indices )
+		{
+			if( loadedAt[index] == 0 || misses - loadedAt[index] >= cacheSize )
+			{
+				misses++;
+				loadedAt[index] = misses;
+			}
+		}
+		return double( misses ) / double( indices.size() / 3u );
+	}
+	// triangle order for a fifo vertex cache, tipsify (Sander, Nehab, Barczak 2007)
+	// fans around a vertex that's still in the cache while there is one, otherwise
+	// jumps to a recently used vertex with triangles left (or the next unfinished one)
+	// the returned order lists triangle numbers; clusterStarts gets the positions in it
+	// where a jump happened, those runs are what the overdraw pass moves around
+	template<class Index>
+	static std::vector<uint32_t> OrderTriangles( const std::vector<Index>& indices,size_t vertexCount,size_t cacheSize,
+		std::vector<uint32_t>& clusterStarts )
+	{
+		const size_t nTriangles = indices.size() / 3u;
+		// triangles using each vertex (offsets into adjacency)
+		std::vector<uint32_t> live( vertexCount,0u );
+		for( const auto index : indices )
+		{
+			live[index]++;
+		}
+		std::vector<uint32_t> offsets( vertexCount + 1u,0u );
+		std::partial_sum( live.begin(),live.end(),offsets.begin() + 1 );
+		std::vector<uint32_t> adjacency( indices.size() );
+		{
+			std::vector<uint32_t> fill( offsets.begin(),offsets.end() - 1 );
+			for( size_t i = 0; i < indices.size(); i++ )
+			{
+				adjacency[fill[indices[i]]++] = uint32_t( i / 3u );
+			}
+		}
+
+		std::vector<uint32_t> order;
+		order.reserve( nTriangles );
+		clusterStarts.clear();
+		std::vector<char> emitted( nTriangles,0 );
+		std::vector<size_t> cacheTime( vertexCount,0u );
+		std::vector<uint32_t> deadEnd;
+		std::vector<uint32_t> candidates;
+		size_t time = cacheSize + 1u;
+		size_t cursor = 0;
+		// fanning vertex, -1 when everything is emitted
+		int64_t fan = vertexCount > 0 ? 0 : -1;
+		bool jumped = true;
+		while( fan >= 0 )
+		{
+			if( jumped )
+			{
+				clusterStarts.push_back( uint32_t( order.size() ) );
+			}
+			candidates.clear();
+			for( uint32_t a = offsets[size_t( fan )]; a < offsets[size_t( fan ) + 1u]; a++ )
+			{
+				const uint32_t t = adjacency[a];
+				if( emitted[t] )
+				{
+					continue;
+				}
+				emitted[t] = 1;
+				order.push_back( t );
+				for( size_t k = 0; k < 3u; k++ )
+				{
+					const size_t v = size_t( indices[t * 3u + k] );
+					deadEnd.push_back( uint32_t( v ) );
+					candidates.push_back( uint32_t( v ) );
+					live[v]--;
+					if( time - cacheTime[v] > cacheSize )
+					{
+						cacheTime[v] = time++;
+					}
+				}
+			}
+
+			// best candidate: the one that's been in the cache longest while still
+			// guaranteed to be there after emitting all its remaining triangles
+			int64_t next = -1;
+			size_t bestPriority = 0;
+			for( const uint32_t v : candidates )
+			{
+				if( live[v] == 0u )
+				{
+					continue;
+				}
+				size_t priority = 0;
+				if( time - cacheTime[v] + 2u * live[v] <= cacheSize )
+				{
+					priority = time - cacheTime[v];
+				}
+				if( next < 0 || priority > bestPriority )
+				{
+					next = v;
+					bestPriority = priority;
+				}
+			}
+			jumped = next < 0;
+			if( jumped )
+			{
+				// dead end, back up through recently touched vertices, then scan
+				while( next < 0 && !deadEnd.empty() )
+				{
+					const uint32_t v = deadEnd.back();
+					deadEnd.pop_back();
+					if( live[v] > 0u )
+					{
+						next = v;
+					}
+				}
+				for( ; next < 0 && cursor < vertexCount; cursor++ )
+				{
+					if( live[cursor] > 0u )
+					{
+						next = int64_t( cursor );
+					}
+				}
+			}
+			fan = next;
+		}
+		return order;
+	}
+	// reorders the clusters of a triangle order (from OrderTriangles) so the ones facing
+	// away from the mesh center come first, they tend to occlude the rest from any view
+	// (the view independent sort from the tipsify paper, keeps the cache order inside clusters)
+	template<class Index,class GetPos>
+	static std::vector<uint32_t> SortClustersForOverdraw( const std::vector<Index>& indices,const std::vector<uint32_t>& order,
+		const std::vector<uint32_t>& clusterStarts,GetPos getPos )
+	{
+		const auto Corner = [&]( uint32_t t,size_t k ) -> Vec3
+		{
+			return getPos( size_t( indices[t * 3u + k] ) );
+		};
+		// area weighted centroid of the whole mesh
+		Vec3 meshCenter = { 0.0f,0.0f,0.0f };
+		float meshArea = 0.0f;
+		for( const uint32_t t : order )
+		{
+			const Vec3 v0 = Corner( t,0 );
+			const Vec3 v1 = Corner( t,1 );
+			const Vec3 v2 = Corner( t,2 );
+			const float area = ((v1 - v0) % (v2 - v0)).Len();
+			meshCenter += (v0 + v1 + v2) * (area / 3.0f);
+			meshArea += area;
+		}
+		if( meshArea > 0.0f )
+		{
+			meshCenter /= meshArea;
+		}
+
+		struct Cluster
+		{
+			uint32_t begin;
+			uint32_t end;
+			float sortKey;
+		};
+		std::vector<Cluster> clusters;
+		clusters.reserve( clusterStarts.size() );
+		for( size_t c = 0; c < clusterStarts.size(); c++ )
+		{
+			Cluster cluster;
+			cluster.begin = clusterStarts[c];
+			cluster.end = c + 1 < clusterStarts.size() ? clusterStarts[c + 1] : uint32_t( order.size() );
+			// area weighted normal (sum of cross products) and centroid of the cluster
+			Vec3 normal = { 0.0f,0.0f,0.0f };
+			Vec3 center = { 0.0f,0.0f,0.0f };
+			float area = 0.0f;
+			for( uint32_t i = cluster.begin; i < cluster.end; i++ )
+			{
+				const Vec3 v0 = Corner( order[i],0 );
+				const Vec3 v1 = Corner( order[i],1 );
+				const Vec3 v2 = Corner( order[i],2 );
+				const Vec3 cross = (v1 - v0) % (v2 - v0);
+				const float a = cross.Len();
+				normal += cross;
+				center += (v0 + v1 + v2) * (a / 3.0f);
+				area += a;
+			}
+			if( area > 0.0f )
+			{
+				center /= area;
+			}
+			cluster.sortKey = (center - meshCenter) * normal;
+			clusters.push_back( cluster );
+		}
+		std::stable_sort( clusters.begin(),clusters.end(),[]( const Cluster& a,const Cluster& b )
+		{
+			return a.sortKey > b.sortKey;
+		} );
+
+		std::vector<uint32_t> sorted;
+		sorted.reserve( order.size() );
+		for( const auto& cluster : clusters )
+		{
+			sorted.insert( sorted.end(),order.begin() + cluster.begin,order.begin() + cluster.end );
+		}
+		return sorted;
+	}
+	// new index for every vertex, in order of first use by the indices
+	// (so the vertex fetches of consecutive triangles are close together in memory)
+	// vertices no triangle uses keep their relative order after the used ones
+	template<class Index>
+	static std::vector<uint32_t> RemapVerticesByFirstUse( const std::vector<Index>& indices,size_t vertexCount )
+	{
+		constexpr uint32_t unassigned = ~0u;
+		std::vector<uint32_t> remap( vertexCount,unassigned );
+		uint32_t next = 0;
+		for( const auto index : indices )
+		{
+			if( remap[index] == unassigned )
+			{
+				remap[index] = next++;
+			}
+		}
+		for( auto& r : remap )
+		{
+			if( r == unassigned )
+			{
+				r = next++;
+			}
+		}
+		return remap;
+	}
+};
\ No newline at end of file
@@ -0,0 +1,353 @@
+#pragma once
+
+#include <vector>
+#include <queue>
+#include <cstdint>
+#include <cstddef>
+#include <cmath>
+#include <algorithm>
+#include "Vec3.h"
+
+// quadric error mesh simplification (Garland, Heckbert 1997), for building levels of detail
+// (applied through IndexedTriangleList::Simplify)
+// edges are collapsed into one of their endpoints, cheapest first, so the simplified mesh
+// only uses vertices of the original and whatever attributes they carry come through as is
+class MeshSimplifier
+{
+public:
+	struct Result
+	{
+		// triangles left, indexing the original vertices
+		std::vector<uint32_t> indices;
+		// bound on how far the surface moved, in model units (square root of the largest
+		// collapse cost, which is a sum of squared distances to planes of the original)
+		float error;
+	};
+public:
+	// collapses edges until at most targetTriangles are left, or no collapse is possible
+	// without folding triangles over or tearing the mesh
+	template<class Index,class GetPos>
+	static Result Simplify( const std::vector<Index>& indices,size_t vertexCount,size_t targetTriangles,GetPos getPos )
+	{
+		const size_t nTriangles = indices.size() / 3u;
+		std::vector<uint32_t> corners( indices.begin(),indices.end() );
+		std::vector<Vec3> positions( vertexCount );
+		for( size_t i = 0; i < vertexCount; i++ )
+		{
+			positions[i] = getPos( i );
+		}
+
+		// vertices sharing a position with another one (seams in the normals / texture
+		// coordinates) are never moved, moving only one side would tear the seam open
+		std::vector<char> locked( vertexCount,0 );
+		{
+			std::vector<uint32_t> byPos( vertexCount );
+			for( size_t i = 0; i < vertexCount; i++ )
+			{
+				byPos[i] = uint32_t( i );
+			}
+			const auto Less = [&positions]( uint32_t a,uint32_t b )
+			{
+				const Vec3& pa = positions[a];
+				const Vec3& pb = positions[b];
+				return pa.x != pb.x ? pa.x < pb.x : (pa.y != pb.y ? pa.y < pb.y : pa.z < pb.z);
+			};
+			std::sort( byPos.begin(),byPos.end(),Less );
+			for( size_t i = 1; i < vertexCount; i++ )
+			{
+				if( positions[byPos[i]] == positions[byPos[i - 1]] )
+				{
+					locked[byPos[i]] = 1;
+					locked[byPos[i - 1]] = 1;
+				}
+			}
+		}
+
+		// planes of the triangles around each vertex
+		std::vector<Quadric> quadrics( vertexCount );
+		std::vector<std::vector<uint32_t>> vertexTriangles( vertexCount );
+		for( size_t t = 0; t < nTriangles; t++ )
+		{
+			for( size_t k = 0; k < 3u; k++ )
+			{
+				vertexTriangles[corners[t * 3u + k]].push_back( uint32_t( t ) );
+			}
+			Vec3 n = FaceNormal( positions,&corners[t * 3u] );
+			const float len = n.Len();
+			if( len > 0.0f )
+			{
+				n /= len;
+				const Quadric q = Quadric::FromPlane( n,-(n * positions[corners[t * 3u]]) );
+				for( size_t k = 0; k < 3u; k++ )
+				{
+					quadrics[corners[t * 3u + k]] += q;
+				}
+			}
+		}
+
+		// edges (undirected, lower index first), those on the border of the mesh get a plane at
+		// right angles to their triangle so that the border keeps its shape
+		struct Edge
+		{
+			uint64_t key;
+			uint32_t triangle;
+			bool operator<( const Edge& rhs ) const
+			{
+				return key < rhs.key;
+			}
+		};
+		std::vector<Edge> edges;
+		edges.reserve( corners.size() );
+		for( size_t t = 0; t < nTriangles; t++ )
+		{
+			for( size_t k = 0; k < 3u; k++ )
+			{
+				const uint32_t a = corners[t * 3u + k];
+				const uint32_t b = corners[t * 3u + (k + 1u) % 3u];
+				edges.push_back( { (uint64_t( std::min( a,b ) ) << 32) | uint64_t( std::max( a,b ) ),uint32_t( t ) } );
+			}
+		}
+		std::sort( edges.begin(),edges.end() );
+		std::priority_queue<Collapse,std::vector<Collapse>,std::greater<Collapse>> heap;
+		std::vector<uint32_t> stamps( vertexCount,0u );
+		const auto Push = [&]( uint32_t from,uint32_t to )
+		{
+			if( !locked[from] )
+			{
+				Quadric q = quadrics[from];
+				q += quadrics[to];
+				heap.push( { float( std::max( q.Evaluate( positions[to] ),0.0 ) ),from,to,stamps[from],stamps[to] } );
+			}
+		};
+		for( size_t i = 0; i < edges.size(); )
+		{
+			size_t end = i + 1u;
+			for( ; end < edges.size() && edges[end].key == edges[i].key; end++ )
+			{
+			}
+			const uint32_t a = uint32_t( edges[i].key >> 32 );
+			const uint32_t b = uint32_t( edges[i].key & 0xFFFFFFFFu );
+			if( end - i == 1u )
+			{
+				const Vec3 n = FaceNormal( positions,&corners[edges[i].triangle * 3u] );
+				Vec3 m = (positions[b] - positions[a]) % n;
+				const float len = m.Len();
+				if( len > 0.0f )
+				{
+					m /= len;
+					const Quadric q = Quadric::FromPlane( m,-(m * positions[a]),borderWeight );
+					quadrics[a] += q;
+					quadrics[b] += q;
+				}
+			}
+			i = end;
+		}
+		for( size_t i = 0; i < edges.size(); i++ )
+		{
+			if( i == 0 || edges[i].key != edges[i - 1].key )
+			{
+				const uint32_t a = uint32_t( edges[i].key >> 32 );
+				const uint32_t b = uint32_t( edges[i].key & 0xFFFFFFFFu );
+				Push( a,b );
+				Push( b,a );
+			}
+		}
+
+		std::vector<char> deadTriangles( nTriangles,0 );
+		std::vector<char> removed( vertexCount,0 );
+		// neighborhood scratch: marks[v] == mark when v was gathered in the current pass
+		std::vector<uint32_t> marks( vertexCount,0u );
+		uint32_t mark = 0;
+		std::vector<uint32_t> neighbors;
+		const auto Contains = [&corners]( uint32_t t,uint32_t v )
+		{
+			return corners[t * 3u] == v || corners[t * 3u + 1u] == v || corners[t * 3u + 2u] == v;
+		};
+		// live triangles of v, dead ones are dropped from its list on the way
+		const auto CompactTriangles = [&]( uint32_t v ) -> const std::vector<uint32_t>&
+		{
+			auto& list = vertexTriangles[v];
+			list.erase( std::remove_if( list.begin(),list.end(),[&]( uint32_t t ) { return deadTriangles[t] != 0; } ),list.end() );
+			return list;
+		};
+		const auto GatherNeighbors = [&]( uint32_t v )
+		{
+			mark++;
+			neighbors.clear();
+			for( const uint32_t t : CompactTriangles( v ) )
+			{
+				for( size_t k = 0; k < 3u; k++ )
+				{
+					const uint32_t n = corners[t * 3u + k];
+					if( n != v && marks[n] != mark )
+					{
+						marks[n] = mark;
+						neighbors.push_back( n );
+					}
+				}
+			}
+		};
+		// u into v keeps the mesh a manifold (the link condition: the only neighbors the two
+		// have in common are the far corners of the triangles on the edge) and doesn't flip
+		// any of the triangles that move with u
+		const auto CanCollapse = [&]( uint32_t u,uint32_t v )
+		{
+			size_t shared = 0;
+			for( const uint32_t t : CompactTriangles( u ) )
+			{
+				if( Contains( t,v ) )
+				{
+					shared++;
+					continue;
+				}
+				uint32_t moved[3] = { corners[t * 3u],corners[t * 3u + 1u],corners[t * 3u + 2u] };
+				std::replace( std::begin( moved ),std::end( moved ),u,v );
+				if( FaceNormal( positions,&corners[t * 3u] ) * FaceNormal( positions,moved ) <= 0.0f )
+				{
+					return false;
+				}
+			}
+			if( shared == 0u )
+			{
+				return false;
+			}
+			GatherNeighbors( u );
+			const uint32_t neighborOfU = mark;
+			const uint32_t counted = ++mark;
+			size_t common = 0;
+			for( const uint32_t t : CompactTriangles( v ) )
+			{
+				for( size_t k = 0; k < 3u; k++ )
+				{
+					// counted ones get moved on to the new mark so they only count once
+					const uint32_t n = corners[t * 3u + k];
+					if( n != u && n != v && marks[n] == neighborOfU )
+					{
+						marks[n] = counted;
+						common++;
+					}
+				}
+			}
+			return common == shared;
+		};
+
+		size_t liveTriangles = nTriangles;
+		double maxCost = 0.0;
+		while( liveTriangles > targetTriangles && !heap.empty() )
+		{
+			const Collapse c = heap.top();
+			heap.pop();
+			if( removed[c.from] || removed[c.to] || c.stampFrom != stamps[c.from] || c.stampTo != stamps[c.to] ||
+				!CanCollapse( c.from,c.to ) )
+			{
+				continue;
+			}
+			maxCost = std::max( maxCost,double( c.cost ) );
+			for( const uint32_t t : vertexTriangles[c.from] )
+			{
+				if( Contains( t,c.to ) )
+				{
+					deadTriangles[t] = 1;
+					liveTriangles--;
+				}
+				else
+				{
+					std::replace( &corners[t * 3u],&corners[t * 3u] + 3,c.from,c.to );
+					vertexTriangles[c.to].push_back( t );
+				}
+			}
+			vertexTriangles[c.from] = {};
+			quadrics[c.to] += quadrics[c.from];
+			removed[c.from] = 1;
+			// v's quadric changed, so did the cost of every edge it's on
+			stamps[c.to]++;
+			GatherNeighbors( c.to );
+			for( const uint32_t n : neighbors )
+			{
+				Push( c.to,n );
+				Push( n,c.to );
+			}
+		}
+
+		Result result;
+		result.error = float( std::sqrt( maxCost ) );
+		result.indices.reserve( liveTriangles * 3u );
+		for( size_t t = 0; t < nTriangles; t++ )
+		{
+			if( !deadTriangles[t] )
+			{
+				result.indices.insert( result.indices.end(),&corners[t * 3u],&corners[t * 3u] + 3 );
+			}
+		}
+		return result;
+	}
+private:
+	// symmetric 4x4 matrix of a sum of squared distances to planes
+	struct Quadric
+	{
+		double a00 = 0.0,a01 = 0.0,a02 = 0.0,a11 = 0.0,a12 = 0.0,a22 = 0.0;
+		double b0 = 0.0,b1 = 0.0,b2 = 0.0;
+		double c = 0.0;
+		// plane n * p + d = 0 (n unit length)
+		static Quadric FromPlane( const Vec3& n,float d,double weight = 1.0 )
+		{
+			Quadric q;
+			q.a00 = weight * n.x * n.x;
+			q.a01 = weight * n.x * n.y;
+			q.a02 = weight * n.x * n.z;
+			q.a11 = weight * n.y * n.y;
+			q.a12 = weight * n.y * n.z;
+			q.a22 = weight * n.z * n.z;
+			q.b0 = weight * n.x * d;
+			q.b1 = weight * n.y * d;
+			q.b2 = weight * n.z * d;
+			q.c = weight * double( d ) * d;
+			return q;
+		}
+		Quadric& operator+=( const Quadric& rhs )
+		{
+			a00 += rhs.a00;
+			a01 += rhs.a01;
+			a02 += rhs.a02;
+			a11 += rhs.a11;
+			a12 += rhs.a12;
+			a22 += rhs.a22;
+			b0 += rhs.b0;
+			b1 += rhs.b1;
+			b2 += rhs.b2;
+			c += rhs.c;
+			return *this;
+		}
+		double Evaluate( const Vec3& p ) const
+		{
+			const double x = p.x;
+			const double y = p.y;
+			const double z = p.z;
+			return a00 * x * x + a11 * y * y + a22 * z * z +
+				2.0 * (a01 * x * y + a02 * x * z + a12 * y * z) +
+				2.0 * (b0 * x + b1 * y + b2 * z) + c;
+		}
+	};
+	// collapse of vertex from into vertex to, stale once either vertex's stamp moved on
+	struct Collapse
+	{
+		float cost;
+		uint32_t from;
+		uint32_t to;
+		uint32_t stampFrom;
+		uint32_t stampTo;
+		bool operator>( const Collapse& rhs ) const
+		{
+			return cost > rhs.cost;
+		}
+	};
+	// border planes count this much more than surface ones, the silhouette of an open
+	// mesh is what you notice first
+	static constexpr double borderWeight = 10.0;
+private:
+	static Vec3 FaceNormal( const std::vector<Vec3>& positions,const uint32_t* tri )
+	{
+		const Vec3& p0 = positions[tri[0]];
+		return (positions[tri[1]] - p0) % (positions[tri[2]] - p0);
+	}
+};
\ No newline at end of file
@@ -0,0 +1,244 @@
+#pragma once
+
+#include "Surface.h"
+#include "Vec2.h"
+#include "ChiliMath.h"
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <cassert>
+#include <cstring>
+#include <emmintrin.h>
+
+// order of the texels of each mip level in memory
+enum class TexelLayout
+{
+	// rows one after the other, like a Surface
+	Linear,
+	// 4x4 blocks (64 bytes, one cache line) one after the other, row by row, texels
+	// inside a block row by row; a bilinear footprint is usually in one line and
+	// walking the texture in any direction touches a new line every 4 texels
+	Tiled
+};
+
+// texture with its full mip chain (level 0 is the source image, each level after
+// that half the size of the one before, down to 1x1), read through a Sampler
+// sampling at the level that matches the pixel's footprint in the texture keeps
+// neighbouring pixels on neighbouring texels (fewer cache misses on distant surfaces)
+// and averages out the texels a pixel skips over (no shimmer under minification)
+class MipTexture
+{
+public:
+	// one mip level as the sampler reads it
+	class Level
+	{
+	public:
+		unsigned int GetWidth() const
+		{
+			return width;
+		}
+		unsigned int GetHeight() const
+		{
+			return height;
+		}
+		// position of texel x,y in the level's texel array is RowOffset( y ) + ColumnOffset( x ),
+		// the same for both layouts (linear is a single tile as wide as the level and as high
+		// as everything), so a bilinear footprint costs two of each and no branches
+		size_t RowOffset( unsigned int y ) const
+		{
+			assert( y < height );
+			return size_t( y & ~mask ) * tileRowStride + size_t( y & mask ) * rowStride;
+		}
+		size_t ColumnOffset( unsigned int x ) const
+		{
+			assert( x < width );
+			return (size_t( x & ~mask ) << tileShift) + (x & mask);
+		}
+		// RowOffset / ColumnOffset of four coordinates at once (SSE2), one per 32 bit lane
+		// (16 bit multiplies, see the size limit in MipTexture's constructor)
+		__m128i RowOffsets( __m128i y ) const
+		{
+			const __m128i masks = _mm_set1_epi32( int( mask ) );
+			// y & ~mask in the low half of each lane, y & mask in the high half, against the strides
+			const __m128i parts = _mm_or_si128( _mm_andnot_si128( masks,y ),_mm_slli_epi32( _mm_and_si128( y,masks ),16 ) );
+			return _mm_madd_epi16( parts,_mm_set1_epi32( int( tileRowStride | (rowStride << 16u) ) ) );
+		}
+		__m128i ColumnOffsets( __m128i x ) const
+		{
+			const __m128i masks = _mm_set1_epi32( int( mask ) );
+			return _mm_add_epi32( _mm_slli_epi32( _mm_andnot_si128( masks,x ),int( tileShift ) ),_mm_and_si128( x,masks ) );
+		}
+		size_t Offset( unsigned int x,unsigned int y ) const
+		{
+			return RowOffset( y ) + ColumnOffset( x );
+		}
+		Color GetTexel( unsigned int x,unsigned int y ) const
+		{
+			return pTexels[Offset( x,y )];
+		}
+		const Color* GetTexels() const
+		{
+			return pTexels;
+		}
+	private:
+		friend class MipTexture;
+		const Color* pTexels;
+		unsigned int width;
+		unsigned int height;
+		// coordinate bits inside a tile (all of them when linear)
+		unsigned int mask;
+		// texels from one row to the next inside a tile
+		size_t rowStride;
+		// texels from one row of tiles to the next, per row (0 when linear)
+		size_t tileRowStride;
+	};
+public:
+	MipTexture( Surface base,TexelLayout layout = TexelLayout::Linear )
+		:
+		layout( layout )
+	{
+		surfaces.push_back( std::move( base ) );
+		while( surfaces.back().GetWidth() > 1u || surfaces.back().GetHeight() > 1u )
+		{
+			surfaces.push_back( Downsample( surfaces.back() ) );
+		}
+		for( const auto& s : surfaces )
+		{
+			Level level;
+			level.width = s.GetWidth();
+			level.height = s.GetHeight();
+			if( layout == TexelLayout::Tiled )
+			{
+				// swizzled once here, the row major levels aren't needed after that
+				const size_t tilesPerRow = (level.width + tileMask) >> tileShift;
+				const size_t tileRows = (level.height + tileMask) >> tileShift;
+				tiles.push_back( std::make_unique<Tile[]>( tilesPerRow * tileRows ) );
+				level.pTexels = tiles.back()[0].texels;
+				level.mask = tileMask;
+				level.rowStride = size_t( 1 ) << tileShift;
+				level.tileRowStride = tilesPerRow << tileShift;
+				Color* const pDst = tiles.back()[0].texels;
+				for( unsigned int y = 0; y < level.height; y++ )
+				{
+					for( unsigned int x = 0; x < level.width; x++ )
+					{
+						pDst[level.Offset( x,y )] = s.GetPixel( x,y );
+					}
+				}
+			}
+			else
+			{
+				level.pTexels = s.GetBufferPtrConst();
+				level.mask = ~0u;
+				level.rowStride = s.GetPitch();
+				level.tileRowStride = 0;
+			}
+			// Level::RowOffsets works with 16 bit coordinates and strides
+			assert( level.height < 32768u && level.rowStride < 32768u && level.tileRowStride < 32768u );
+			levels.push_back( level );
+		}
+		if( layout == TexelLayout::Tiled )
+		{
+			surfaces.clear();
+		}
+	}
+	static MipTexture FromFile( const std::wstring& name,TexelLayout layout = TexelLayout::Linear )
+	{
+		return MipTexture( Surface::FromFile( name ),layout );
+	}
+	TexelLayout GetLayout() const
+	{
+		return layout;
+	}
+	size_t GetLevelCount() const
+	{
+		return levels.size();
+	}
+	const Level& GetLevel( size_t level ) const
+	{
+		return levels[level];
+	}
+	unsigned int GetWidth() const
+	{
+		return levels.front().GetWidth();
+	}
+	unsigned int GetHeight() const
+	{
+		return levels.front().GetHeight();
+	}
+	// mip level for a pixel whose texture coordinates change by dx / dy for
+	// every 1 pixel step right / down (log2 of the texels covered along the longer axis)
+	float ComputeLod( const Vec2& dx,const Vec2& dy ) const
+	{
+		const float w = float( GetWidth() );
+		const float h = float( GetHeight() );
+		const float lenSqX = sq( dx.x * w ) + sq( dx.y * h );
+		const float lenSqY = sq( dy.x * w ) + sq( dy.y * h );
+		// log2( sqrt( x ) ) == 0.5 * log2( x )
+		const float lod = 0.5f * Log2( std::max( std::max( lenSqX,lenSqY ),1e-12f ) );
+		return std::clamp( lod,0.0f,float( levels.size() - 1u ) );
+	}
+private:
+	// log2 of a positive normal float to about 2e-6, from its exponent and a short series
+	// for the mantissa (this runs once per quad, std::log2 is a library call)
+	static float Log2( float x )
+	{
+		unsigned int bits;
+		memcpy( &bits,&x,sizeof( bits ) );
+		int exponent = int( bits >> 23u ) - 127;
+		// mantissa moved into sqrt( 0.5 )..sqrt( 2 ) so the series converges fast
+		const unsigned int mantissaBits = (bits & 0x007FFFFFu) | 0x3F800000u;
+		float m;
+		memcpy( &m,&mantissaBits,sizeof( m ) );
+		if( m > 1.41421356f )
+		{
+			m *= 0.5f;
+			exponent++;
+		}
+		// log2( m ) == 2 / ln( 2 ) * atanh( s ) with s = (m - 1) / (m + 1)
+		const float s = (m - 1.0f) / (m + 1.0f);
+		const float s2 = s * s;
+		return float( exponent ) + s * (2.8853901f + s2 * (0.9617967f + s2 * 0.5770780f));
+	}
+	// box filter to half size (an odd sized level loses its last row / column)
+	static Surface Downsample( const Surface& src )
+	{
+		const unsigned int w = std::max( src.GetWidth() / 2u,1u );
+		const unsigned int h = std::max( src.GetHeight() / 2u,1u );
+		Surface dst( w,h );
+		for( unsigned int y = 0; y < h; y++ )
+		{
+			const unsigned int sy0 = std::min( y * 2u,src.GetHeight() - 1u );
+			const unsigned int sy1 = std::min( y * 2u + 1u,src.GetHeight() - 1u );
+			for( unsigned int x = 0; x < w; x++ )
+			{
+				const unsigned int sx0 = std::min( x * 2u,src.GetWidth() - 1u );
+				const unsigned int sx1 = std::min( x * 2u + 1u,src.GetWidth() - 1u );
+				const Color c[4] = {
+					src.GetPixel( sx0,sy0 ),src.GetPixel( sx1,sy0 ),
+					src.GetPixel( sx0,sy1 ),src.GetPixel( sx1,sy1 )
+				};
+				const auto Average = [&c]( unsigned char (Color::* get)() const )
+				{
+					return (unsigned char)(((c[0].*get)() + (c[1].*get)() + (c[2].*get)() + (c[3].*get)() + 2u) / 4u);
+				};
+				dst.PutPixel( x,y,Color( Average( &Color::GetX ),Average( &Color::GetR ),Average( &Color::GetG ),Average( &Color::GetB ) ) );
+			}
+		}
+		return dst;
+	}
+private:
+	static constexpr unsigned int tileShift = 2u;
+	static constexpr unsigned int tileMask = (1u << tileShift) - 1u;
+	struct alignas( 64 ) Tile
+	{
+		Color texels[1u << (2u * tileShift)];
+	};
+	TexelLayout layout;
+	// row major levels (only kept when the layout is linear, the levels point into them)
+	std::vector<Surface> surfaces;
+	// one array of tiles per level when tiled
+	std::vector<std::unique_ptr<Tile[]>> tiles;
+	std::vector<Level> levels;
+};
\ No newline at end of file
@@ -25,6 +25,7 @@
 class Mouse
 {
 	friend class MainWindow;
+	friend class ScriptedInput;
 public:
 	class Event
 	{
@@ -1,6 +1,5 @@
 #pragma once
 
-#include "ChiliWin.h"
 #include "Graphics.h"
 #include "Triangle.h"
 #include "IndexedTriangleList.h"
@@ -44,7 +43,7 @@ public:
 private:
 	// vertex processing function
 	// transforms vertices using vs and then passes vtx & idx lists to triangle assembler
-	void ProcessVertices( const std::vector<Vertex>& vertices,const std::vector<size_t>& indices )
+	void ProcessVertices( const std::vector<Vertex>& vertices,const IndexBuffer& indices )
 	{
 		// create vertex vector for vs output
 		std::vector<VSOut> verticesOut( vertices.size() );
@@ -74,7 +73,7 @@ private:
 	// triangle assembly function
 	// assembles indexed vertex stream into triangles and passes them to post process
 	// culls (does not send) back facing triangles
-	void AssembleTriangles( const std::vector<VSOut>& vertices,const std::vector<size_t>& indices )
+	void AssembleTriangles( const std::vector<VSOut>& vertices,const IndexBuffer& indices )
 	{
 		const auto eyepos = Vec4{ 0.0f,0.0f,0.0f,1.0f } *effect.vs.GetProj();
 		// assemble triangles in the stream and process
@@ -0,0 +1,412 @@
+#include "ObjReader.h"
+#include "MappedFile.h"
+#include "ThreadPool.h"
+#include <stdexcept>
+#include <algorithm>
+#include <cstdlib>
+#include <cctype>
+#include <mutex>
+
+namespace
+{
+	// tokenizer output for one chunk of the file
+	struct Chunk
+	{
+		const char* begin;
+		const char* end;
+		std::vector<float> positions;
+		std::vector<float> normals;
+		std::vector<float> texcoords;
+		std::vector<ObjReader::Ref> refs;
+		// refs that were negative in the file are stored relative to the start of this
+		// chunk, these are their positions in refs (3 * ref + component) so the merge
+		// can add the number of attributes read by earlier chunks
+		std::vector<size_t> relative;
+		// empty unless the chunk hit a malformed record
+		std::string error;
+	};
+
+	// chunks smaller than this aren't worth handing to another thread
+	constexpr size_t minChunkSize = 256 * 1024;
+
+	bool IsBlank( char c )
+	{
+		return c == ' ' || c == '\t' || c == '\r';
+	}
+	bool IsDigit( char c )
+	{
+		return unsigned( c - '0' ) < 10u;
+	}
+	void SkipBlanks( const char*& p,const char* end )
+	{
+		while( p != end && IsBlank( *p ) )
+		{
+			p++;
+		}
+	}
+	// leaves p after the next newline (or at end)
+	void SkipLine( const char*& p,const char* end )
+	{
+		while( p != end && *p++ != '\n' );
+	}
+
+	// fast path for the plain decimal numbers obj exporters write: up to 19 significant digits
+	// go into an integer and one multiply/divide by an exact power of ten gives the result
+	// anything longer or odder (nan, inf, huge exponents) goes through strtod
+	bool ParseFloat( const char*& p,const char* end,float& out )
+	{
+		static constexpr double powersOf10[] = {
+			1e0,1e1,1e2,1e3,1e4,1e5,1e6,1e7,1e8,1e9,1e10,1e11,
+			1e12,1e13,1e14,1e15,1e16,1e17,1e18,1e19,1e20,1e21,1e22
+		};
+		SkipBlanks( p,end );
+		const char* const start = p;
+		bool negative = false;
+		if( p != end && (*p == '-' || *p == '+') )
+		{
+			negative = *p == '-';
+			p++;
+		}
+		uint64_t mantissa = 0;
+		int nDigits = 0;
+		int nSignificant = 0;
+		int exponent = 0;
+		for( ; p != end && IsDigit( *p ); p++, nDigits++ )
+		{
+			mantissa = mantissa * 10u + uint64_t( *p - '0' );
+			nSignificant += mantissa != 0u;
+		}
+		if( p != end && *p == '.' )
+		{
+			for( p++; p != end && IsDigit( *p ); p++, nDigits++ )
+			{
+				mantissa = mantissa * 10u + uint64_t( *p - '0' );
+				nSignificant += mantissa != 0u;
+				exponent--;
+			}
+		}
+		if( nDigits > 0 && p != end && (*p == 'e' || *p == 'E') )
+		{
+			const char* q = p + 1;
+			bool negativeExp = false;
+			if( q != end && (*q == '-' || *q == '+') )
+			{
+				negativeExp = *q == '-';
+				q++;
+			}
+			int e = 0;
+			const char* const expStart = q;
+			for( ; q != end && IsDigit( *q ); q++ )
+			{
+				e = std::min( e * 10 + (*q - '0'),100000 );
+			}
+			if( q != expStart )
+			{
+				exponent += negativeExp ? -e : e;
+				p = q;
+			}
+		}
+		if( nDigits > 0 && nSignificant <= 19 && mantissa <= (uint64_t( 1 ) << 53) &&
+			exponent >= -22 && exponent <= 22 )
+		{
+			double d = double( mantissa );
+			d = exponent < 0 ? d / powersOf10[-exponent] : d * powersOf10[exponent];
+			out = float( negative ? -d : d );
+			return true;
+		}
+		// strtod needs a terminated string and the mapping isn't one
+		char buffer[64];
+		size_t n = 0;
+		for( const char* q = start; q != end && n < sizeof( buffer ) - 1 && !IsBlank( *q ) && *q != '\n'; q++ )
+		{
+			buffer[n++] = *q;
+		}
+		buffer[n] = '\0';
+		char* pEnd;
+		const double d = std::strtod( buffer,&pEnd );
+		if( pEnd == buffer )
+		{
+			p = start;
+			return false;
+		}
+		p = start + (pEnd - buffer);
+		out = float( d );
+		return true;
+	}
+	bool ParseInt( const char*& p,const char* end,int32_t& out )
+	{
+		bool negative = false;
+		if( p != end && (*p == '-' || *p == '+') )
+		{
+			negative = *p == '-';
+			p++;
+		}
+		if( p == end || !IsDigit( *p ) )
+		{
+			return false;
+		}
+		int64_t value = 0;
+		for( ; p != end && IsDigit( *p ); p++ )
+		{
+			value = std::min<int64_t>( value * 10 + (*p - '0'),INT32_MAX );
+		}
+		out = int32_t( negative ? -value : value );
+		return true;
+	}
+	// reads count floats, the ones past nRequired may be missing (and are then 0)
+	bool ParseFloats( const char*& p,const char* end,std::vector<float>& out,int count,int nRequired )
+	{
+		for( int i = 0; i < count; i++ )
+		{
+			float f = 0.0f;
+			if( !ParseFloat( p,end,f ) && i < nRequired )
+			{
+				return false;
+			}
+			out.push_back( f );
+		}
+		return true;
+	}
+
+	// face corner as read, with a bit per component that is relative to the chunk
+	struct Corner
+	{
+		ObjReader::Ref ref;
+		unsigned relativeMask;
+	};
+	// obj indices are 1-based, negative ones count back from the last attribute read so far
+	bool ResolveIndex( int32_t raw,size_t nRead,int32_t& index,bool& relative )
+	{
+		if( raw > 0 )
+		{
+			index = raw - 1;
+			relative = false;
+			return true;
+		}
+		if( raw < 0 )
+		{
+			index = int32_t( int64_t( nRead ) + raw );
+			relative = true;
+			return true;
+		}
+		return false;
+	}
+	// "v", "v/vt", "v//vn" or "v/vt/vn"
+	bool ParseCorner( const char*& p,const char* end,const Chunk& c,Corner& corner )
+	{
+		const size_t nRead[3] = { c.positions.size() / 3u,c.texcoords.size() / 2u,c.normals.size() / 3u };
+		int32_t* const fields[3] = { &corner.ref.v,&corner.ref.vt,&corner.ref.vn };
+		corner.ref = { -1,-1,-1 };
+		corner.relativeMask = 0u;
+		for( int i = 0; i < 3; i++ )
+		{
+			if( i > 0 )
+			{
+				if( p == end || *p != '/' )
+				{
+					break;
+				}
+				p++;
+				// empty texcoord slot in v//vn
+				if( i == 1 && p != end && *p == '/' )
+				{
+					continue;
+				}
+			}
+			int32_t raw;
+			bool relative;
+			if( !ParseInt( p,end,raw ) || !ResolveIndex( raw,nRead[i],*fields[i],relative ) )
+			{
+				return false;
+			}
+			corner.relativeMask |= relative ? 1u << i : 0u;
+		}
+		return true;
+	}
+
+	void Tokenize( Chunk& c )
+	{
+		// corners of the current polygon, kept around to save reallocating per face
+		std::vector<Corner> polygon;
+		const char* const end = c.end;
+		const char* p = c.begin;
+		while( p != end )
+		{
+			SkipBlanks( p,end );
+			const char* const record = p;
+			bool ok = true;
+			if( p + 1 < end && p[0] == 'v' && IsBlank( p[1] ) )
+			{
+				p += 1;
+				// x y z [w]
+				ok = ParseFloats( p,end,c.positions,3,3 );
+			}
+			else if( p + 2 < end && p[0] == 'v' && p[1] == 'n' && IsBlank( p[2] ) )
+			{
+				p += 2;
+				ok = ParseFloats( p,end,c.normals,3,3 );
+			}
+			else if( p + 2 < end && p[0] == 'v' && p[1] == 't' && IsBlank( p[2] ) )
+			{
+				p += 2;
+				// u [v [w]]
+				ok = ParseFloats( p,end,c.texcoords,2,1 );
+			}
+			else if( p + 1 < end && p[0] == 'f' && IsBlank( p[1] ) )
+			{
+				p += 1;
+				polygon.clear();
+				for( SkipBlanks( p,end ); ok && p != end && *p != '\n'; SkipBlanks( p,end ) )
+				{
+					Corner corner;
+					ok = ParseCorner( p,end,c,corner );
+					polygon.push_back( corner );
+				}
+				ok = ok && polygon.size() >= 3u;
+				// fan triangulation
+				for( size_t i = 2; ok && i < polygon.size(); i++ )
+				{
+					for( const Corner& corner : { polygon[0],polygon[i - 1],polygon[i] } )
+					{
+						for( unsigned j = 0; j < 3u; j++ )
+						{
+							if( corner.relativeMask & (1u << j) )
+							{
+								c.relative.push_back( c.refs.size() * 3u + j );
+							}
+						}
+						c.refs.push_back( corner.ref );
+					}
+				}
+			}
+			if( !ok )
+			{
+				const char* lineEnd = record;
+				SkipLine( lineEnd,end );
+				c.error = "bad record \"" + std::string( record,lineEnd ) + "\"";
+				return;
+			}
+			SkipLine( p,end );
+		}
+	}
+}
+
+ObjReader::Mesh ObjReader::Read( const std::string& path )
+{
+	// spinning up workers costs more than tokenizing a small model, so keep one pool around
+	static std::mutex poolMutex;
+	static ThreadPool pool;
+	std::lock_guard<std::mutex> lock( poolMutex );
+	return Read( path,pool );
+}
+
+ObjReader::Mesh ObjReader::Read( const std::string& path,ThreadPool& pool )
+{
+	const MappedFile file( path );
+	if( !file.IsOpen() )
+	{
+		throw std::runtime_error( "ObjReader could not open File:" + path );
+	}
+	const char* const data = reinterpret_cast<const char*>( file.GetData() );
+	const size_t size = file.GetSize();
+
+	Mesh mesh;
+	// check first line of file to see if CCW winding comment exists
+	{
+		const char* lineEnd = data;
+		SkipLine( lineEnd,data + size );
+		std::string firstline( data,lineEnd );
+		std::transform( firstline.begin(),firstline.end(),firstline.begin(),[]( char c ) { return static_cast<char>( std::tolower( c ) ); } );
+		mesh.isCCW = firstline.find( "ccw" ) != std::string::npos;
+	}
+
+	// split into roughly equal chunks, each ending just after a newline
+	const size_t nThreads = pool.GetWorkerCount() + 1u;
+	const size_t nChunks = std::clamp( size / minChunkSize,size_t( 1 ),nThreads * 4u );
+	std::vector<Chunk> chunks( nChunks );
+	const char* chunkBegin = data;
+	for( size_t i = 0; i < nChunks; i++ )
+	{
+		const char* chunkEnd = data + size;
+		if( i + 1 < nChunks )
+		{
+			chunkEnd = std::max( chunkBegin,data + size * (i + 1) / nChunks );
+			SkipLine( chunkEnd,data + size );
+		}
+		chunks[i].begin = chunkBegin;
+		chunks[i].end = chunkEnd;
+		chunkBegin = chunkEnd;
+	}
+
+	pool.ParallelFor( nChunks,[&chunks]( size_t i )
+	{
+		Tokenize( chunks[i] );
+	} );
+	for( const auto& c : chunks )
+	{
+		if( !c.error.empty() )
+		{
+			throw std::runtime_error( "ObjReader " + c.error + " File:" + path );
+		}
+	}
+
+	// where each chunk's output goes in the merged arrays
+	struct Offsets
+	{
+		size_t positions = 0;
+		size_t normals = 0;
+		size_t texcoords = 0;
+		size_t refs = 0;
+	};
+	std::vector<Offsets> offsets( nChunks + 1u );
+	for( size_t i = 0; i < nChunks; i++ )
+	{
+		offsets[i + 1].positions = offsets[i].positions + chunks[i].positions.size();
+		offsets[i + 1].normals = offsets[i].normals + chunks[i].normals.size();
+		offsets[i + 1].texcoords = offsets[i].texcoords + chunks[i].texcoords.size();
+		offsets[i + 1].refs = offsets[i].refs + chunks[i].refs.size();
+	}
+	const Offsets& totals = offsets.back();
+	if( totals.positions / 3u > size_t( INT32_MAX ) )
+	{
+		throw std::runtime_error( "ObjReader too many vertices File:" + path );
+	}
+	mesh.positions.resize( totals.positions );
+	mesh.normals.resize( totals.normals );
+	mesh.texcoords.resize( totals.texcoords );
+	mesh.refs.resize( totals.refs );
+
+	// copy chunks into place, rebase the relative refs and check everything is in range
+	std::vector<char> badRefs( nChunks,0 );
+	pool.ParallelFor( nChunks,[&]( size_t i )
+	{
+		Chunk& c = chunks[i];
+		const Offsets& o = offsets[i];
+		std::copy( c.positions.begin(),c.positions.end(),mesh.positions.begin() + o.positions );
+		std::copy( c.normals.begin(),c.normals.end(),mesh.normals.begin() + o.normals );
+		std::copy( c.texcoords.begin(),c.texcoords.end(),mesh.texcoords.begin() + o.texcoords );
+		const auto refs = mesh.refs.begin() + o.refs;
+		std::copy( c.refs.begin(),c.refs.end(),refs );
+		const int32_t bases[3] = { int32_t( o.positions / 3u ),int32_t( o.texcoords / 2u ),int32_t( o.normals / 3u ) };
+		for( const size_t r : c.relative )
+		{
+			Ref& ref = refs[r / 3u];
+			int32_t* const fields[3] = { &ref.v,&ref.vt,&ref.vn };
+			*fields[r % 3u] += bases[r % 3u];
+		}
+		const int32_t nv = int32_t( totals.positions / 3u );
+		const int32_t nvt = int32_t( totals.texcoords / 2u );
+		const int32_t nvn = int32_t( totals.normals / 3u );
+		badRefs[i] = char( std::any_of( refs,refs + c.refs.size(),[=]( const Ref& ref )
+		{
+			return ref.v < 0 || ref.v >= nv || ref.vt < -1 || ref.vt >= nvt || ref.vn < -1 || ref.vn >= nvn;
+		} ) );
+		// done with this chunk, give the memory back before the rest finish
+		c = Chunk{};
+	} );
+	if( std::find( badRefs.begin(),badRefs.end(),char( 1 ) ) != badRefs.end() )
+	{
+		throw std::runtime_error( "ObjReader face references a missing vertex File:" + path );
+	}
+	return mesh;
+}
\ No newline at end of file
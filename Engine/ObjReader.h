@@ -0,0 +1,43 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cstdint>
+
+class ThreadPool;
+
+// obj reader for big models: the file is memory-mapped, split into chunks at line
+// boundaries and the chunks are tokenized in parallel, then merged in file order
+// only reads what the mesh loaders use (v / vt / vn records and faces), everything
+// else (o, g, s, usemtl, mtllib, comments) is skipped
+// polygons are fan triangulated and negative (relative) references are resolved
+class ObjReader
+{
+public:
+	// one corner of a face, 0-based indices into the attribute arrays (-1 if absent)
+	struct Ref
+	{
+		int32_t v;
+		int32_t vt;
+		int32_t vn;
+	};
+	struct Mesh
+	{
+		// xyz per vertex
+		std::vector<float> positions;
+		// xyz per normal
+		std::vector<float> normals;
+		// uv per texcoord
+		std::vector<float> texcoords;
+		// 3 per triangle
+		std::vector<Ref> refs;
+		// first line of the file mentions ccw (winding still as in the file)
+		bool isCCW = false;
+	};
+public:
+	// throws std::runtime_error if the file can't be opened or has bad face references
+	// tokenizes on a pool shared by every Read (concurrent Reads take turns with it)
+	static Mesh Read( const std::string& path );
+	// same, tokenizing on the caller's pool
+	static Mesh Read( const std::string& path,ThreadPool& pool );
+};
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Pipeline.h"
+#include "Interpolant.h"
 #include "DefaultGeometryShader.h"
 
 // flat shading with vertex normals
@@ -35,7 +36,7 @@ public:
 	class VertexShader
 	{
 	public:
-		class Output
+		class Output : public Interpolant<Output>
 		{
 		public:
 			Output() = default;
@@ -55,49 +56,9 @@ public:
 				pos( pos ),
 				worldPos( worldPos )
 			{}
-			Output& operator+=( const Output& rhs )
+			static constexpr auto Attributes()
 			{
-				pos += rhs.pos;
-				n += rhs.n;
-				worldPos += rhs.worldPos;
-				return *this;
-			}
-			Output operator+( const Output& rhs ) const
-			{
-				return Output( *this ) += rhs;
-			}
-			Output& operator-=( const Output& rhs )
-			{
-				pos -= rhs.pos;
-				n -= rhs.n;
-				worldPos -= rhs.worldPos;
-				return *this;
-			}
-			Output operator-( const Output& rhs ) const
-			{
-				return Output( *this ) -= rhs;
-			}
-			Output& operator*=( float rhs )
-			{
-				pos *= rhs;
-				n *= rhs;
-				worldPos *= rhs;
-				return *this;
-			}
-			Output operator*( float rhs ) const
-			{
-				return Output( *this ) *= rhs;
-			}
-			Output& operator/=( float rhs )
-			{
-				pos /= rhs;
-				n /= rhs;
-				worldPos /= rhs;
-				return *this;
-			}
-			Output operator/( float rhs ) const
-			{
-				return Output( *this ) /= rhs;
+				return std::make_tuple( &Output::n,&Output::worldPos );
 			}
 		public:
 			Vec3 pos;
@@ -1,14 +1,28 @@
 #pragma once
 
-#include "ChiliWin.h"
 #include "Graphics.h"
 #include "Triangle.h"
 #include "IndexedTriangleList.h"
 #include "NDCScreenTransformer.h"
 #include "Mat.h"
 #include "ZBuffer.h"
+#include "ThreadPool.h"
+#include "Rect.h"
+#include "FloatPacket.h"
+#include "PostTransformCache.h"
+#include "FrameArena.h"
+#include "PipelineStats.h"
+#include "PixelQuad.h"
+#include "GBuffer.h"
+#include "Interpolant.h"
 #include <algorithm>
 #include <memory>
+#include <limits>
+#include <type_traits>
+#include <span>
+#include <optional>
+#include <cstdint>
+#include <cmath>
 
 // triangle drawing pipeline with programable
 // pixel shading stage
@@ -20,65 +34,679 @@ public:
 	typedef typename Effect::Vertex Vertex;
 	typedef typename Effect::VertexShader::Output VSOut;
 	typedef typename Effect::GeometryShader::Output GSOut;
+	// triangle rasterization algorithm
+	// (effects with a quad pixel shader always use HalfSpace, see quadShading)
+	enum class Rasterizer
+	{
+		// y-sorted flat top / flat bottom split, walks edges and scanlines
+		Scanline,
+		// edge functions over 8x8 blocks with trivial accept / reject
+		HalfSpace
+	};
+	// depth test of Draw
+	enum class DepthTest
+	{
+		// nearer than the depth in the zbuffer, which is then replaced (the default)
+		Less,
+		// the depth in the zbuffer exactly, which is left as is; for drawing after DrawDepth
+		// has put the final depths of the frame in, so each pixel only gets shaded once
+		// (by whatever ends up visible there)
+		Equal
+	};
+	// effects can give their pixel shader a packet overload ps( const GSOut* in,Color* out )
+	// that shades FloatPacket::size pixels at once; when present the rasterizers collect
+	// depth-tested pixels into packets for it, otherwise the scalar ps is called per pixel
+	static constexpr bool packetShading = requires( const typename Effect::PixelShader& ps,const GSOut* in,Color* out )
+	{
+		ps( in,out );
+	};
+	// effects can instead give their pixel shader a quad overload ps( const PixelQuad<GSOut>& in,Color* out )
+	// to get screen space derivatives (for texture level of detail), then pixels are shaded in
+	// 2x2 quads with helper lanes filling in where the triangle doesn't cover a pixel of the quad
+	// (only the half-space rasterizer walks in quads, the scanline one is never used for these)
+	static constexpr bool quadShading = requires( const typename Effect::PixelShader& ps,const PixelQuad<GSOut>& in,Color* out )
+	{
+		ps( in,out );
+	};
+	// effects whose pixel shader can write a pixel's surface to a g-buffer, ps( const GSOut& in,GBufferTexel& out )
+	// (or ps( const PixelQuad<GSOut>& in,GBufferTexel* out ) for quad shaders), and light a g-buffer texel,
+	// ps.Light( const GBufferTexel& ) (BasePhongShader has it), can be shaded deferred (SetDeferredShading):
+	// drawing then only fills the g-buffer and the lighting runs once per pixel still visible at
+	// Graphics::EndFrame, so pixels drawn over later (by any pipeline sharing the zbuffer) are never lit
+	// a packet overload ps.Light( const GBufferTexel* in,Color* out ) lights FloatPacket::size pixels at once
+	static constexpr bool deferredShading = requires( const typename Effect::PixelShader& ps,const GBufferTexel& texel )
+	{
+		ps.Light( texel );
+	} && (quadShading ?
+		requires( const typename Effect::PixelShader& ps,const PixelQuad<GSOut>& in,GBufferTexel* out ) { ps( in,out ); } :
+		requires( const typename Effect::PixelShader& ps,const GSOut& in,GBufferTexel& out ) { ps( in,out ); });
+	static constexpr bool packetLighting = requires( const typename Effect::PixelShader& ps,const GBufferTexel* in,Color* out )
+	{
+		ps.Light( in,out );
+	};
+	// effects can give their vertex shader vs.Position( const Vertex& ), the clip space position
+	// its full output would have (computed the same way); in lazy vertex shading mode all
+	// positions are then worked out first and the backface and frustum tests done on them, so
+	// only vertices of triangles that go on to the geometry shader are shaded in full
+	// (the geometry shader has to leave positions as they are for that, which DrawOccluder and
+	//  the bounds culling assume too)
+	static constexpr bool positionShading = requires( const typename Effect::VertexShader& vs,const Vertex& v )
+	{
+		{ vs.Position( v ) } -> std::same_as<Vec4>;
+	};
+	// cross product (%) shenanigans: the triangle's normal points toward the eye
+	static bool FacesEye( const Vec4& p0,const Vec4& p1,const Vec4& p2,const Vec4& eyepos )
+	{
+		return (p1 - p0) % (p2 - p0) * Vec3( p0 - eyepos ) <= 0.0f;
+	}
+	// all three vertices outside the same plane of the view frustum (clip space positions)
+	static bool OutsideFrustum( const Vec4& p0,const Vec4& p1,const Vec4& p2 )
+	{
+		return (p0.x > p0.w && p1.x > p1.w && p2.x > p2.w) ||
+			(p0.x < -p0.w && p1.x < -p1.w && p2.x < -p2.w) ||
+			(p0.y > p0.w && p1.y > p1.w && p2.y > p2.w) ||
+			(p0.y < -p0.w && p1.y < -p1.w && p2.y < -p2.w) ||
+			(p0.z > p0.w && p1.z > p1.w && p2.z > p2.w) ||
+			(p0.z < 0.0f && p1.z < 0.0f && p2.z < 0.0f);
+	}
+	// vertex cache statistics for the last draw in lazy vertex shading mode
+	struct VertexCacheStats
+	{
+		size_t vertices;
+		size_t hits;
+		size_t misses;
+		float HitRate() const
+		{
+			return hits + misses == 0 ? 0.0f : float( hits ) / float( hits + misses );
+		}
+		// vs invocations avoided compared to shading the whole vertex list
+		// (negative if the cache is too small for the mesh's index order)
+		long long SavedInvocations() const
+		{
+			return (long long)vertices - (long long)misses;
+		}
+	};
 public:
 	Pipeline( Graphics& gfx )
 		:
 		Pipeline( gfx,std::make_shared<ZBuffer>( gfx.ScreenWidth,gfx.ScreenHeight ) )
 	{}
 	Pipeline( Graphics& gfx,std::shared_ptr<ZBuffer> pZb_in )
+		:
+		Pipeline( gfx,std::move( pZb_in ),std::make_shared<FrameArena>() )
+	{}
+	// pipelines that draw into the same frame can share their scratch memory arena
+	Pipeline( Graphics& gfx,std::shared_ptr<ZBuffer> pZb_in,std::shared_ptr<FrameArena> pArena_in )
 		:
 		gfx( gfx ),
-		pZb( std::move( pZb_in ) )
+		pZb( std::move( pZb_in ) ),
+		pArena( std::move( pArena_in ) )
 	{
 		assert( pZb->GetHeight() == gfx.ScreenHeight && pZb->GetWidth() == gfx.ScreenWidth );
 	}
+	~Pipeline()
+	{
+		if constexpr( deferredShading )
+		{
+			if( pGBuffer )
+			{
+				gfx.RemoveEndFramePass( endFramePass );
+			}
+		}
+	}
+	// the end of frame pass of deferred shading points back at the pipeline
+	Pipeline( const Pipeline& ) = delete;
+	Pipeline& operator=( const Pipeline& ) = delete;
+	// meshes with bounds (IndexedTriangleList::bounds) are skipped entirely when those are outside
+	// the view frustum of the vertex shader's world-view-projection (a mesh whose vertex or
+	// geometry shader moves its vertices needs bounds that cover where they move to, or none)
 	void Draw( const IndexedTriangleList<Vertex>& triList )
 	{
-		ProcessVertices( triList.vertices,triList.indices );
+		const PipelineStats before = stats;
+		const auto marker = pArena->GetMarker();
+		DrawInstance( triList,AllocateVertexScratch( triList ) );
+		pArena->Rewind( marker );
+		// in binned mode nothing has been rasterized yet, do it all now
+		// (flushing per draw keeps ordering correct w.r.t. other pipelines sharing the zbuffer)
+		if( pPool )
+		{
+			FlushBins();
+		}
+		drawStats = stats - before;
+	}
+	// draws the mesh once for each world-view transform (vs.BindWorldView is left at the last one)
+	// as one draw: vs output scratch is set up once for all instances, each instance is culled
+	// against its own bounds, and in binned mode all instances are binned before rasterizing
+	void DrawInstanced( const IndexedTriangleList<Vertex>& triList,std::span<const Mat4> worldViews )
+	{
+		const PipelineStats before = stats;
+		const auto marker = pArena->GetMarker();
+		VSOut* const pVerticesOut = AllocateVertexScratch( triList );
+		for( const auto& worldView : worldViews )
+		{
+			effect.vs.BindWorldView( worldView );
+			DrawInstance( triList,pVerticesOut );
+		}
+		pArena->Rewind( marker );
+		if( pPool )
+		{
+			FlushBins();
+		}
+		drawStats = stats - before;
+	}
+	// depth prepass: vs, clipping and rasterization as Draw does them but only the zbuffer
+	// is updated (no pixel shading, no color writes, and only the position is interpolated)
+	// the depths are worked out with the same arithmetic as a Draw with the same rasterizer,
+	// so they match bit for bit and a Draw with DepthTest::Equal finds them afterwards
+	void DrawDepth( const IndexedTriangleList<Vertex>& triList )
+	{
+		depthOnly = true;
+		Draw( triList );
+		depthOnly = false;
+	}
+	void DrawDepthInstanced( const IndexedTriangleList<Vertex>& triList,std::span<const Mat4> worldViews )
+	{
+		depthOnly = true;
+		DrawInstanced( triList,worldViews );
+		depthOnly = false;
+	}
+	// rasterizes the mesh, with the bound transforms, into the zbuffer's occluder level only
+	// (see ZBuffer::AddOccluder), for big meshes that hide a lot of others, like walls
+	// draws from then on that have occlusion culling on (SetOcclusionCulling) are skipped when
+	// their bounds are entirely behind occluders, so every occluder has to get drawn for real
+	// later in the frame, and its vertex shader must leave the positions where they are
+	// triangles that cross the near plane are left out (that only makes it less effective)
+	void DrawOccluder( const IndexedTriangleList<Vertex>& triList )
+	{
+		const Mat4& m = effect.vs.GetWorldViewProj();
+		const auto eyepos = Vec4{ 0.0f,0.0f,0.0f,1.0f } * effect.vs.GetProj();
+		const auto marker = pArena->GetMarker();
+		Vec4* const pClip = pArena->Allocate<Vec4>( triList.vertices.size() );
+		for( size_t i = 0; i < triList.vertices.size(); i++ )
+		{
+			pClip[i] = Vec4( triList.vertices[i].pos ) * m;
+		}
+		triList.indices.Visit( [&]( const auto& indices )
+		{
+			// first index of each triangle that gets rasterized, and the directed edges of those
+			size_t* const pTris = pArena->Allocate<size_t>( indices.size() / 3u );
+			uint64_t* const pEdges = pArena->Allocate<uint64_t>( indices.size() );
+			size_t nTris = 0;
+			const auto Key = []( size_t a,size_t b )
+			{
+				return (uint64_t( a ) << 32) | uint64_t( b );
+			};
+			for( size_t i = 0; i < indices.size(); i += 3 )
+			{
+				const Vec4& v0 = pClip[indices[i]];
+				const Vec4& v1 = pClip[indices[i + 1]];
+				const Vec4& v2 = pClip[indices[i + 2]];
+				// same backface test as AssembleTriangles, occluders never drawn can't hide anything
+				if( v0.z < 0.0f || v1.z < 0.0f || v2.z < 0.0f || (v1 - v0) % (v2 - v0) * Vec3( v0 - eyepos ) > 0.0f )
+				{
+					continue;
+				}
+				for( size_t k = 0; k < 3; k++ )
+				{
+					pEdges[3 * nTris + k] = Key( indices[i + k],indices[i + (k + 1) % 3] );
+				}
+				pTris[nTris++] = i;
+			}
+			std::sort( pEdges,pEdges + 3 * nTris );
+			for( size_t t = 0; t < nTris; t++ )
+			{
+				const size_t i = pTris[t];
+				Vec4 v[3];
+				// edges no other rasterized triangle shares are on the outline of the occluder
+				bool outer[3];
+				for( size_t k = 0; k < 3; k++ )
+				{
+					const Vec4& p = pClip[indices[i + k]];
+					const float wInv = 1.0f / p.w;
+					v[k] = { (p.x * wInv + 1.0f) * float( Graphics::ScreenWidth ) / 2.0f,
+						(-p.y * wInv + 1.0f) * float( Graphics::ScreenHeight ) / 2.0f,
+						p.z * wInv,wInv };
+					outer[k] = !std::binary_search( pEdges,pEdges + 3 * nTris,Key( indices[i + (k + 1) % 3],indices[i + k] ) );
+				}
+				RasterizeOccluder( v[0],v[1],v[2],outer );
+			}
+		} );
+		pArena->Rewind( marker );
 	}
 	// needed to reset the z-buffer after each frame
+	// (and checks that the previous frame didn't need to grow the scratch arena)
 	void BeginFrame()
 	{
 		pZb->Clear();
+		pArena->BeginFrame();
+	}
+	// enables tiled rendering: post-clip triangles are binned into screen tiles
+	// and the tiles are rasterized in parallel on the pool's threads
+	// (pass nullptr to go back to rasterizing everything on the calling thread)
+	// each tile draws its triangles in submission order, so output is identical to serial
+	void SetThreadPool( std::shared_ptr<ThreadPool> pPool_in )
+	{
+		pPool = std::move( pPool_in );
+		// bin storage is fixed size (bins are flushed early when they fill up),
+		// so it is allocated once here rather than grown while drawing
+		if( pPool && binnedTriangles.capacity() == 0 )
+		{
+			binnedTriangles.reserve( binnedTriangleCapacity );
+			binnedPositions.reserve( binnedTriangleCapacity );
+			bins.resize( nTilesX * nTilesY );
+			for( auto& bin : bins )
+			{
+				bin.reserve( binCapacity );
+			}
+			tileStats.resize( nTilesX * nTilesY );
+		}
+	}
+	// enables lazy vertex shading: instead of running the vs over the entire vertex list
+	// up front, vertices are shaded when triangle assembly first needs them and kept in
+	// a post-transform cache of the given policy and size (vertices no index refers to
+	// are never shaded; a vertex evicted before its last use is shaded again)
+	void SetLazyVertexShading( typename PostTransformCache<VSOut>::Policy policy,size_t cacheSize )
+	{
+		pVertexCache = std::make_unique<PostTransformCache<VSOut>>( policy,cacheSize );
+	}
+	// back to shading the whole vertex list up front (the default)
+	void SetEagerVertexShading()
+	{
+		pVertexCache.reset();
+	}
+	const VertexCacheStats& GetVertexCacheStats() const
+	{
+		return vertexCacheStats;
+	}
+	void SetRasterizer( Rasterizer rasterizer_in )
+	{
+		rasterizer = rasterizer_in;
+	}
+	// draws of meshes with levels of detail (IndexedTriangleList::lods) use the coarsest one
+	// whose lodError comes to at most pixelError pixels on screen, going by how many pixels a
+	// model unit spans at the near side of the mesh's bounding sphere (each instance of a
+	// DrawInstanced picks its own)
+	void SetLodSelection( float pixelError )
+	{
+		lodPixelError = pixelError;
+	}
+	// skip draws whose bounds are behind the occluders drawn so far this frame (DrawOccluder)
+	// or behind what's already in the zbuffer, counted as draws_occluded (off by default)
+	void SetOcclusionCulling( bool culling_in )
+	{
+		occlusionCulling = culling_in;
+	}
+	// always draw the full detail mesh (the default)
+	void SetFullDetail()
+	{
+		lodPixelError.reset();
+	}
+	// DrawDepth always tests Less
+	void SetDepthTest( DepthTest depthTest_in )
+	{
+		depthTest = depthTest_in;
+	}
+	// effects that support it (see deferredShading) can be shaded deferred, pass true to have
+	// draws fill the g-buffer and light what is still visible at Graphics::EndFrame (no effect on
+	// other effects); the g-buffer and the end of frame pass are only set up by the first deferred draw
+	// the lighting runs with the pixel shader's state at EndFrame, so whatever it lights with (light
+	// position and colors, bound light list) has to stay the same for all deferred draws of a frame
+	// pixels already in the g-buffer are still lit at the end of the frame after switching back
+	void SetDeferredShading( bool deferred_in )
+	{
+		deferred = deferred_in;
+	}
+	// statistics totals since construction
+	// (take the difference of two snapshots to measure a frame or any other span)
+	const PipelineStats& GetStats() const
+	{
+		return stats;
+	}
+	// statistics for the most recent Draw
+	const PipelineStats& GetDrawStats() const
+	{
+		return drawStats;
 	}
 private:
+	// one instance of a draw with the bound transforms, vs output goes to pVerticesOut
+	// (room for all of the mesh's vertices, unused with lazy vertex shading)
+	void DrawInstance( const IndexedTriangleList<Vertex>& triList,VSOut* pVerticesOut )
+	{
+		if( triList.bounds && OutsideFrustum( *triList.bounds ) )
+		{
+			Count( stats,&PipelineStats::drawsCulled );
+			return;
+		}
+		if( occlusionCulling && triList.bounds && Occluded( *triList.bounds ) )
+		{
+			Count( stats,&PipelineStats::drawsOccluded );
+			return;
+		}
+		if constexpr( deferredShading )
+		{
+			if( deferred && !depthOnly )
+			{
+				PrepareGBuffer();
+			}
+		}
+		// levels of detail are subsets of the full mesh's vertices, pVerticesOut fits them too
+		const auto& mesh = SelectLod( triList );
+		ProcessVertices( mesh.vertices,mesh.indices,pVerticesOut );
+	}
+	// level of detail to draw the mesh at with the bound transforms (see SetLodSelection)
+	const IndexedTriangleList<Vertex>& SelectLod( const IndexedTriangleList<Vertex>& triList ) const
+	{
+		if( !lodPixelError || triList.lods.empty() || !triList.bounds )
+		{
+			return triList;
+		}
+		const Mat4& m = effect.vs.GetWorldViewProj();
+		const BoundingSphere& sphere = *triList.bounds;
+		// how much clip space x / y / w change per model unit (at most, over all directions)
+		const auto Column = [&m]( int col )
+		{
+			return Vec3{ m.elements[0][col],m.elements[1][col],m.elements[2][col] };
+		};
+		const float wNearest = sphere.center * Column( 3 ) + m.elements[3][3] - sphere.radius * Column( 3 ).Len();
+		if( wNearest <= 0.0f )
+		{
+			// the sphere reaches the eye, no telling how big it gets on screen
+			return triList;
+		}
+		const float pixelsPerUnit = std::max(
+			Column( 0 ).Len() * float( Graphics::ScreenWidth ),
+			Column( 1 ).Len() * float( Graphics::ScreenHeight ) ) * 0.5f / wNearest;
+		return triList.GetLod( *lodPixelError / pixelsPerUnit );
+	}
+	// vs output scratch for a draw of the mesh, from the frame arena (caller rewinds)
+	VSOut* AllocateVertexScratch( const IndexedTriangleList<Vertex>& triList )
+	{
+		return pVertexCache ? nullptr : pArena->Allocate<VSOut>( triList.vertices.size() );
+	}
+	// whether the sphere (model space) is entirely outside one of the clip planes
+	// the planes are taken back to model space through the world-view-projection, where the
+	// sphere is still a sphere whatever scaling the transform has, so the test is exact
+	bool OutsideFrustum( const BoundingSphere& sphere ) const
+	{
+		const Mat4& m = effect.vs.GetWorldViewProj();
+		// clip space position is v * m, a clip plane a * x + b * y + c * z + d * w >= 0
+		// is then the plane with coefficients m * (a,b,c,d) in model space
+		const auto Outside = [&m,&sphere]( float a,float b,float c,float d )
+		{
+			const auto Coefficient = [&m,a,b,c,d]( int row )
+			{
+				return m.elements[row][0] * a + m.elements[row][1] * b + m.elements[row][2] * c + m.elements[row][3] * d;
+			};
+			const Vec3 n = { Coefficient( 0 ),Coefficient( 1 ),Coefficient( 2 ) };
+			return n * sphere.center + Coefficient( 3 ) < -sphere.radius * n.Len();
+		};
+		// same planes as ClipCullTriangle: -w <= x,y <= w, 0 <= z <= w
+		return Outside( 1.0f,0.0f,0.0f,1.0f ) || Outside( -1.0f,0.0f,0.0f,1.0f ) ||
+			Outside( 0.0f,1.0f,0.0f,1.0f ) || Outside( 0.0f,-1.0f,0.0f,1.0f ) ||
+			Outside( 0.0f,0.0f,1.0f,0.0f ) || Outside( 0.0f,0.0f,-1.0f,1.0f );
+	}
+	// whether the sphere (model space) is entirely behind the zbuffer's occluders
+	// tested with the screen rect and nearest depth of the sphere's bounding box, which hold
+	// for the whole sphere as long as the box is entirely in front of the near plane
+	bool Occluded( const BoundingSphere& sphere )
+	{
+		const Mat4& m = effect.vs.GetWorldViewProj();
+		float xMin = std::numeric_limits<float>::infinity();
+		float yMin = xMin;
+		float nearest = xMin;
+		float xMax = -xMin;
+		float yMax = -xMin;
+		for( int corner = 0; corner < 8; corner++ )
+		{
+			const Vec3 offset = {
+				(corner & 1) ? sphere.radius : -sphere.radius,
+				(corner & 2) ? sphere.radius : -sphere.radius,
+				(corner & 4) ? sphere.radius : -sphere.radius
+			};
+			const Vec4 p = Vec4( sphere.center + offset ) * m;
+			if( p.z < 0.0f )
+			{
+				return false;
+			}
+			const float wInv = 1.0f / p.w;
+			const float x = (p.x * wInv + 1.0f) * float( Graphics::ScreenWidth ) / 2.0f;
+			const float y = (-p.y * wInv + 1.0f) * float( Graphics::ScreenHeight ) / 2.0f;
+			xMin = std::min( xMin,x );
+			xMax = std::max( xMax,x );
+			yMin = std::min( yMin,y );
+			yMax = std::max( yMax,y );
+			nearest = std::min( nearest,p.z * wInv );
+		}
+		// clamp in float first, the rect can be far off screen
+		const auto Clamp = []( float v,int size )
+		{
+			return int( std::clamp( std::floor( v ),0.0f,float( size - 1 ) ) );
+		};
+		return pZb->RectOccluded( Clamp( xMin,Graphics::ScreenWidth ),Clamp( yMin,Graphics::ScreenHeight ),
+			Clamp( xMax,Graphics::ScreenWidth ),Clamp( yMax,Graphics::ScreenHeight ),nearest );
+	}
+	// adds the pixel coverage of a screen space triangle (x,y pixels, z depth) to the
+	// occluder level, one hi-z tile at a time: the pixel centers the triangle covers on the
+	// rasterizers' fixed point grid, and the farthest its depth plane gets over the tile (no
+	// farther than its farthest corner)
+	// outer[k] marks the edge from vertex k to the next as part of the occluder's outline,
+	// those edges are pulled in by a subpixel so the coverage stays inside what the real draw
+	// covers when that mesh is tessellated differently or its vertices snap the other way
+	// (shared edges aren't, the top-left rule gives their pixels to exactly one of the triangles)
+	void RasterizeOccluder( Vec4 v0,Vec4 v1,Vec4 v2,const bool( &outer )[3] )
+	{
+		SnapToSubpixel( v0 );
+		SnapToSubpixel( v1 );
+		SnapToSubpixel( v2 );
+		const int64_t fixedArea = FixedArea( v0,v1,v2 );
+		if( fixedArea == 0 )
+		{
+			return;
+		}
+		// edges oriented positive inside, like the rasterizers'
+		const Vec4& p1 = fixedArea > 0 ? v1 : v2;
+		const Vec4& p2 = fixedArea > 0 ? v2 : v1;
+		const EdgeFunction edges[3] = {
+			{ p1,p2 },
+			{ p2,v0 },
+			{ v0,p1 }
+		};
+		const bool inset[3] = { outer[1],fixedArea > 0 ? outer[2] : outer[0],fixedArea > 0 ? outer[0] : outer[2] };
+		const auto Covers = [&]( size_t k,int64_t e )
+		{
+			return inset[k] ? edges[k].CoversInset( e ) : edges[k].Covers( e );
+		};
+		// depth plane z = v0.z + dzdx * (x - v0.x) + dzdy * (y - v0.y)
+		const float area = (v1.x - v0.x) * (v2.y - v0.y) - (v2.x - v0.x) * (v1.y - v0.y);
+		const float dzdx = ((v1.z - v0.z) * (v2.y - v0.y) - (v2.z - v0.z) * (v1.y - v0.y)) / area;
+		const float dzdy = ((v2.z - v0.z) * (v1.x - v0.x) - (v1.z - v0.z) * (v2.x - v0.x)) / area;
+		const float zFarthest = std::max( { v0.z,v1.z,v2.z } );
+
+		constexpr int tileSize = ZBuffer::tileSize;
+		const auto TileRange = []( float lo,float hi,int size )
+		{
+			return std::pair<int,int>{
+				int( std::clamp( std::floor( lo ),0.0f,float( size - 1 ) ) ) / tileSize,
+				int( std::clamp( std::ceil( hi ),0.0f,float( size - 1 ) ) ) / tileSize
+			};
+		};
+		const auto [tx0,tx1] = TileRange( std::min( { v0.x,v1.x,v2.x } ),std::max( { v0.x,v1.x,v2.x } ),Graphics::ScreenWidth );
+		const auto [ty0,ty1] = TileRange( std::min( { v0.y,v1.y,v2.y } ),std::max( { v0.y,v1.y,v2.y } ),Graphics::ScreenHeight );
+		for( int ty = ty0; ty <= ty1; ty++ )
+		{
+			for( int tx = tx0; tx <= tx1; tx++ )
+			{
+				// edge functions are linear, so over the tile's pixel centers they are smallest
+				// and largest at its corner ones: trivially accept or reject the tile from those
+				const int x0 = tx * tileSize;
+				const int y0 = ty * tileSize;
+				const int x1 = x0 + tileSize - 1;
+				const int y1 = y0 + tileSize - 1;
+				bool rejected = false;
+				bool accepted = true;
+				for( size_t k = 0; k < 3; k++ )
+				{
+					const int64_t e00 = edges[k].At( x0,y0 );
+					const int64_t e10 = edges[k].At( x1,y0 );
+					const int64_t e01 = edges[k].At( x0,y1 );
+					const int64_t e11 = edges[k].At( x1,y1 );
+					rejected = rejected || !Covers( k,std::max( { e00,e10,e01,e11 } ) );
+					accepted = accepted && Covers( k,std::min( { e00,e10,e01,e11 } ) );
+				}
+				if( rejected )
+				{
+					continue;
+				}
+				uint64_t mask = ~uint64_t( 0 );
+				if( !accepted )
+				{
+					mask = 0u;
+					for( int y = 0; y < tileSize; y++ )
+					{
+						for( int x = 0; x < tileSize; x++ )
+						{
+							if( Covers( 0,edges[0].At( x0 + x,y0 + y ) ) &&
+								Covers( 1,edges[1].At( x0 + x,y0 + y ) ) &&
+								Covers( 2,edges[2].At( x0 + x,y0 + y ) ) )
+							{
+								mask |= uint64_t( 1 ) << (y * tileSize + x);
+							}
+						}
+					}
+				}
+				// the plane is farthest at one of the corner pixel centers of the tile too
+				// (plus how far it can move with the vertices here and in the real draw snapping
+				//  half a subpixel each)
+				const float span = float( tileSize - 1 );
+				const float zPlane = v0.z + dzdx * (float( x0 ) + 0.5f - v0.x) + dzdy * (float( y0 ) + 0.5f - v0.y) +
+					std::max( dzdx * span,0.0f ) + std::max( dzdy * span,0.0f ) +
+					(std::abs( dzdx ) + std::abs( dzdy )) / subpixelSteps;
+				pZb->AddOccluder( tx,ty,mask & pZb->GetTileMask( tx,ty ),std::min( zPlane,zFarthest ) );
+			}
+		}
+	}
 	// vertex processing function
 	// transforms vertices using vs and then passes vtx & idx lists to triangle assembler
-	void ProcessVertices( const std::vector<Vertex>& vertices,const std::vector<size_t>& indices )
+	// pVerticesOut is scratch for the vs output of every vertex (when shading eagerly)
+	void ProcessVertices( const std::vector<Vertex>& vertices,const IndexBuffer& indices,VSOut* pVerticesOut )
 	{
-		// create vertex vector for vs output
-		std::vector<VSOut> verticesOut( vertices.size() );
+		if( pVertexCache )
+		{
+			// shade on demand as the assembler walks the index stream
+			pVertexCache->Reset();
+			const auto fetch = [this,&vertices]( size_t i )
+			{
+				return pVertexCache->Fetch( i,[this,&vertices]( size_t i )
+				{
+					Count( stats,&PipelineStats::vsInvocations );
+					return effect.vs( vertices[i] );
+				} );
+			};
+			if constexpr( positionShading )
+			{
+				// culled triangles never get to fetch their vertices
+				const auto marker = pArena->GetMarker();
+				Vec4* const pPositions = pArena->Allocate<Vec4>( vertices.size() );
+				for( size_t i = 0; i < vertices.size(); i++ )
+				{
+					pPositions[i] = effect.vs.Position( vertices[i] );
+				}
+				AssembleCulledTriangles( indices,pPositions,fetch );
+				pArena->Rewind( marker );
+			}
+			else
+			{
+				AssembleTriangles( indices,fetch );
+			}
+			vertexCacheStats = { vertices.size(),pVertexCache->GetHits(),pVertexCache->GetMisses() };
+			return;
+		}
 
 		// transform vertices with vs
-		std::transform( vertices.begin(),vertices.end(),
-						verticesOut.begin(),
-						effect.vs );
+		for( size_t i = 0; i < vertices.size(); i++ )
+		{
+			new( &pVerticesOut[i] ) VSOut( effect.vs( vertices[i] ) );
+		}
+		Count( stats,&PipelineStats::vsInvocations,vertices.size() );
 
 		// assemble triangles from stream of indices and vertices
-		AssembleTriangles( verticesOut,indices );
+		AssembleTriangles( indices,[pVerticesOut]( size_t i ) -> const VSOut&
+		{
+			return pVerticesOut[i];
+		} );
 	}
 	// triangle assembly function
 	// assembles indexed vertex stream into triangles and passes them to post process
 	// culls (does not send) back facing triangles
-	void AssembleTriangles( const std::vector<VSOut>& vertices,const std::vector<size_t>& indices )
+	// fetch( index ) supplies the vs output for a vertex index
+	template<class FetchVertex>
+	void AssembleTriangles( const IndexBuffer& indices,FetchVertex&& fetch )
+	{
+		// pick the loop for the buffer's index width once, not per index
+		indices.Visit( [this,&fetch]( const auto& typedIndices )
+		{
+			AssembleTriangles( typedIndices,fetch );
+		} );
+	}
+	template<class Index,class FetchVertex>
+	void AssembleTriangles( const std::vector<Index>& indices,FetchVertex&& fetch )
 	{
 		const auto eyepos = Vec4{ 0.0f,0.0f,0.0f,1.0f } * effect.vs.GetProj();
+		Count( stats,&PipelineStats::trianglesAssembled,indices.size() / 3 );
 		// assemble triangles in the stream and process
 		for( size_t i = 0,end = indices.size() / 3;
 			 i < end; i++ )
 		{
 			// determine triangle vertices via indexing
-			const auto& v0 = vertices[indices[i * 3]];
-			const auto& v1 = vertices[indices[i * 3 + 1]];
-			const auto& v2 = vertices[indices[i * 3 + 2]];
-			// cull backfacing triangles with cross product (%) shenanigans
-			if( (v1.pos - v0.pos) % (v2.pos - v0.pos) * Vec3(v0.pos - eyepos) <= 0.0f )
+			// (fetch may return by value, so lifetime extension keeps these valid)
+			const auto& v0 = fetch( indices[i * 3] );
+			const auto& v1 = fetch( indices[i * 3 + 1] );
+			const auto& v2 = fetch( indices[i * 3 + 2] );
+			// cull backfacing triangles
+			if( FacesEye( v0.pos,v1.pos,v2.pos,eyepos ) )
 			{
 				// process 3 vertices into a triangle
 				ProcessTriangle( v0,v1,v2,i );
 			}
+			else
+			{
+				Count( stats,&PipelineStats::backfaceCulled );
+			}
 		}
 	}
+	// triangle assembly with the clip space positions of all vertices known up front
+	// (see positionShading): backface and frustum culling happen before fetch( index ) is
+	// called, so only vertices of the triangles that are left get shaded
+	template<class FetchVertex>
+	void AssembleCulledTriangles( const IndexBuffer& indices,const Vec4* pPositions,FetchVertex&& fetch )
+	{
+		indices.Visit( [this,pPositions,&fetch]( const auto& typedIndices )
+		{
+			const auto eyepos = Vec4{ 0.0f,0.0f,0.0f,1.0f } * effect.vs.GetProj();
+			Count( stats,&PipelineStats::trianglesAssembled,typedIndices.size() / 3 );
+			for( size_t i = 0,end = typedIndices.size() / 3; i < end; i++ )
+			{
+				const Vec4& p0 = pPositions[typedIndices[i * 3]];
+				const Vec4& p1 = pPositions[typedIndices[i * 3 + 1]];
+				const Vec4& p2 = pPositions[typedIndices[i * 3 + 2]];
+				if( !FacesEye( p0,p1,p2,eyepos ) )
+				{
+					Count( stats,&PipelineStats::backfaceCulled );
+					continue;
+				}
+				// ClipCullTriangle would drop it after the geometry shader
+				if( OutsideFrustum( p0,p1,p2 ) )
+				{
+					Count( stats,&PipelineStats::frustumCulled );
+					continue;
+				}
+				const auto& v0 = fetch( typedIndices[i * 3] );
+				const auto& v1 = fetch( typedIndices[i * 3 + 1] );
+				const auto& v2 = fetch( typedIndices[i * 3 + 2] );
+				ProcessTriangle( v0,v1,v2,i );
+			}
+		} );
+	}
 	// triangle processing function
 	// passes 3 vertices to gs to generate triangle
 	// sends generated triangle to post-processing
@@ -93,46 +721,16 @@ private:
 	void ClipCullTriangle( Triangle<GSOut>& t )
 	{
 		// cull tests
-		if( t.v0.pos.x > t.v0.pos.w &&
-			t.v1.pos.x > t.v1.pos.w &&
-			t.v2.pos.x > t.v2.pos.w )
-		{
-			return;
-		}
-		if( t.v0.pos.x < -t.v0.pos.w &&
-			t.v1.pos.x < -t.v1.pos.w &&
-			t.v2.pos.x < -t.v2.pos.w )
-		{
-			return;
-		}
-		if( t.v0.pos.y > t.v0.pos.w &&
-			t.v1.pos.y > t.v1.pos.w &&
-			t.v2.pos.y > t.v2.pos.w )
-		{
-			return;
-		}
-		if( t.v0.pos.y < -t.v0.pos.w &&
-			t.v1.pos.y < -t.v1.pos.w &&
-			t.v2.pos.y < -t.v2.pos.w )
-		{
-			return;
-		}
-		if( t.v0.pos.z > t.v0.pos.w &&
-			t.v1.pos.z > t.v1.pos.w &&
-			t.v2.pos.z > t.v2.pos.w )
-		{
-			return;
-		}
-		if( t.v0.pos.z < 0.0f &&
-			t.v1.pos.z < 0.0f &&
-			t.v2.pos.z < 0.0f )
+		if( OutsideFrustum( t.v0.pos,t.v1.pos,t.v2.pos ) )
 		{
+			Count( stats,&PipelineStats::frustumCulled );
 			return;
 		}
 
 		// clipping routines
 		const auto Clip1 = [this]( GSOut& v0,GSOut& v1,GSOut& v2 )
 		{
+			Count( stats,&PipelineStats::nearClippedInto2 );
 			// calculate alpha values for getting adjusted vertices
 			const float alphaA = (-v0.pos.z) / (v1.pos.z - v0.pos.z);
 			const float alphaB = (-v0.pos.z) / (v2.pos.z - v0.pos.z);
@@ -151,6 +749,7 @@ private:
 		};
 		const auto Clip2 = [this]( GSOut& v0,GSOut& v1,GSOut& v2 )
 		{
+			Count( stats,&PipelineStats::nearClippedInto1 );
 			// calculate alpha values for getting adjusted vertices
 			const float alpha0 = (-v0.pos.z) / (v2.pos.z - v0.pos.z);
 			const float alpha1 = (-v1.pos.z) / (v2.pos.z - v1.pos.z);
@@ -165,6 +764,7 @@ private:
 		};
 
 		// near clipping tests
+		// (vertices are passed on rotated, never swapped, so the pieces keep the triangle's winding)
 		if( t.v0.pos.z < 0.0f )
 		{
 			if( t.v1.pos.z < 0.0f )
@@ -173,7 +773,7 @@ private:
 			}
 			else if( t.v2.pos.z < 0.0f )
 			{
-				Clip2( t.v0,t.v2,t.v1 );
+				Clip2( t.v2,t.v0,t.v1 );
 			}
 			else
 			{
@@ -188,7 +788,7 @@ private:
 			}
 			else
 			{
-				Clip1( t.v1,t.v0,t.v2 );
+				Clip1( t.v1,t.v2,t.v0 );
 			}
 		}
 		else if( t.v2.pos.z < 0.0f )
@@ -202,47 +802,463 @@ private:
 	}
 	// vertex post-processing function
 	// perform perspective and viewport transformations
-	void PostProcessTriangleVertices( Triangle<GSOut>& triangle )
+	template<class V>
+	void PostProcessTriangleVertices( Triangle<V>& triangle )
 	{
+		// the depth prepass drops everything but the position from here on
+		if constexpr( std::is_same_v<V,GSOut> )
+		{
+			if( depthOnly )
+			{
+				Triangle<PositionInterpolant> positions = { { triangle.v0.pos },{ triangle.v1.pos },{ triangle.v2.pos } };
+				PostProcessTriangleVertices( positions );
+				return;
+			}
+		}
+
 		// perspective divide and screen transform for all 3 vertices
 		pst.Transform( triangle.v0 );
 		pst.Transform( triangle.v1 );
 		pst.Transform( triangle.v2 );
+		// onto the rasterizers' fixed point grid (see EdgeFunction), so that coverage and
+		// attribute interpolation both see the same triangle
+		SnapToSubpixel( triangle.v0.pos );
+		SnapToSubpixel( triangle.v1.pos );
+		SnapToSubpixel( triangle.v2.pos );
+		// front facing triangles wind clockwise on screen (positive area); one seen almost edge on
+		// can pass the backface test and then come out of snapping with no area or turned
+		// around, it would cover pixels its neighbors already do
+		if( FixedArea( triangle.v0.pos,triangle.v1.pos,triangle.v2.pos ) <= 0 )
+		{
+			Count( stats,&PipelineStats::backfaceCulled );
+			return;
+		}
 
-		// draw the triangle
-		DrawTriangle( triangle );
+		// draw the triangle (or defer it to the tiles it touches)
+		if( pPool )
+		{
+			BinTriangle( triangle );
+		}
+		else
+		{
+			RasterizeTriangle( triangle,screenRect,stats );
+		}
+	}
+	// === tiled rendering functions ===
+	//
+	// adds screen space triangle to the bin of every tile overlapped by its bounding box
+	template<class V>
+	void BinTriangle( const Triangle<V>& triangle )
+	{
+		auto& binned = GetBinnedTriangles<V>();
+		const float xMin = std::min( { triangle.v0.pos.x,triangle.v1.pos.x,triangle.v2.pos.x } );
+		const float xMax = std::max( { triangle.v0.pos.x,triangle.v1.pos.x,triangle.v2.pos.x } );
+		const float yMin = std::min( { triangle.v0.pos.y,triangle.v1.pos.y,triangle.v2.pos.y } );
+		const float yMax = std::max( { triangle.v0.pos.y,triangle.v1.pos.y,triangle.v2.pos.y } );
+		// clamp in float first, vertices can be far outside the screen
+		const int tileLeft = int( std::clamp( xMin,0.0f,float( Graphics::ScreenWidth - 1 ) ) ) / tileSize;
+		const int tileRight = int( std::clamp( xMax,0.0f,float( Graphics::ScreenWidth - 1 ) ) ) / tileSize;
+		const int tileTop = int( std::clamp( yMin,0.0f,float( Graphics::ScreenHeight - 1 ) ) ) / tileSize;
+		const int tileBottom = int( std::clamp( yMax,0.0f,float( Graphics::ScreenHeight - 1 ) ) ) / tileSize;
+
+		// out of bin space: rasterize what we have so far and start over
+		// (tiles still see their triangles in submission order)
+		bool full = binned.size() == binnedTriangleCapacity;
+		for( int ty = tileTop; ty <= tileBottom && !full; ty++ )
+		{
+			for( int tx = tileLeft; tx <= tileRight && !full; tx++ )
+			{
+				full = bins[ty * nTilesX + tx].size() == binCapacity;
+			}
+		}
+		if( full )
+		{
+			FlushBins();
+		}
+
+		const auto index = (unsigned int)binned.size();
+		binned.push_back( triangle );
+		for( int ty = tileTop; ty <= tileBottom; ty++ )
+		{
+			for( int tx = tileLeft; tx <= tileRight; tx++ )
+			{
+				bins[ty * nTilesX + tx].push_back( index );
+			}
+		}
+	}
+	// rasterizes all binned triangles, one tile per job, and empties the bins
+	// (the bins only ever hold triangles of one kind, they are flushed at the end of every draw)
+	void FlushBins()
+	{
+		if( depthOnly )
+		{
+			FlushBins( binnedPositions );
+		}
+		else
+		{
+			FlushBins( binnedTriangles );
+		}
+	}
+	template<class V>
+	void FlushBins( std::vector<Triangle<V>>& binned )
+	{
+		if( binned.empty() )
+		{
+			return;
+		}
+		pPool->ParallelFor( bins.size(),[this,&binned]( size_t iTile )
+		{
+			const RectI tileRect = GetTileRect( iTile );
+			auto& bin = bins[iTile];
+			for( const auto i : bin )
+			{
+				RasterizeTriangle( binned[i],tileRect,tileStats[iTile].stats );
+			}
+			bin.clear();
+		} );
+		binned.clear();
+		GatherTileStats();
+	}
+	template<class V>
+	std::vector<Triangle<V>>& GetBinnedTriangles()
+	{
+		if constexpr( std::is_same_v<V,GSOut> )
+		{
+			return binnedTriangles;
+		}
+		else
+		{
+			return binnedPositions;
+		}
+	}
+	static RectI GetTileRect( size_t iTile )
+	{
+		const int tx = int( iTile % nTilesX );
+		const int ty = int( iTile / nTilesX );
+		return {
+			ty * tileSize,
+			std::min( (ty + 1) * tileSize,(int)Graphics::ScreenHeight ),
+			tx * tileSize,
+			std::min( (tx + 1) * tileSize,(int)Graphics::ScreenWidth )
+		};
+	}
+	// adds up what the tiles counted
+	void GatherTileStats()
+	{
+		for( auto& ts : tileStats )
+		{
+			stats += ts.stats;
+			ts.stats = {};
+		}
+	}
+	// === deferred shading lighting pass ===
+	// runs at Graphics::EndFrame, lights every g-buffer texel written this frame whose depth
+	// is still the one in the zbuffer (whatever was drawn over it later, by this or any other
+	// pipeline, passed the depth test with a nearer depth), tile by tile on the pool if there is one
+	void LightGBuffer()
+	{
+		// nothing drawn deferred this frame
+		if( !gbufferPending )
+		{
+			return;
+		}
+		gbufferPending = false;
+		if( pPool )
+		{
+			pPool->ParallelFor( size_t( nTilesX * nTilesY ),[this]( size_t iTile )
+			{
+				LightRect( GetTileRect( iTile ),tileStats[iTile].stats );
+			} );
+			GatherTileStats();
+		}
+		else
+		{
+			LightRect( screenRect,stats );
+		}
+	}
+	// lights the g-buffer texels in rect (which must line up with the g-buffer's tiles)
+	void LightRect( const RectI& rect,PipelineStats& lightStats )
+	{
+		constexpr int gTileSize = GBuffer::tileSize;
+		LightPacket packet;
+		for( int ty = rect.top / gTileSize; ty * gTileSize < rect.bottom; ty++ )
+		{
+			for( int tx = rect.left / gTileSize; tx * gTileSize < rect.right; tx++ )
+			{
+				if( !pGBuffer->TakeWritten( tx,ty ) )
+				{
+					continue;
+				}
+				const int yEnd = std::min( (ty + 1) * gTileSize,rect.bottom );
+				const int xEnd = std::min( (tx + 1) * gTileSize,rect.right );
+				for( int y = ty * gTileSize; y < yEnd; y++ )
+				{
+					for( int x = tx * gTileSize; x < xEnd; x++ )
+					{
+						GBufferTexel& texel = pGBuffer->At( x,y );
+						if( texel.depth == pZb->At( x,y ) )
+						{
+							if constexpr( packetLighting )
+							{
+								packet.texels[packet.count] = texel;
+								packet.xs[packet.count] = x;
+								packet.ys[packet.count] = y;
+								if( ++packet.count == FloatPacket::size )
+								{
+									FlushLightPacket( packet,lightStats );
+								}
+							}
+							else
+							{
+								gfx.PutPixel( x,y,effect.ps.Light( texel ) );
+								Count( lightStats,&PipelineStats::psInvocations );
+								CountLights( texel,lightStats );
+								Count( lightStats,&PipelineStats::pixelsWritten );
+							}
+						}
+						// lit (or drawn over), either way done with until written again
+						texel.depth = std::numeric_limits<float>::quiet_NaN();
+					}
+				}
+			}
+		}
+		FlushLightPacket( packet,lightStats );
+	}
+	// visible g-buffer texels waiting to be lit together
+	// (only used when the effect has a packet Light)
+	struct LightPacket
+	{
+		GBufferTexel texels[FloatPacket::size];
+		int xs[FloatPacket::size];
+		int ys[FloatPacket::size];
+		int count = 0;
+	};
+	void FlushLightPacket( LightPacket& packet,PipelineStats& lightStats )
+	{
+		if constexpr( packetLighting )
+		{
+			if( packet.count == 0 )
+			{
+				return;
+			}
+			// masked lanes get a copy of a live lane so the shader math stays well behaved
+			for( int i = packet.count; i < FloatPacket::size; i++ )
+			{
+				packet.texels[i] = packet.texels[0];
+			}
+			Color colors[FloatPacket::size];
+			effect.ps.Light( packet.texels,colors );
+			for( int i = 0; i < packet.count; i++ )
+			{
+				gfx.PutPixel( packet.xs[i],packet.ys[i],colors[i] );
+			}
+			CountPacketLights( packet.texels,size_t( packet.count ),lightStats );
+			Count( lightStats,&PipelineStats::psInvocations,size_t( packet.count ) );
+			Count( lightStats,&PipelineStats::pixelsWritten,size_t( packet.count ) );
+			packet.count = 0;
+		}
 	}
 	// === triangle rasterization functions ===
 	//   it0, it1, etc. stand for interpolants
 	//   (values which are interpolated across a triangle in screen space)
+	//   clip is the pixel rectangle we are allowed to touch (right/bottom exclusive)
+	//   and must not change anything about the values computed for a given pixel
+	//   rasterStats is where the work is counted (one per tile when rendering tiled)
+	//   V is the interpolant, GSOut or PositionInterpolant for the depth prepass
 	//
-	// entry point for tri rasterization
+	// screen positions are snapped to 28.4 fixed point after the screen transform
+	// (pixels with 4 fractional bits, like d3d), so that edge functions can be evaluated
+	// exactly in integers: with the top-left rule that makes every pixel center on an edge
+	// shared by two triangles belong to exactly one of them
+	static constexpr int subpixelBits = 4;
+	static constexpr float subpixelSteps = float( 1 << subpixelBits );
+	static void SnapToSubpixel( Vec4& pos )
+	{
+		pos.x = std::round( pos.x * subpixelSteps ) / subpixelSteps;
+		pos.y = std::round( pos.y * subpixelSteps ) / subpixelSteps;
+	}
+	// snapped screen coordinate to fixed point
+	// clamped far outside the screen (2^25 pixels), which keeps products of two coordinate
+	// differences well inside 64 bits; nan goes to the clamp too
+	static int64_t ToFixed( float v )
+	{
+		constexpr float limit = float( 1 << 29 );
+		const float f = v * subpixelSteps;
+		return f > -limit ? (f < limit ? int64_t( f ) : int64_t( limit )) : -int64_t( limit );
+	}
+	// fixed point coordinate of the center of pixel i
+	static int64_t PixelCenter( int i )
+	{
+		return int64_t( i ) * (1 << subpixelBits) + (1 << (subpixelBits - 1));
+	}
+	// twice the signed area of a screen space triangle in fixed point units, 0 when degenerate
+	static int64_t FixedArea( const Vec4& p0,const Vec4& p1,const Vec4& p2 )
+	{
+		const int64_t x0 = ToFixed( p0.x );
+		const int64_t y0 = ToFixed( p0.y );
+		return (ToFixed( p1.x ) - x0) * (ToFixed( p2.y ) - y0) - (ToFixed( p1.y ) - y0) * (ToFixed( p2.x ) - x0);
+	}
+	// edge function for the directed edge a -> b, positive on the inside of the triangle
+	// (when the triangle's vertices have been ordered to give it positive area)
+	// evaluated in fixed point at pixel centers, so it is exact and the same for both
+	// triangles on an edge up to sign
+	class EdgeFunction
+	{
+	public:
+		EdgeFunction( const Vec4& a,const Vec4& b )
+			:
+			EdgeFunction( ToFixed( a.x ),ToFixed( a.y ),ToFixed( b.x ),ToFixed( b.y ) )
+		{}
+		EdgeFunction( int64_t ax,int64_t ay,int64_t bx,int64_t by )
+			:
+			a( ay - by ),
+			b( bx - ax ),
+			c( -(a * ax + b * ay) ),
+			// top-left fill rule: pixel centers exactly on an edge belong to the triangle
+			// only if it is a left edge (inside towards +x) or a top edge (flat, inside towards +y)
+			threshold( a > 0 || (a == 0 && b > 0) ? 0 : 1 )
+		{}
+		// value at the center of pixel x,y
+		int64_t At( int x,int y ) const
+		{
+			return a * PixelCenter( x ) + b * PixelCenter( y ) + c;
+		}
+		// change in edge function for every 1 pixel in x / y
+		int64_t StepX() const
+		{
+			return a * (1 << subpixelBits);
+		}
+		int64_t StepY() const
+		{
+			return b * (1 << subpixelBits);
+		}
+		bool Covers( int64_t e ) const
+		{
+			return e >= threshold;
+		}
+		// still covers with the edge moved a subpixel towards the inside in x and y
+		bool CoversInset( int64_t e ) const
+		{
+			return e >= threshold + std::abs( a ) + std::abs( b );
+		}
+		// narrows the pixels [xStart,xEnd) of scanline y to those whose centers this edge covers
+		// (solved for x exactly, rounding towards the inside)
+		void ClipSpan( int y,int& xStart,int& xEnd ) const
+		{
+			// covered where a * PixelCenter( x ) >= rest
+			const int64_t rest = threshold - (b * PixelCenter( y ) + c);
+			constexpr int64_t half = 1 << (subpixelBits - 1);
+			constexpr int64_t step = 1 << subpixelBits;
+			if( a > 0 )
+			{
+				const int64_t first = CeilDiv( CeilDiv( rest,a ) - half,step );
+				xStart = int( std::min<int64_t>( std::max<int64_t>( xStart,first ),xEnd ) );
+			}
+			else if( a < 0 )
+			{
+				const int64_t last = FloorDiv( FloorDiv( rest,a ) - half,step );
+				xEnd = int( std::max<int64_t>( std::min<int64_t>( xEnd,last + 1 ),xStart ) );
+			}
+			else if( rest > 0 )
+			{
+				xEnd = xStart;
+			}
+		}
+	private:
+		static int64_t FloorDiv( int64_t n,int64_t d )
+		{
+			const int64_t q = n / d;
+			return q * d != n && (n < 0) != (d < 0) ? q - 1 : q;
+		}
+		static int64_t CeilDiv( int64_t n,int64_t d )
+		{
+			const int64_t q = n / d;
+			return q * d != n && (n < 0) == (d < 0) ? q + 1 : q;
+		}
+	private:
+		// e( X,Y ) = a * X + b * Y + c in fixed point coordinates
+		int64_t a;
+		int64_t b;
+		int64_t c;
+		// smallest value that covers (0 on top / left edges, 1 on the rest)
+		int64_t threshold;
+	};
+	// entry point for tri rasterization, dispatches to the selected rasterizer
+	template<class V>
+	void RasterizeTriangle( const Triangle<V>& triangle,const RectI& clip,PipelineStats& rasterStats )
+	{
+		if constexpr( quadShading )
+		{
+			DrawTriangleHalfSpace( triangle,clip,rasterStats );
+		}
+		else
+		{
+			switch( rasterizer )
+			{
+			case Rasterizer::Scanline:
+				DrawTriangle( triangle,clip,rasterStats );
+				break;
+			case Rasterizer::HalfSpace:
+				DrawTriangleHalfSpace( triangle,clip,rasterStats );
+				break;
+			}
+		}
+	}
+	// scanline rasterizer entry point
 	// sorts vertices, determines case, splits to flat tris, dispatches to flat tri funcs
-	void DrawTriangle( const Triangle<GSOut>& triangle )
+	// which pixels get drawn is decided by the fixed point edge functions of the whole
+	// triangle, the flat tris only carry the interpolants of their scanlines
+	template<class V>
+	void DrawTriangle( const Triangle<V>& triangle,const RectI& clip,PipelineStats& rasterStats )
 	{
+		// edges oriented positive inside, like the half-space rasterizer's
+		const int64_t area = FixedArea( triangle.v0.pos,triangle.v1.pos,triangle.v2.pos );
+		if( area == 0 )
+		{
+			return;
+		}
+		const Vec4& p1 = area > 0 ? triangle.v1.pos : triangle.v2.pos;
+		const Vec4& p2 = area > 0 ? triangle.v2.pos : triangle.v1.pos;
+		const EdgeFunction edges[3] = {
+			{ p1,p2 },
+			{ p2,triangle.v0.pos },
+			{ triangle.v0.pos,p1 }
+		};
+
 		// using pointers so we can swap (for sorting purposes)
-		const GSOut* pv0 = &triangle.v0;
-		const GSOut* pv1 = &triangle.v1;
-		const GSOut* pv2 = &triangle.v2;
+		const V* pv0 = &triangle.v0;
+		const V* pv1 = &triangle.v1;
+		const V* pv2 = &triangle.v2;
 
 		// sorting vertices by y
 		if( pv1->pos.y < pv0->pos.y ) std::swap( pv0,pv1 );
 		if( pv2->pos.y < pv1->pos.y ) std::swap( pv1,pv2 );
 		if( pv1->pos.y < pv0->pos.y ) std::swap( pv0,pv1 );
 
+		// scanlines whose centers are in the top half / bottom half (split at v1's y,
+		// a scanline through v1 goes to the bottom half), clipped
+		// (clamp in float first, vertices can be far outside the screen)
+		const auto Scanline = [&clip]( float y )
+		{
+			return (int)ceil( std::clamp( y,float( clip.top ),float( clip.bottom ) ) - 0.5f );
+		};
+		const int yStart = std::max( Scanline( pv0->pos.y ),clip.top );
+		const int ySplit = std::clamp( Scanline( pv1->pos.y ),clip.top,clip.bottom );
+		const int yEnd = std::min( (int)floor( std::clamp( pv2->pos.y,float( clip.top ),float( clip.bottom ) ) - 0.5f ) + 1,clip.bottom );
+
 		if( pv0->pos.y == pv1->pos.y ) // natural flat top
 		{
 			// sorting top vertices by x
 			if( pv1->pos.x < pv0->pos.x ) std::swap( pv0,pv1 );
 
-			DrawFlatTopTriangle( *pv0,*pv1,*pv2 );
+			DrawFlatTopTriangle( *pv0,*pv1,*pv2,ySplit,yEnd,edges,clip,rasterStats );
 		}
 		else if( pv1->pos.y == pv2->pos.y ) // natural flat bottom
 		{
 			// sorting bottom vertices by x
 			if( pv2->pos.x < pv1->pos.x ) std::swap( pv1,pv2 );
 
-			DrawFlatBottomTriangle( *pv0,*pv1,*pv2 );
+			DrawFlatBottomTriangle( *pv0,*pv1,*pv2,yStart,ySplit,edges,clip,rasterStats );
 		}
 		else // general triangle
 		{
@@ -254,20 +1270,26 @@ private:
 
 			if( pv1->pos.x < vi.pos.x ) // major right
 			{
-				DrawFlatBottomTriangle( *pv0,*pv1,vi );
-				DrawFlatTopTriangle( *pv1,vi,*pv2 );
+				DrawFlatBottomTriangle( *pv0,*pv1,vi,yStart,ySplit,edges,clip,rasterStats );
+				DrawFlatTopTriangle( *pv1,vi,*pv2,ySplit,yEnd,edges,clip,rasterStats );
 			}
 			else // major left
 			{
-				DrawFlatBottomTriangle( *pv0,vi,*pv1 );
-				DrawFlatTopTriangle( vi,*pv1,*pv2 );
+				DrawFlatBottomTriangle( *pv0,vi,*pv1,yStart,ySplit,edges,clip,rasterStats );
+				DrawFlatTopTriangle( vi,*pv1,*pv2,ySplit,yEnd,edges,clip,rasterStats );
 			}
 		}
 	}
 	// does flat *TOP* tri-specific calculations and calls DrawFlatTriangle
-	void DrawFlatTopTriangle( const GSOut& it0,
-							  const GSOut& it1,
-							  const GSOut& it2 )
+	template<class V>
+	void DrawFlatTopTriangle( const V& it0,
+							  const V& it1,
+							  const V& it2,
+							  int yStart,
+							  int yEnd,
+							  const EdgeFunction( &edges )[3],
+							  const RectI& clip,
+							  PipelineStats& rasterStats )
 	{
 		// calulcate dVertex / dy
 		// change in interpolant for every 1 change in y
@@ -275,16 +1297,19 @@ private:
 		const auto dit0 = (it2 - it0) / delta_y;
 		const auto dit1 = (it2 - it1) / delta_y;
 
-		// create right edge interpolant
-		auto itEdge1 = it1;
-
-		// call the flat triangle render routine
-		DrawFlatTriangle( it0,it1,it2,dit0,dit1,itEdge1 );
+		// right edge starts at it1
+		DrawFlatTriangle( it0,dit0,dit1,it1,yStart,yEnd,edges,clip,rasterStats );
 	}
 	// does flat *BOTTOM* tri-specific calculations and calls DrawFlatTriangle
-	void DrawFlatBottomTriangle( const GSOut& it0,
-								 const GSOut& it1,
-								 const GSOut& it2 )
+	template<class V>
+	void DrawFlatBottomTriangle( const V& it0,
+								 const V& it1,
+								 const V& it2,
+								 int yStart,
+								 int yEnd,
+								 const EdgeFunction( &edges )[3],
+								 const RectI& clip,
+								 PipelineStats& rasterStats )
 	{
 		// calulcate dVertex / dy
 		// change in interpolant for every 1 change in y
@@ -292,68 +1317,530 @@ private:
 		const auto dit0 = (it1 - it0) / delta_y;
 		const auto dit1 = (it2 - it0) / delta_y;
 
-		// create right edge interpolant
-		auto itEdge1 = it0;
-
-		// call the flat triangle render routine
-		DrawFlatTriangle( it0,it1,it2,dit0,dit1,itEdge1 );
+		// right edge starts at it0
+		DrawFlatTriangle( it0,dit0,dit1,it0,yStart,yEnd,edges,clip,rasterStats );
 	}
 	// does processing common to both flat top and flat bottom tris
-	// scan over triangle in screen space, interpolate attributes,
+	// scan over scanlines [yStart,yEnd) in screen space, interpolate attributes,
 	// depth cull, invoke ps and write pixel to screen
-	void DrawFlatTriangle( const GSOut& it0,
-						   const GSOut& it1,
-						   const GSOut& it2,
-						   const GSOut& dv0,
-						   const GSOut& dv1,
-						   GSOut itEdge1 )
+	// edge and scanline interpolants are evaluated directly at each pixel center
+	// instead of being accumulated, so a pixel gets the same bits no matter
+	// where the clip rect makes the walk start (this is what keeps tiled == serial)
+	template<class V>
+	void DrawFlatTriangle( const V& it0,
+						   const V& dv0,
+						   const V& dv1,
+						   const V& itEdge1Start,
+						   int yStart,
+						   int yEnd,
+						   const EdgeFunction( &edges )[3],
+						   const RectI& clip,
+						   PipelineStats& rasterStats )
 	{
-		// create edge interpolant for left edge (always v0)
-		auto itEdge0 = it0;
+		// spans narrower than this get their interpolants spread over it instead, the float
+		// edges can cross at the tips where the exact ones still cover a pixel
+		constexpr float minSpanWidth = 1.0f / 1024.0f;
 
-		// calculate start and end scanlines
-		const int yStart = std::max( (int)ceil( it0.pos.y - 0.5f ),0 );
-		const int yEnd = std::min( (int)ceil( it2.pos.y - 0.5f ),(int)Graphics::ScreenHeight - 1 ); // the scanline AFTER the last line drawn
-
-		// do interpolant prestep
-		itEdge0 += dv0 * (float( yStart ) + 0.5f - it0.pos.y);
-		itEdge1 += dv1 * (float( yStart ) + 0.5f - it0.pos.y);
-
-		for( int y = yStart; y < yEnd; y++,itEdge0 += dv0,itEdge1 += dv1 )
+		PixelPacket packet;
+		for( int y = yStart; y < yEnd; y++ )
 		{
-			// calculate start and end pixels
-			const int xStart = std::max( (int)ceil( itEdge0.pos.x - 0.5f ),0 );
-			const int xEnd = std::min( (int)ceil( itEdge1.pos.x - 0.5f ),(int)Graphics::ScreenWidth - 1 ); // the pixel AFTER the last pixel drawn
+			// calculate start and end pixels (exactly, from the edge functions)
+			int xStart = clip.left;
+			int xEnd = clip.right; // the pixel AFTER the last pixel drawn
+			for( const auto& e : edges )
+			{
+				e.ClipSpan( y,xStart,xEnd );
+			}
+			if( xStart >= xEnd )
+			{
+				continue;
+			}
+
+			// edge interpolants at this scanline's center (left edge is always from v0)
+			const float edgeStep = float( y ) + 0.5f - it0.pos.y;
+			const auto itEdge0 = it0 + dv0 * edgeStep;
+			const auto itEdge1 = itEdge1Start + dv1 * edgeStep;
 
-			// create scanline interpolant startpoint
+			// calculate delta scanline interpolant / dx
 			// (some waste for interpolating x,y,z, but makes life easier not having
 			//  to split them off, and z will be needed in the future anyways...)
-			auto iLine = itEdge0;
+			const float dx = std::max( itEdge1.pos.x - itEdge0.pos.x,minSpanWidth );
+			const auto diLine = (itEdge1 - itEdge0) / dx;
+			// packed for the per-pixel loop
+			const InterpolantBlock<V> blockEdge0( itEdge0 );
+			const InterpolantBlock<V> blockLine( diLine );
 
-			// calculate delta scanline interpolant / dx
-			const float dx = itEdge1.pos.x - itEdge0.pos.x;
-			const auto diLine = (itEdge1 - iLine) / dx;
+			// walk the span in segments that line up with the hi-z tiles
+			for( int xSeg = xStart; xSeg < xEnd; )
+			{
+				const int xSegEnd = std::min( (xSeg / ZBuffer::tileSize + 1) * ZBuffer::tileSize,xEnd );
+				// z is linear along the span, so its nearest value is at one of the segment ends
+				// (same expression as the full interpolant below, so these are the exact pixel depths)
+				const float zFirst = itEdge0.pos.z + diLine.pos.z * (float( xSeg ) + 0.5f - itEdge0.pos.x);
+				const float zLast = itEdge0.pos.z + diLine.pos.z * (float( xSegEnd - 1 ) + 0.5f - itEdge0.pos.x);
+				if( !TileRejects<V>( xSeg,y,std::min( zFirst,zLast ),rasterStats ) )
+				{
+					for( int x = xSeg; x < xSegEnd; x++ )
+					{
+						ShadePixel( x,y,blockEdge0 + blockLine * (float( x ) + 0.5f - itEdge0.pos.x),itEdge0,packet,rasterStats );
+					}
+				}
+				xSeg = xSegEnd;
+			}
+		}
+		FlushPacket( packet,rasterStats );
+	}
+	// half-space rasterizer entry point
+	// walks the bounding box in 8x8 blocks aligned to the screen; blocks entirely outside
+	// one edge are skipped, blocks entirely inside all edges are filled without per-pixel
+	// edge tests, and attributes come from plane equations set up once per triangle
+	template<class V>
+	void DrawTriangleHalfSpace( const Triangle<V>& triangle,const RectI& clip,PipelineStats& rasterStats )
+	{
+		// blocks line up with the zbuffer's 8x8 hi-z tiles
+		constexpr int blockSize = ZBuffer::tileSize;
 
-			// prestep scanline interpolant
-			iLine += diLine * (float( xStart ) + 0.5f - itEdge0.pos.x);
+		const V* pv0 = &triangle.v0;
+		const V* pv1 = &triangle.v1;
+		const V* pv2 = &triangle.v2;
 
-			for( int x = xStart; x < xEnd; x++,iLine += diLine )
+		// twice the signed area, swap to positive so all edge functions are positive inside
+		// (exact on the fixed point grid, so orientation agrees with the edge functions)
+		int64_t fixedArea = FixedArea( pv0->pos,pv1->pos,pv2->pos );
+		if( fixedArea < 0 )
+		{
+			std::swap( pv1,pv2 );
+			fixedArea = -fixedArea;
+		}
+		else if( fixedArea == 0 )
+		{
+			// degenerate (or nan)
+			return;
+		}
+		const float area = float( fixedArea ) / (subpixelSteps * subpixelSteps);
+
+		// range of pixels whose centers lie within the bounding box, clipped
+		// (clamp in float first, vertices can be far outside the screen)
+		const auto xMinMax = std::minmax( { pv0->pos.x,pv1->pos.x,pv2->pos.x } );
+		const auto yMinMax = std::minmax( { pv0->pos.y,pv1->pos.y,pv2->pos.y } );
+		const int xStart = std::max( (int)ceil( std::clamp( xMinMax.first,float( clip.left ),float( clip.right ) ) - 0.5f ),clip.left );
+		const int xEnd = std::min( (int)floor( std::clamp( xMinMax.second,float( clip.left ),float( clip.right ) ) - 0.5f ) + 1,clip.right );
+		const int yStart = std::max( (int)ceil( std::clamp( yMinMax.first,float( clip.top ),float( clip.bottom ) ) - 0.5f ),clip.top );
+		const int yEnd = std::min( (int)floor( std::clamp( yMinMax.second,float( clip.top ),float( clip.bottom ) ) - 0.5f ) + 1,clip.bottom );
+
+		// edges opposite v0, v1, v2
+		const EdgeFunction edges[3] = {
+			{ pv1->pos,pv2->pos },
+			{ pv2->pos,pv0->pos },
+			{ pv0->pos,pv1->pos }
+		};
+
+		// attribute plane equations: attr( x,y ) = v0 + ddx * (x - x0) + ddy * (y - y0)
+		const float dx1 = pv1->pos.x - pv0->pos.x;
+		const float dy1 = pv1->pos.y - pv0->pos.y;
+		const float dx2 = pv2->pos.x - pv0->pos.x;
+		const float dy2 = pv2->pos.y - pv0->pos.y;
+		const auto d1 = *pv1 - *pv0;
+		const auto d2 = *pv2 - *pv0;
+		const auto ddx = (d1 * dy2 - d2 * dy1) / area;
+		const auto ddy = (d2 * dx1 - d1 * dx2) / area;
+		// ddx packed for stepping the per-pixel loops
+		const InterpolantBlock<V> ddxBlock( ddx );
+		// nearest depth anywhere on the triangle, bounds the hi-z test for each block
+		const float zMin = std::min( { pv0->pos.z,pv1->pos.z,pv2->pos.z } );
+
+		PixelPacket packet;
+		for( int by = yStart & ~(blockSize - 1); by < yEnd; by += blockSize )
+		{
+			const int yBlockStart = std::max( by,yStart );
+			const int yBlockEnd = std::min( by + blockSize,yEnd );
+			for( int bx = xStart & ~(blockSize - 1); bx < xEnd; bx += blockSize )
+			{
+				const int xBlockStart = std::max( bx,xStart );
+				const int xBlockEnd = std::min( bx + blockSize,xEnd );
+
+				// classify block against each edge by the extremes over its pixel centers
+				// (edge functions are linear, so extremes are at the corners)
+				bool outside = false;
+				bool inside = true;
+				for( const auto& e : edges )
+				{
+					const int64_t eCorner = e.At( xBlockStart,yBlockStart );
+					const int64_t spanX = e.StepX() * (xBlockEnd - 1 - xBlockStart);
+					const int64_t spanY = e.StepY() * (yBlockEnd - 1 - yBlockStart);
+					const int64_t eMin = eCorner + std::min<int64_t>( spanX,0 ) + std::min<int64_t>( spanY,0 );
+					const int64_t eMax = eCorner + std::max<int64_t>( spanX,0 ) + std::max<int64_t>( spanY,0 );
+					if( !e.Covers( eMax ) )
+					{
+						outside = true;
+						break;
+					}
+					inside = inside && e.Covers( eMin );
+				}
+				if( outside )
+				{
+					continue;
+				}
+
+				// hi-z: skip the block if the nearest the triangle can get within it is behind the tile
+				// (the block lines up with a single hi-z tile)
+				{
+					const float zCorner = pv0->pos.z +
+						ddx.pos.z * (float( xBlockStart ) + 0.5f - pv0->pos.x) +
+						ddy.pos.z * (float( yBlockStart ) + 0.5f - pv0->pos.y);
+					const float zBlockMin = zCorner +
+						std::min( ddx.pos.z * float( xBlockEnd - 1 - xBlockStart ),0.0f ) +
+						std::min( ddy.pos.z * float( yBlockEnd - 1 - yBlockStart ),0.0f );
+					if( TileRejects<V>( xBlockStart,yBlockStart,std::max( zBlockMin,zMin ),rasterStats ) )
+					{
+						continue;
+					}
+				}
+
+				if constexpr( quadShading )
+				{
+					ShadeQuads( { yBlockStart,yBlockEnd,xBlockStart,xBlockEnd },inside,edges,*pv0,ddx,ddy,rasterStats );
+				}
+				else
+				{
+					for( int y = yBlockStart; y < yBlockEnd; y++ )
+					{
+						const float px = float( xBlockStart ) + 0.5f;
+						const float py = float( y ) + 0.5f;
+						// interpolant at first pixel of block row, stepped by ddx from there
+						InterpolantBlock<V> iLine( *pv0 + ddx * (px - pv0->pos.x) + ddy * (py - pv0->pos.y) );
+						if( inside )
+						{
+							for( int x = xBlockStart; x < xBlockEnd; x++,iLine += ddxBlock )
+							{
+								ShadePixel( x,y,iLine,*pv0,packet,rasterStats );
+							}
+						}
+						else
+						{
+							int64_t e0 = edges[0].At( xBlockStart,y );
+							int64_t e1 = edges[1].At( xBlockStart,y );
+							int64_t e2 = edges[2].At( xBlockStart,y );
+							for( int x = xBlockStart; x < xBlockEnd; x++,iLine += ddxBlock,
+								 e0 += edges[0].StepX(),e1 += edges[1].StepX(),e2 += edges[2].StepX() )
+							{
+								if( edges[0].Covers( e0 ) && edges[1].Covers( e1 ) && edges[2].Covers( e2 ) )
+								{
+									ShadePixel( x,y,iLine,*pv0,packet,rasterStats );
+								}
+							}
+						}
+					}
+				}
+			}
+		}
+		FlushPacket( packet,rasterStats );
+	}
+	// quad version of the per-pixel loops over one block of the half-space rasterizer
+	// walks the block in 2x2 quads on even pixel coordinates (so quads never straddle
+	// blocks, tiles or hi-z tiles); lanes outside the block or the triangle are helpers
+	// that get interpolated but not depth tested or written
+	// v0 / ddx / ddy are the attribute plane equations set up by DrawTriangleHalfSpace
+	template<class V>
+	void ShadeQuads( const RectI& block,bool inside,const EdgeFunction( &edges )[3],
+		const V& v0,const V& ddx,const V& ddy,PipelineStats& rasterStats )
+	{
+		// edge value offsets of the lanes from the quad's top left one
+		int64_t laneSteps[3][4];
+		for( int k = 0; k < 3; k++ )
+		{
+			for( int i = 0; i < 4; i++ )
+			{
+				laneSteps[k][i] = (i & 1) * edges[k].StepX() + (i >> 1) * edges[k].StepY();
+			}
+		}
+		const int qxStart = block.left & ~1;
+		for( int qy = block.top & ~1; qy < block.bottom; qy += 2 )
+		{
+			// edge values at the top left lane of the row's first quad, stepped from quad to quad
+			int64_t e0 = edges[0].At( qxStart,qy );
+			int64_t e1 = edges[1].At( qxStart,qy );
+			int64_t e2 = edges[2].At( qxStart,qy );
+			for( int qx = qxStart; qx < block.right; qx += 2,
+				 e0 += 2 * edges[0].StepX(),e1 += 2 * edges[1].StepX(),e2 += 2 * edges[2].StepX() )
+			{
+				// depth test the lanes on the z plane alone, the full interpolants are only
+				// worked out for quads that have a lane to shade
+				// (same arithmetic as for the lanes' pos.z in ShadeQuad, so the depths match)
+				const float px = float( qx ) + 0.5f;
+				const float py = float( qy ) + 0.5f;
+				const float zQuad = v0.pos.z + ddx.pos.z * (px - v0.pos.x) + ddy.pos.z * (py - v0.pos.y);
+				const float zs[4] = { zQuad,zQuad + ddx.pos.z,zQuad + ddy.pos.z,zQuad + ddx.pos.z + ddy.pos.z };
+				unsigned int liveMask = 0u;
+				for( int i = 0; i < 4; i++ )
+				{
+					const int x = qx + (i & 1);
+					const int y = qy + (i >> 1);
+					if( x < block.left || x >= block.right || y < block.top || y >= block.bottom )
+					{
+						continue;
+					}
+					if( !inside )
+					{
+						if( !edges[0].Covers( e0 + laneSteps[0][i] ) ||
+							!edges[1].Covers( e1 + laneSteps[1][i] ) ||
+							!edges[2].Covers( e2 + laneSteps[2][i] ) )
+						{
+							continue;
+						}
+					}
+					if( PassesDepthTest<V>( x,y,zs[i],rasterStats ) )
+					{
+						liveMask |= 1u << i;
+					}
+				}
+				// the depth prepass is done once the depths are in
+				if constexpr( std::is_same_v<V,GSOut> )
+				{
+					if( liveMask != 0u )
+					{
+						const auto itQuad = v0 + ddx * (px - v0.pos.x) + ddy * (py - v0.pos.y);
+						const V its[4] = { itQuad,itQuad + ddx,itQuad + ddy,itQuad + ddx + ddy };
+						ShadeQuad( qx,qy,its,liveMask,rasterStats );
+					}
+				}
+			}
+		}
+	}
+	// attribute recovery and shading of a quad with at least one lane that passed the depth test
+	// its are the screen space interpolants of the lanes
+	void ShadeQuad( int qx,int qy,const GSOut( &its )[4],unsigned int liveMask,PipelineStats& rasterStats )
+	{
+		PixelQuad<GSOut> quad;
+		quad.liveMask = liveMask;
+		// recover attributes from the screen space interpolants (1/w is the interpolated pos.w)
+		// a helper lane far enough off a steep triangle can extrapolate 1/w to zero or below,
+		// those take a live lane's attributes instead (derivatives there are meaningless anyway)
+		int firstLive = 0;
+		while( !quad.IsLive( firstLive ) )
+		{
+			firstLive++;
+		}
+		for( int i = 0; i < 4; i++ )
+		{
+			const GSOut& it = its[i].pos.w > 0.0f ? its[i] : its[firstLive];
+			quad.lanes[i] = it * (1.0f / it.pos.w);
+		}
+		if constexpr( deferredShading )
+		{
+			if( deferred )
+			{
+				GBufferTexel texels[4];
+				effect.ps( quad,texels );
+				for( int i = 0; i < 4; i++ )
+				{
+					if( quad.IsLive( i ) )
+					{
+						WriteGBuffer( qx + (i & 1),qy + (i >> 1),texels[i],its[i].pos.z,rasterStats );
+					}
+				}
+				return;
+			}
+		}
+		Color colors[4];
+		effect.ps( quad,colors );
+		size_t nLive = 0;
+		for( int i = 0; i < 4; i++ )
+		{
+			if( quad.IsLive( i ) )
+			{
+				gfx.PutPixel( qx + (i & 1),qy + (i >> 1),colors[i] );
+				nLive++;
+			}
+		}
+		// helper lanes are shaded (and counted) too, with the lights of the whole quad
+		static_assert( FloatPacket::size == 4 );
+		CountPacketLights( quad.lanes,4,rasterStats );
+		Count( rasterStats,&PipelineStats::psInvocations,4 );
+		Count( rasterStats,&PipelineStats::pixelsWritten,nLive );
+	}
+	// interpolant of the depth prepass, just the position
+	// (same math on it as every effect's GSOut does on its pos, so depths come out the same)
+	struct PositionInterpolant : Interpolant<PositionInterpolant>
+	{
+		PositionInterpolant() = default;
+		PositionInterpolant( const Vec4& pos )
+			:
+			pos( pos )
+		{}
+		static constexpr auto Attributes()
+		{
+			return std::make_tuple();
+		}
+		Vec4 pos;
+	};
+	// adds to a statistics counter (compiles to nothing when stats are disabled)
+	static void Count( PipelineStats& s,size_t PipelineStats::* counter,size_t n = 1 )
+	{
+		if constexpr( PipelineStats::enabled )
+		{
+			s.*counter += n;
+		}
+	}
+	// counts the lights a pixel shader invocation with input in was shaded with,
+	// for pixel shaders that can tell, ps.LightCount( in ) (in is a GSOut or a GBufferTexel)
+	template<class Input>
+	void CountLights( const Input& in,PipelineStats& s ) const
+	{
+		if constexpr( PipelineStats::enabled && requires( const typename Effect::PixelShader& ps ) { ps.LightCount( in ); } )
+		{
+			s.lightsShaded += effect.ps.LightCount( in );
+		}
+	}
+	// the same for a packet of FloatPacket::size inputs shaded together, lanes of which are counted
+	// as invocations; packet shaders light every lane with the lights of all of them (ps.PacketLightCount( in ))
+	template<class Input>
+	void CountPacketLights( const Input* in,size_t lanes,PipelineStats& s ) const
+	{
+		if constexpr( PipelineStats::enabled && requires( const typename Effect::PixelShader& ps ) { ps.PacketLightCount( in ); } )
+		{
+			s.lightsShaded += effect.ps.PacketLightCount( in ) * lanes;
+		}
+	}
+	// pixels that passed the depth test, waiting to be shaded together
+	// (only used when the effect has a packet pixel shader)
+	struct PixelPacket
+	{
+		GSOut attributes[FloatPacket::size];
+		int xs[FloatPacket::size];
+		int ys[FloatPacket::size];
+		int count = 0;
+	};
+	// depth test, attribute recovery and shading of one covered pixel
+	// it is the screen space interpolant (attributes premultiplied by 1/w), packed; flat is the
+	// vertex members that aren't interpolated come from
+	void ShadePixel( int x,int y,const InterpolantBlock<GSOut>& it,const GSOut& flat,PixelPacket& packet,PipelineStats& rasterStats )
+	{
+		// do z rejection / update of z buffer
+		// skip shading step if z rejected (early z)
+		if( PassesDepthTest<GSOut>( x,y,it.Z(),rasterStats ) )
+		{
+			// recover interpolated z from interpolated 1/z
+			const float w = 1.0f / it.W();
+			// recover interpolated attributes
+			// (only now are they unpacked from the block, z rejected pixels never are)
+			const GSOut attributes = (it * w).Unpack( flat,float( x ) + 0.5f,float( y ) + 0.5f );
+			if constexpr( deferredShading )
 			{
-				// do z rejection / update of z buffer
-				// skip shading step if z rejected (early z)
-				if( pZb->TestAndSet( x,y,iLine.pos.z ) )
+				if( deferred )
 				{
-					// recover interpolated z from interpolated 1/z
-					const float w = 1.0f / iLine.pos.w;
-					// recover interpolated attributes
-					// (wasted effort in multiplying pos (x,y,z) here, but
-					//  not a huge deal, not worth the code complication to fix)
-					const auto attr = iLine * w;
-					// invoke pixel shader with interpolated vertex attributes
-					// and use result to set the pixel color on the screen
-					gfx.PutPixel( x,y,effect.ps( attr ) );
+					GBufferTexel texel;
+					effect.ps( attributes,texel );
+					WriteGBuffer( x,y,texel,it.Z(),rasterStats );
+					return;
 				}
 			}
+			if constexpr( packetShading )
+			{
+				// queue up pixel, shading happens once the packet is full
+				// (pixels of one triangle never overlap, so deferring the write is safe)
+				packet.attributes[packet.count] = attributes;
+				packet.xs[packet.count] = x;
+				packet.ys[packet.count] = y;
+				if( ++packet.count == FloatPacket::size )
+				{
+					FlushPacket( packet,rasterStats );
+				}
+			}
+			else
+			{
+				// invoke pixel shader with interpolated vertex attributes
+				// and use result to set the pixel color on the screen
+				gfx.PutPixel( x,y,effect.ps( attributes ) );
+				Count( rasterStats,&PipelineStats::psInvocations );
+				CountLights( attributes,rasterStats );
+				Count( rasterStats,&PipelineStats::pixelsWritten );
+			}
+		}
+	}
+	// the depth prepass has nothing to do past the depth test
+	void ShadePixel( int x,int y,const InterpolantBlock<PositionInterpolant>& it,const PositionInterpolant&,PixelPacket&,PipelineStats& rasterStats )
+	{
+		PassesDepthTest<PositionInterpolant>( x,y,it.Z(),rasterStats );
+	}
+	// depth test (and update) for one covered pixel at the given screen space depth
+	// V is the interpolant it came from, the depth prepass always tests Less, Draw uses depthTest
+	template<class V>
+	bool PassesDepthTest( int x,int y,float depth,PipelineStats& rasterStats )
+	{
+		Count( rasterStats,&PipelineStats::pixelsCovered );
+		const bool passed = std::is_same_v<V,GSOut> && depthTest == DepthTest::Equal ?
+			pZb->TestEqual( x,y,depth ) :
+			pZb->TestAndSet( x,y,depth );
+		if( !passed )
+		{
+			Count( rasterStats,&PipelineStats::zRejected );
+		}
+		return passed;
+	}
+	// hi-z test matching PassesDepthTest
+	// the rasterizers' nearest depth for a block / span isn't always worked out with the same
+	// arithmetic as the pixel depths and can be off by a few ulps; that doesn't matter to Less,
+	// but Equal passes exactly the tile's farthest depth, so it only rejects with some slack
+	// (screen depths are 0..1, this is a few hundred ulps at most)
+	template<class V>
+	bool TileRejects( int x,int y,float nearestDepth,PipelineStats& rasterStats )
+	{
+		Count( rasterStats,&PipelineStats::hizTests );
+		constexpr float slack = 1.0e-5f;
+		const bool rejected = std::is_same_v<V,GSOut> && depthTest == DepthTest::Equal ?
+			pZb->TileRejectsEqual( x,y,nearestDepth - slack ) :
+			pZb->TileRejects( x,y,nearestDepth );
+		if( rejected )
+		{
+			Count( rasterStats,&PipelineStats::hizRejected );
+		}
+		return rejected;
+	}
+	// the g-buffer is screen sized and most pipelines never shade deferred,
+	// so it and the lighting pass only come with the first deferred draw
+	void PrepareGBuffer()
+	{
+		if( !pGBuffer )
+		{
+			pGBuffer = std::make_unique<GBuffer>( gfx.ScreenWidth,gfx.ScreenHeight );
+			endFramePass = gfx.AddEndFramePass( [this]() { LightGBuffer(); } );
+		}
+		gbufferPending = true;
+	}
+	// geometry pass of deferred shading, depth is what went into the zbuffer for the pixel
+	void WriteGBuffer( int x,int y,const GBufferTexel& texel,float depth,PipelineStats& rasterStats )
+	{
+		GBufferTexel& dst = pGBuffer->At( x,y );
+		dst = texel;
+		dst.depth = depth;
+		pGBuffer->MarkWritten( x,y );
+		Count( rasterStats,&PipelineStats::gbufferWritten );
+	}
+	// shades and writes out whatever pixels are in the packet
+	void FlushPacket( PixelPacket& packet,PipelineStats& rasterStats )
+	{
+		if constexpr( packetShading )
+		{
+			if( packet.count == 0 )
+			{
+				return;
+			}
+			// masked lanes get a copy of a live lane so the shader math stays well behaved
+			for( int i = packet.count; i < FloatPacket::size; i++ )
+			{
+				packet.attributes[i] = packet.attributes[0];
+			}
+			Color colors[FloatPacket::size];
+			effect.ps( packet.attributes,colors );
+			for( int i = 0; i < packet.count; i++ )
+			{
+				gfx.PutPixel( packet.xs[i],packet.ys[i],colors[i] );
+			}
+			CountPacketLights( packet.attributes,size_t( packet.count ),rasterStats );
+			Count( rasterStats,&PipelineStats::psInvocations,size_t( packet.count ) );
+			Count( rasterStats,&PipelineStats::pixelsWritten,size_t( packet.count ) );
+			packet.count = 0;
 		}
 	}
 public:
@@ -362,4 +1849,41 @@ private:
 	Graphics& gfx;
 	NDCScreenTransformer pst;
 	std::shared_ptr<ZBuffer> pZb;
+	std::shared_ptr<FrameArena> pArena;
+	Rasterizer rasterizer = Rasterizer::Scanline;
+	DepthTest depthTest = DepthTest::Less;
+	// set for the duration of a DrawDepth
+	bool depthOnly = false;
+	bool occlusionCulling = false;
+	// no value draws the full detail meshes
+	std::optional<float> lodPixelError;
+	std::unique_ptr<PostTransformCache<VSOut>> pVertexCache;
+	VertexCacheStats vertexCacheStats = {};
+	static inline const RectI screenRect = { 0,(int)Graphics::ScreenHeight,0,(int)Graphics::ScreenWidth };
+	// tiled rendering state
+	static constexpr int tileSize = 32;
+	// each hi-z tile must belong to a single screen tile (and so a single thread)
+	static_assert( tileSize % ZBuffer::tileSize == 0 );
+	static constexpr int nTilesX = (Graphics::ScreenWidth + tileSize - 1) / tileSize;
+	static constexpr int nTilesY = (Graphics::ScreenHeight + tileSize - 1) / tileSize;
+	static constexpr size_t binnedTriangleCapacity = 8192;
+	static constexpr size_t binCapacity = 2048;
+	std::shared_ptr<ThreadPool> pPool;
+	std::vector<Triangle<GSOut>> binnedTriangles;
+	std::vector<Triangle<PositionInterpolant>> binnedPositions;
+	std::vector<std::vector<unsigned int>> bins;
+	// per tile counters, padded so tiles on different threads don't share cache lines
+	struct alignas( 64 ) TileStats
+	{
+		PipelineStats stats;
+	};
+	std::vector<TileStats> tileStats;
+	PipelineStats stats;
+	PipelineStats drawStats;
+	// deferred shading state (only for effects that support it)
+	bool deferred = false;
+	std::unique_ptr<GBuffer> pGBuffer;
+	size_t endFramePass = 0;
+	// a deferred draw happened since the last lighting pass
+	bool gbufferPending = false;
 };
\ No newline at end of file
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstddef>
+
+// running totals of the work a pipeline has done at each stage
+// (like a d3d pipeline statistics query)
+// define CHILI_NO_PIPELINE_STATS to compile the counting out of the pipeline,
+// all counters then stay at zero
+class PipelineStats
+{
+public:
+#ifdef CHILI_NO_PIPELINE_STATS
+	static constexpr bool enabled = false;
+#else
+	static constexpr bool enabled = true;
+#endif
+public:
+	// calls f( pointer to counter member,name ) for every counter, in pipeline order
+	template<class F>
+	static void ForEachCounter( F&& f )
+	{
+		f( &PipelineStats::drawsCulled,"draws_culled" );
+		f( &PipelineStats::drawsOccluded,"draws_occluded" );
+		f( &PipelineStats::vsInvocations,"vs_invocations" );
+		f( &PipelineStats::trianglesAssembled,"triangles_assembled" );
+		f( &PipelineStats::backfaceCulled,"backface_culled" );
+		f( &PipelineStats::frustumCulled,"frustum_culled" );
+		f( &PipelineStats::nearClippedInto1,"near_clipped_into_1" );
+		f( &PipelineStats::nearClippedInto2,"near_clipped_into_2" );
+		f( &PipelineStats::hizTests,"hiz_tests" );
+		f( &PipelineStats::hizRejected,"hiz_rejected" );
+		f( &PipelineStats::pixelsCovered,"pixels_covered" );
+		f( &PipelineStats::zRejected,"z_rejected" );
+		f( &PipelineStats::gbufferWritten,"gbuffer_written" );
+		f( &PipelineStats::psInvocations,"ps_invocations" );
+		f( &PipelineStats::lightsShaded,"lights_shaded" );
+		f( &PipelineStats::pixelsWritten,"pixels_written" );
+	}
+	PipelineStats& operator+=( const PipelineStats& rhs )
+	{
+		ForEachCounter( [this,&rhs]( size_t PipelineStats::* c,const char* )
+		{
+			this->*c += rhs.*c;
+		} );
+		return *this;
+	}
+	PipelineStats operator+( const PipelineStats& rhs ) const
+	{
+		return PipelineStats( *this ) += rhs;
+	}
+	PipelineStats& operator-=( const PipelineStats& rhs )
+	{
+		ForEachCounter( [this,&rhs]( size_t PipelineStats::* c,const char* )
+		{
+			this->*c -= rhs.*c;
+		} );
+		return *this;
+	}
+	PipelineStats operator-( const PipelineStats& rhs ) const
+	{
+		return PipelineStats( *this ) -= rhs;
+	}
+public:
+	// draws skipped whole for their mesh's bounds being outside the view frustum
+	size_t drawsCulled = 0;
+	// draws skipped whole for their mesh's bounds being behind occluders (see Pipeline::DrawOccluder)
+	size_t drawsOccluded = 0;
+	// vertices run through the vertex shader
+	size_t vsInvocations = 0;
+	// triangles read from index lists
+	size_t trianglesAssembled = 0;
+	// triangles dropped for facing away from the eye
+	// (or for coming out of snapping to the subpixel grid turned around or without area)
+	size_t backfaceCulled = 0;
+	// triangles dropped for being entirely outside one of the clip planes
+	size_t frustumCulled = 0;
+	// triangles crossing the near plane that were clipped into 1 / into 2 triangles
+	size_t nearClippedInto1 = 0;
+	size_t nearClippedInto2 = 0;
+	// hi-z tile tests of the rasterizers' blocks (half-space) / span segments (scanline),
+	// and those that rejected the block / segment without touching its pixels
+	size_t hizTests = 0;
+	size_t hizRejected = 0;
+	// pixel centers inside a triangle that got to the depth test
+	// (pixels in blocks / spans rejected by hi-z never do)
+	size_t pixelsCovered = 0;
+	// covered pixels that failed the depth test
+	size_t zRejected = 0;
+	// depth-tested pixels whose surface went into the g-buffer (deferred shading),
+	// the pixel shader only runs for those still visible at the end of the frame
+	size_t gbufferWritten = 0;
+	// pixels run through the pixel shader (live lanes only for packet shaders,
+	// all four lanes for quad shaders since helper lanes get shaded too)
+	// with deferred shading, pixels lit by the lighting pass
+	size_t psInvocations = 0;
+	// lights evaluated for those invocations, for pixel shaders that report it (BasePhongShader::LightCount,
+	// and PacketLightCount for packets and quads, where each lane goes through the lights of all the lanes);
+	// over ps_invocations that's the average lights per pixel
+	size_t lightsShaded = 0;
+	// pixels written to the render target
+	size_t pixelsWritten = 0;
+};
\ No newline at end of file
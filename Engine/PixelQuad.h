@@ -0,0 +1,31 @@
+#pragma once
+
+// 2x2 block of pixels shaded together, for pixel shaders that need screen space derivatives
+// lanes are top left, top right, bottom left, bottom right (one FloatPacket lane each)
+// every lane holds interpolated attributes, also where the triangle doesn't cover the pixel
+// or the depth test failed (helper lanes), so differences across the quad are always valid
+template<class T>
+class PixelQuad
+{
+public:
+	// change in a member per 1 pixel step right (the same for the whole quad)
+	template<class M>
+	M Ddx( M T::* pMember ) const
+	{
+		return lanes[1].*pMember - lanes[0].*pMember;
+	}
+	// change in a member per 1 pixel step down (the same for the whole quad)
+	template<class M>
+	M Ddy( M T::* pMember ) const
+	{
+		return lanes[2].*pMember - lanes[0].*pMember;
+	}
+	// lanes whose color gets written, shaders can skip work for the others
+	bool IsLive( int lane ) const
+	{
+		return (liveMask >> lane) & 1u;
+	}
+public:
+	T lanes[4];
+	unsigned int liveMask;
+};
\ No newline at end of file
@@ -33,7 +33,7 @@ public:
 			}
 		}
 		
-		std::vector<size_t> indices;
+		IndexBuffer indices;
 		indices.reserve( sq( divisions_x * divisions_y ) * 6 );
 		{
 			const auto vxy2i = [nVertices_x]( size_t x,size_t y )
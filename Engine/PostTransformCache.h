@@ -0,0 +1,87 @@
+#pragma once
+
+#include <vector>
+#include <limits>
+#include <cassert>
+
+// caches vertex shader outputs keyed by vertex index, so vertices shared between
+// nearby triangles in the index stream are only shaded once
+template<class V>
+class PostTransformCache
+{
+public:
+	enum class Policy
+	{
+		// index picks its slot (index % size), a miss evicts whatever was there
+		DirectMapped,
+		// any slot can hold any index, a miss evicts the oldest entry
+		Fifo
+	};
+public:
+	PostTransformCache( Policy policy,size_t size )
+		:
+		policy( policy ),
+		tags( size,invalidTag ),
+		entries( size )
+	{
+		assert( size > 0 );
+	}
+	// returns the shaded vertex for index, invoking shade( index ) on a miss
+	// the reference is only valid until the next Fetch
+	template<class F>
+	const V& Fetch( size_t index,F&& shade )
+	{
+		size_t slot;
+		if( policy == Policy::DirectMapped )
+		{
+			slot = index % tags.size();
+			if( tags[slot] == index )
+			{
+				hits++;
+				return entries[slot];
+			}
+		}
+		else
+		{
+			for( size_t i = 0; i < tags.size(); i++ )
+			{
+				if( tags[i] == index )
+				{
+					hits++;
+					return entries[i];
+				}
+			}
+			slot = fifoNext;
+			fifoNext = (fifoNext + 1) % tags.size();
+		}
+		misses++;
+		tags[slot] = index;
+		entries[slot] = shade( index );
+		return entries[slot];
+	}
+	// empties the cache (indices are only meaningful within one vertex list)
+	// and zeroes the hit / miss counters
+	void Reset()
+	{
+		std::fill( tags.begin(),tags.end(),invalidTag );
+		fifoNext = 0;
+		hits = 0;
+		misses = 0;
+	}
+	size_t GetHits() const
+	{
+		return hits;
+	}
+	size_t GetMisses() const
+	{
+		return misses;
+	}
+private:
+	static constexpr size_t invalidTag = std::numeric_limits<size_t>::max();
+	Policy policy;
+	std::vector<size_t> tags;
+	std::vector<V> entries;
+	size_t fifoNext = 0;
+	size_t hits = 0;
+	size_t misses = 0;
+};
\ No newline at end of file
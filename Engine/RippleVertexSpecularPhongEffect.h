@@ -1,12 +1,15 @@
 #pragma once
 
 #include "Pipeline.h"
+#include "Interpolant.h"
 #include "BaseVertexShader.h"
 #include "DefaultGeometryShader.h"
 #include "BasePhongShader.h"
+#include "Sampler.h"
 
 // flat shading with vertex normals
-template<class Diffuse,class Specular>
+// filter picks how the texture is read, as for VertexLightTexturedEffect (only trilinear shades in quads)
+template<class Diffuse,class Specular,TextureFilter filter = TextureFilter::Point>
 class RippleVertexSpecularPhongEffect
 {
 public:
@@ -35,7 +38,7 @@ public:
 	};
 	// vertex shader
 	// output interpolates position, normal, world position
-	class VSOutput
+	class VSOutput : public Interpolant<VSOutput>
 	{
 	public:
 		VSOutput() = default;
@@ -57,53 +60,9 @@ public:
 			worldPos( worldPos ),
 			t( t )
 		{}
-		VSOutput& operator+=( const VSOutput& rhs )
+		static constexpr auto Attributes()
 		{
-			pos += rhs.pos;
-			n += rhs.n;
-			worldPos += rhs.worldPos;
-			t += rhs.t;
-			return *this;
-		}
-		VSOutput operator+( const VSOutput& rhs ) const
-		{
-			return VSOutput( *this ) += rhs;
-		}
-		VSOutput& operator-=( const VSOutput& rhs )
-		{
-			pos -= rhs.pos;
-			n -= rhs.n;
-			worldPos -= rhs.worldPos;
-			t -= rhs.t;
-			return *this;
-		}
-		VSOutput operator-( const VSOutput& rhs ) const
-		{
-			return VSOutput( *this ) -= rhs;
-		}
-		VSOutput& operator*=( float rhs )
-		{
-			pos *= rhs;
-			n *= rhs;
-			worldPos *= rhs;
-			t *= rhs;
-			return *this;
-		}
-		VSOutput operator*( float rhs ) const
-		{
-			return VSOutput( *this ) *= rhs;
-		}
-		VSOutput& operator/=( float rhs )
-		{
-			pos /= rhs;
-			n /= rhs;
-			worldPos /= rhs;
-			t /= rhs;
-			return *this;
-		}
-		VSOutput operator/( float rhs ) const
-		{
-			return VSOutput( *this ) /= rhs;
+			return std::make_tuple( &VSOutput::n,&VSOutput::worldPos,&VSOutput::t );
 		}
 	public:
 		Vec4 pos;
@@ -154,24 +113,68 @@ public:
 	{
 	public:
 		template<class Input>
-		Color operator()( const Input& in ) const
+		Color operator()( const Input& in ) const requires( filter != TextureFilter::Trilinear )
+		{
+			return this->Shade( in,sampler.Sample( in.t ) );
+		}
+		// packet version, shades FloatPacket::size pixels at once
+		template<class Input>
+		void operator()( const Input* in,Color* out ) const requires( filter != TextureFilter::Trilinear )
+		{
+			Vec2 tcs[FloatPacket::size];
+			for( int i = 0; i < FloatPacket::size; i++ )
+			{
+				tcs[i] = in[i].t;
+			}
+			Vec3 material_colors[FloatPacket::size];
+			sampler.Sample( tcs,0.0f,material_colors );
+			this->ShadePacket( Vec3Packet::Gather( in,&Input::n ),Vec3Packet::Gather( in,&Input::worldPos ),
+				Vec3Packet::Gather( material_colors ),out );
+		}
+		// g-buffer version for deferred shading, the lighting pass (BasePhongShader::Light) does the rest
+		template<class Input>
+		void operator()( const Input& in,GBufferTexel& out ) const requires( filter != TextureFilter::Trilinear )
+		{
+			out.n = in.n;
+			out.worldPos = in.worldPos;
+			out.material = sampler.Sample( in.t );
+		}
+		// shades a 2x2 quad as one packet (a quad is exactly FloatPacket::size pixels),
+		// the change in texture coordinates across it picks the mip level
+		template<class Input>
+		void operator()( const PixelQuad<Input>& in,Color* out ) const requires( filter == TextureFilter::Trilinear )
+		{
+			static_assert( FloatPacket::size == 4 );
+			const float lod = sampler.ComputeLod( in.Ddx( &Input::t ),in.Ddy( &Input::t ) );
+			Vec3 material_colors[FloatPacket::size];
+			sampler.Sample( in,&Input::t,lod,material_colors );
+			this->ShadePacket( Vec3Packet::Gather( in.lanes,&Input::n ),Vec3Packet::Gather( in.lanes,&Input::worldPos ),
+				Vec3Packet::Gather( material_colors ),out );
+		}
+		// g-buffer version for deferred shading, the lighting pass (BasePhongShader::Light) does the rest
+		template<class Input>
+		void operator()( const PixelQuad<Input>& in,GBufferTexel* out ) const requires( filter == TextureFilter::Trilinear )
 		{
-			const auto material_color = Vec3( pTex->GetPixel(
-				static_cast<unsigned int>( in.t.x * tex_width + 0.5f ) % tex_width,
-				static_cast<unsigned int>( in.t.y * tex_height + 0.5f ) % tex_width
-			) ) / 255.0f;
-			return this->Shade( in,material_color );
+			const float lod = sampler.ComputeLod( in.Ddx( &Input::t ),in.Ddy( &Input::t ) );
+			Vec3 material_colors[4];
+			sampler.Sample( in,&Input::t,lod,material_colors );
+			for( int i = 0; i < 4; i++ )
+			{
+				if( in.IsLive( i ) )
+				{
+					out[i].n = in.lanes[i].n;
+					out[i].worldPos = in.lanes[i].worldPos;
+					out[i].material = material_colors[i];
+				}
+			}
 		}
-		void BindTexture( const Surface& tex )
+		void BindTexture( const MipTexture& tex )
 		{
-			pTex = &tex;
-			tex_width = pTex->GetWidth();
-			tex_height = pTex->GetHeight();
+			sampler = TextureSampler( tex );
 		}
 	private:
-		const Surface* pTex = nullptr;
-		unsigned int tex_width;
-		unsigned int tex_height;
+		typedef Sampler<TextureAddress::Wrap,filter> TextureSampler;
+		TextureSampler sampler;
 	};
 public:
 	VertexShader vs;
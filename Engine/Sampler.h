@@ -0,0 +1,399 @@
+#pragma once
+
+#include "MipTexture.h"
+#include "PixelQuad.h"
+#include "Vec2.h"
+#include "Vec3.h"
+#include <emmintrin.h>
+#include <algorithm>
+#include <cmath>
+
+// how texture coordinates outside 0..1 are mapped onto the texture
+enum class TextureAddress
+{
+	// repeat the texture
+	Wrap,
+	// use the edge texels
+	Clamp,
+	// repeat the texture, flipped every other time
+	Mirror
+};
+
+// how texels are combined into the sampled color
+enum class TextureFilter
+{
+	// nearest texel of the nearest mip level
+	Point,
+	// 4 nearest texels of the nearest mip level
+	Bilinear,
+	// 4 nearest texels of the two nearest mip levels (blended near the middle of the step
+	// between them, the nearer level alone elsewhere)
+	Trilinear
+};
+
+// reads a MipTexture with the address mode and filter fixed at compile time, so the
+// whole lookup inlines into the pixel shader without any per texel switching
+// power of two sized levels are addressed with masks, others have their coordinates
+// reduced to one period in float first so the texel index never needs a divide
+// colors come back 0..1 per channel
+// the four lanes of a quad can be sampled in lockstep (SSE2), with the same arithmetic per lane
+// as sampling them one at a time
+template<TextureAddress address,TextureFilter filter>
+class Sampler
+{
+public:
+	Sampler() = default;
+	Sampler( const MipTexture& tex )
+		:
+		pTex( &tex )
+	{}
+	// mip level for the footprint given by the change in texture coordinates
+	// for every 1 pixel step right / down
+	float ComputeLod( const Vec2& dx,const Vec2& dy ) const
+	{
+		return pTex->ComputeLod( dx,dy );
+	}
+	// color at tc from the full size level
+	Vec3 Sample( const Vec2& tc ) const
+	{
+		return Vec3( Fetch( pTex->GetLevel( 0 ),tc ) ) * toUnit;
+	}
+	// color at tc for the level of detail lod (e.g. worked out once for a whole quad)
+	Vec3 Sample( const Vec2& tc,float lod ) const
+	{
+		if constexpr( filter == TextureFilter::Trilinear )
+		{
+			const size_t level = size_t( lod );
+			const unsigned int blend = LevelBlend( lod,level );
+			if( blend == 0u )
+			{
+				return Vec3( Fetch( pTex->GetLevel( level ),tc ) ) * toUnit;
+			}
+			const Color c1 = Fetch( pTex->GetLevel( level + 1u ),tc );
+			if( blend == 256u )
+			{
+				return Vec3( c1 ) * toUnit;
+			}
+			return Vec3( Lerp( Fetch( pTex->GetLevel( level ),tc ),c1,blend ) ) * toUnit;
+		}
+		else
+		{
+			return Vec3( Fetch( pTex->GetLevel( size_t( lod + 0.5f ) ),tc ) ) * toUnit;
+		}
+	}
+	// color at tc for the footprint given by the derivatives dx / dy
+	Vec3 Sample( const Vec2& tc,const Vec2& dx,const Vec2& dy ) const
+	{
+		return Sample( tc,ComputeLod( dx,dy ) );
+	}
+	// colors at the four tcs for the level of detail lod, all four lanes at once
+	// (the same colors as Sample( tcs[i],lod ))
+	void Sample( const Vec2* tcs,float lod,Vec3* out ) const
+	{
+		const __m128 u = _mm_setr_ps( tcs[0].x,tcs[1].x,tcs[2].x,tcs[3].x );
+		const __m128 v = _mm_setr_ps( tcs[0].y,tcs[1].y,tcs[2].y,tcs[3].y );
+		__m128i colors;
+		if constexpr( filter == TextureFilter::Trilinear )
+		{
+			const size_t level = size_t( lod );
+			const unsigned int blend = LevelBlend( lod,level );
+			if( blend == 0u )
+			{
+				colors = FetchQuad( pTex->GetLevel( level ),u,v );
+			}
+			else if( blend == 256u )
+			{
+				colors = FetchQuad( pTex->GetLevel( level + 1u ),u,v );
+			}
+			else
+			{
+				colors = LerpQuad( FetchQuad( pTex->GetLevel( level ),u,v ),FetchQuad( pTex->GetLevel( level + 1u ),u,v ),
+					_mm_set1_epi32( int( blend ) ) );
+			}
+		}
+		else if constexpr( filter == TextureFilter::Bilinear )
+		{
+			colors = FetchQuad( pTex->GetLevel( size_t( lod + 0.5f ) ),u,v );
+		}
+		else
+		{
+			for( int i = 0; i < 4; i++ )
+			{
+				out[i] = Sample( tcs[i],lod );
+			}
+			return;
+		}
+		alignas( 16 ) unsigned int dwords[4];
+		_mm_store_si128( reinterpret_cast<__m128i*>( dwords ),colors );
+		for( int i = 0; i < 4; i++ )
+		{
+			out[i] = Vec3( Color( dwords[i] ) ) * toUnit;
+		}
+	}
+	// colors at member pTc of each lane of a quad, for the quad's level of detail
+	// lanes that aren't live are sampled at a live lane's coordinates (a helper lane's can be
+	// extrapolated far off the texture)
+	template<class T>
+	void Sample( const PixelQuad<T>& quad,Vec2 T::* pTc,float lod,Vec3* out ) const
+	{
+		int firstLive = 0;
+		while( firstLive < 3 && !quad.IsLive( firstLive ) )
+		{
+			firstLive++;
+		}
+		Vec2 tcs[4];
+		for( int i = 0; i < 4; i++ )
+		{
+			tcs[i] = quad.lanes[quad.IsLive( i ) ? i : firstLive].*pTc;
+		}
+		Sample( tcs,lod,out );
+	}
+private:
+	// color channels 0..255 to 0..1 (multiply, the compiler keeps a divide by a constant)
+	static constexpr float toUnit = 1.0f / 255.0f;
+	// texel pair along one axis and the 8 bit weight of the second one
+	struct Taps
+	{
+		int i0;
+		int i1;
+		unsigned int weight;
+	};
+	// weight of the next level for lod, 8 bit fixed point (0..256)
+	// the levels are only blended across the middle half of the step from one to the next and
+	// a single level is read everywhere else, which halves the second fetches without a visible seam
+	// (the last level has a fraction of 0, lod is clamped to it)
+	static unsigned int LevelBlend( float lod,size_t level )
+	{
+		return (unsigned int)std::clamp( int( (lod - float( level )) * 512.0f ) - 128,0,256 );
+	}
+	static bool IsPow2( int size )
+	{
+		return (size & (size - 1)) == 0;
+	}
+	// brings a non power of two coordinate into one period (0..1 wrap, 0..2 mirror)
+	// after that the texel index is at most one texel outside the range on either side
+	static float Reduce( float t,bool pow2 )
+	{
+		if constexpr( address == TextureAddress::Wrap )
+		{
+			if( !pow2 )
+			{
+				return t - std::floor( t );
+			}
+		}
+		else if constexpr( address == TextureAddress::Mirror )
+		{
+			if( !pow2 )
+			{
+				return t - 2.0f * std::floor( t * 0.5f );
+			}
+		}
+		return t;
+	}
+	static int Address( int i,int size,bool pow2 )
+	{
+		if constexpr( address == TextureAddress::Wrap )
+		{
+			if( pow2 )
+			{
+				return i & (size - 1);
+			}
+			// reduced, so i is in -1..size
+			return i < 0 ? size - 1 : (i >= size ? 0 : i);
+		}
+		else if constexpr( address == TextureAddress::Mirror )
+		{
+			if( pow2 )
+			{
+				// odd periods count down
+				return (i & size) ? (~i & (size - 1)) : (i & (size - 1));
+			}
+			// reduced, so i is in -1..2 * size
+			const int period = size * 2;
+			const int m = i < 0 ? i + period : (i >= period ? i - period : i);
+			return m >= size ? period - 1 - m : m;
+		}
+		else
+		{
+			return std::clamp( i,0,size - 1 );
+		}
+	}
+	// texel centers at half integers like pixel centers
+	static Taps Resolve( float t,int size )
+	{
+		const bool pow2 = IsPow2( size );
+		const float u = Reduce( t,pow2 ) * float( size ) - 0.5f;
+		const float uFloor = std::floor( u );
+		const int i = int( uFloor );
+		return { Address( i,size,pow2 ),Address( i + 1,size,pow2 ),(unsigned int)((u - uFloor) * 256.0f) };
+	}
+	static int Nearest( float t,int size )
+	{
+		const bool pow2 = IsPow2( size );
+		return Address( int( std::floor( Reduce( t,pow2 ) * float( size ) ) ),size,pow2 );
+	}
+	static Color Fetch( const MipTexture::Level& s,const Vec2& tc )
+	{
+		const int w = int( s.GetWidth() );
+		const int h = int( s.GetHeight() );
+		if constexpr( filter == TextureFilter::Point )
+		{
+			return s.GetTexel( Nearest( tc.x,w ),Nearest( tc.y,h ) );
+		}
+		else
+		{
+			const Taps x = Resolve( tc.x,w );
+			const Taps y = Resolve( tc.y,h );
+			// offsets split by axis, whatever the texel layout
+			const Color* const pTexels = s.GetTexels();
+			const size_t x0 = s.ColumnOffset( x.i0 );
+			const size_t x1 = s.ColumnOffset( x.i1 );
+			const size_t y0 = s.RowOffset( y.i0 );
+			const size_t y1 = s.RowOffset( y.i1 );
+			const Color top = Lerp( pTexels[y0 + x0],pTexels[y0 + x1],x.weight );
+			const Color bottom = Lerp( pTexels[y1 + x0],pTexels[y1 + x1],x.weight );
+			return Lerp( top,bottom,y.weight );
+		}
+	}
+	// the quad versions of the above, one lane per 32 bits
+	struct QuadTaps
+	{
+		__m128i i0;
+		__m128i i1;
+		__m128i weight;
+	};
+	// std::floor per lane (floats of 2^23 and up are whole already)
+	static __m128 Floor( __m128 t )
+	{
+		const __m128 truncated = _mm_cvtepi32_ps( _mm_cvttps_epi32( t ) );
+		// truncating rounded negative numbers up, take one off those
+		const __m128 floored = _mm_sub_ps( truncated,_mm_and_ps( _mm_cmpgt_ps( truncated,t ),_mm_set1_ps( 1.0f ) ) );
+		const __m128 small = _mm_cmplt_ps( _mm_andnot_ps( _mm_set1_ps( -0.0f ),t ),_mm_set1_ps( 8388608.0f ) );
+		return _mm_or_ps( _mm_and_ps( small,floored ),_mm_andnot_ps( small,t ) );
+	}
+	static __m128i Select( __m128i mask,__m128i a,__m128i b )
+	{
+		return _mm_or_si128( _mm_and_si128( mask,a ),_mm_andnot_si128( mask,b ) );
+	}
+	static __m128 Reduce( __m128 t,bool pow2 )
+	{
+		if constexpr( address == TextureAddress::Wrap )
+		{
+			if( !pow2 )
+			{
+				return _mm_sub_ps( t,Floor( t ) );
+			}
+		}
+		else if constexpr( address == TextureAddress::Mirror )
+		{
+			if( !pow2 )
+			{
+				return _mm_sub_ps( t,_mm_mul_ps( _mm_set1_ps( 2.0f ),Floor( _mm_mul_ps( t,_mm_set1_ps( 0.5f ) ) ) ) );
+			}
+		}
+		return t;
+	}
+	static __m128i Address( __m128i i,int size,bool pow2 )
+	{
+		const __m128i sizes = _mm_set1_epi32( size );
+		const __m128i last = _mm_set1_epi32( size - 1 );
+		if constexpr( address == TextureAddress::Wrap )
+		{
+			if( pow2 )
+			{
+				return _mm_and_si128( i,last );
+			}
+			// reduced, so i is in -1..size
+			const __m128i zero = _mm_setzero_si128();
+			return Select( _mm_cmplt_epi32( i,zero ),last,
+				Select( _mm_cmpgt_epi32( sizes,i ),i,zero ) );
+		}
+		else if constexpr( address == TextureAddress::Mirror )
+		{
+			if( pow2 )
+			{
+				// odd periods count down
+				const __m128i even = _mm_cmpeq_epi32( _mm_and_si128( i,sizes ),_mm_setzero_si128() );
+				return _mm_and_si128( Select( even,i,_mm_xor_si128( i,_mm_set1_epi32( -1 ) ) ),last );
+			}
+			// reduced, so i is in -1..2 * size
+			const __m128i period = _mm_set1_epi32( size * 2 );
+			const __m128i m = Select( _mm_cmplt_epi32( i,_mm_setzero_si128() ),_mm_add_epi32( i,period ),
+				Select( _mm_cmpgt_epi32( period,i ),i,_mm_sub_epi32( i,period ) ) );
+			return Select( _mm_cmpgt_epi32( sizes,m ),m,_mm_sub_epi32( _mm_sub_epi32( period,_mm_set1_epi32( 1 ) ),m ) );
+		}
+		else
+		{
+			const __m128i zero = _mm_setzero_si128();
+			return Select( _mm_cmplt_epi32( i,zero ),zero,
+				Select( _mm_cmpgt_epi32( i,last ),last,i ) );
+		}
+	}
+	static QuadTaps Resolve( __m128 t,int size )
+	{
+		const bool pow2 = IsPow2( size );
+		const __m128 u = _mm_sub_ps( _mm_mul_ps( Reduce( t,pow2 ),_mm_set1_ps( float( size ) ) ),_mm_set1_ps( 0.5f ) );
+		const __m128 uFloor = Floor( u );
+		const __m128i i = _mm_cvttps_epi32( uFloor );
+		return { Address( i,size,pow2 ),Address( _mm_add_epi32( i,_mm_set1_epi32( 1 ) ),size,pow2 ),
+			_mm_cvttps_epi32( _mm_mul_ps( _mm_sub_ps( u,uFloor ),_mm_set1_ps( 256.0f ) ) ) };
+	}
+	static __m128i FetchQuad( const MipTexture::Level& s,__m128 u,__m128 v )
+	{
+		const QuadTaps x = Resolve( u,int( s.GetWidth() ) );
+		const QuadTaps y = Resolve( v,int( s.GetHeight() ) );
+		alignas( 16 ) unsigned int rows0[4];
+		alignas( 16 ) unsigned int rows1[4];
+		alignas( 16 ) unsigned int columns0[4];
+		alignas( 16 ) unsigned int columns1[4];
+		_mm_store_si128( reinterpret_cast<__m128i*>( rows0 ),s.RowOffsets( y.i0 ) );
+		_mm_store_si128( reinterpret_cast<__m128i*>( rows1 ),s.RowOffsets( y.i1 ) );
+		_mm_store_si128( reinterpret_cast<__m128i*>( columns0 ),s.ColumnOffsets( x.i0 ) );
+		_mm_store_si128( reinterpret_cast<__m128i*>( columns1 ),s.ColumnOffsets( x.i1 ) );
+		// the footprints' corners, one lane each
+		const Color* const pTexels = s.GetTexels();
+		alignas( 16 ) unsigned int corners[4][4];
+		for( int i = 0; i < 4; i++ )
+		{
+			corners[0][i] = pTexels[rows0[i] + columns0[i]].dword;
+			corners[1][i] = pTexels[rows0[i] + columns1[i]].dword;
+			corners[2][i] = pTexels[rows1[i] + columns0[i]].dword;
+			corners[3][i] = pTexels[rows1[i] + columns1[i]].dword;
+		}
+		const auto Corner = [&corners]( int c )
+		{
+			return _mm_load_si128( reinterpret_cast<const __m128i*>( corners[c] ) );
+		};
+		const __m128i top = LerpQuad( Corner( 0 ),Corner( 1 ),x.weight );
+		const __m128i bottom = LerpQuad( Corner( 2 ),Corner( 3 ),x.weight );
+		return LerpQuad( top,bottom,y.weight );
+	}
+	// Lerp for four colors, t per lane
+	// (channels widened to 16 bits, a * (256 - t) + b * t is at most 255 * 256 so it fits)
+	static __m128i LerpQuad( __m128i a,__m128i b,__m128i t )
+	{
+		const __m128i zero = _mm_setzero_si128();
+		// t into every 16 bit channel of its lane
+		const __m128i t16 = _mm_or_si128( t,_mm_slli_epi32( t,16 ) );
+		const __m128i tLo = _mm_unpacklo_epi32( t16,t16 );
+		const __m128i tHi = _mm_unpackhi_epi32( t16,t16 );
+		const __m128i full = _mm_set1_epi16( 256 );
+		const __m128i lo = _mm_srli_epi16( _mm_add_epi16(
+			_mm_mullo_epi16( _mm_unpacklo_epi8( a,zero ),_mm_sub_epi16( full,tLo ) ),
+			_mm_mullo_epi16( _mm_unpacklo_epi8( b,zero ),tLo ) ),8 );
+		const __m128i hi = _mm_srli_epi16( _mm_add_epi16(
+			_mm_mullo_epi16( _mm_unpackhi_epi8( a,zero ),_mm_sub_epi16( full,tHi ) ),
+			_mm_mullo_epi16( _mm_unpackhi_epi8( b,zero ),tHi ) ),8 );
+		return _mm_packus_epi16( lo,hi );
+	}
+	// per channel a + (b - a) * t / 256 for all four channels at once
+	// (two channels per 32 bit multiply, each 8 bit channel gets 16 bits of headroom)
+	static Color Lerp( Color a,Color b,unsigned int t )
+	{
+		const unsigned int rb = (((a.dword & 0x00FF00FFu) * (256u - t) + (b.dword & 0x00FF00FFu) * t) >> 8u) & 0x00FF00FFu;
+		const unsigned int xg = (((a.dword >> 8u) & 0x00FF00FFu) * (256u - t) + ((b.dword >> 8u) & 0x00FF00FFu) * t) & 0xFF00FF00u;
+		return Color( rb | xg );
+	}
+private:
+	const MipTexture* pTex = nullptr;
+};
\ No newline at end of file
@@ -2,6 +2,7 @@
 #include "Keyboard.h"
 #include "Mouse.h"
 #include "Graphics.h"
+#include "PipelineStats.h"
 #include <string>
 
 class Scene
@@ -13,6 +14,11 @@ public:
 	{}
 	virtual void Update( Keyboard& kbd,Mouse& mouse,float dt ) = 0;
 	virtual void Draw() = 0;
+	// totals over all of the scene's pipelines (for benchmarking)
+	virtual PipelineStats GetPipelineStats() const
+	{
+		return {};
+	}
 	virtual ~Scene() = default;
 	const std::string& GetName() const
 	{
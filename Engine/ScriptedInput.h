@@ -0,0 +1,52 @@
+#pragma once
+
+#include "Keyboard.h"
+#include "Mouse.h"
+
+// feeds keyboard / mouse events to a scene without a window
+// (what MainWindow does from the message loop, but driven from code)
+class ScriptedInput
+{
+public:
+	ScriptedInput( Keyboard& kbd,Mouse& mouse )
+		:
+		kbd( kbd ),
+		mouse( mouse )
+	{}
+	void PressKey( unsigned char keycode )
+	{
+		if( !kbd.KeyIsPressed( keycode ) )
+		{
+			kbd.OnKeyPressed( keycode );
+		}
+	}
+	void ReleaseKey( unsigned char keycode )
+	{
+		if( kbd.KeyIsPressed( keycode ) )
+		{
+			kbd.OnKeyReleased( keycode );
+		}
+	}
+	void ReleaseAllKeys()
+	{
+		for( unsigned int k = 0; k < Keyboard::nKeys; k++ )
+		{
+			ReleaseKey( (unsigned char)k );
+		}
+	}
+	void MoveMouse( int x,int y )
+	{
+		mouse.OnMouseMove( x,y );
+	}
+	void PressLeft( int x,int y )
+	{
+		mouse.OnLeftPressed( x,y );
+	}
+	void ReleaseLeft( int x,int y )
+	{
+		mouse.OnLeftReleased( x,y );
+	}
+private:
+	Keyboard& kbd;
+	Mouse& mouse;
+};
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Pipeline.h"
+#include "Interpolant.h"
 #include "BaseVertexShader.h"
 #include "DefaultGeometryShader.h"
 
@@ -9,7 +10,7 @@ class SolidEffect
 {
 public:
 	// the vertex type that will be input into the pipeline
-	class Vertex
+	class Vertex : public Interpolant<Vertex>
 	{
 	public:
 		Vertex() = default;
@@ -27,41 +28,9 @@ public:
 			color( color ),
 			pos( pos )
 		{}
-		Vertex& operator+=( const Vertex& rhs )
+		static constexpr auto Attributes()
 		{
-			pos += rhs.pos;
-			return *this;
-		}
-		Vertex operator+( const Vertex& rhs ) const
-		{
-			return Vertex( *this ) += rhs;
-		}
-		Vertex& operator-=( const Vertex& rhs )
-		{
-			pos -= rhs.pos;
-			return *this;
-		}
-		Vertex operator-( const Vertex& rhs ) const
-		{
-			return Vertex( *this ) -= rhs;
-		}
-		Vertex& operator*=( float rhs )
-		{
-			pos *= rhs;
-			return *this;
-		}
-		Vertex operator*( float rhs ) const
-		{
-			return Vertex( *this ) *= rhs;
-		}
-		Vertex& operator/=( float rhs )
-		{
-			pos /= rhs;
-			return *this;
-		}
-		Vertex operator/( float rhs ) const
-		{
-			return Vertex( *this ) /= rhs;
+			return std::make_tuple();
 		}
 	public:
 		Vec3 pos;
@@ -69,7 +38,7 @@ public:
 	};
 	// vertex type solid effect
 	// only pos is interpolated
-	class VSOutput
+	class VSOutput : public Interpolant<VSOutput>
 	{
 	public:
 		VSOutput() = default;
@@ -87,41 +56,9 @@ public:
 			color( color ),
 			pos( pos )
 		{}
-		VSOutput& operator+=( const VSOutput& rhs )
-		{
-			pos += rhs.pos;
-			return *this;
-		}
-		VSOutput operator+( const VSOutput& rhs ) const
-		{
-			return VSOutput( *this ) += rhs;
-		}
-		VSOutput& operator-=( const VSOutput& rhs )
-		{
-			pos -= rhs.pos;
-			return *this;
-		}
-		VSOutput operator-( const VSOutput& rhs ) const
-		{
-			return VSOutput( *this ) -= rhs;
-		}
-		VSOutput& operator*=( float rhs )
+		static constexpr auto Attributes()
 		{
-			pos *= rhs;
-			return *this;
-		}
-		VSOutput operator*( float rhs ) const
-		{
-			return VSOutput( *this ) *= rhs;
-		}
-		VSOutput& operator/=( float rhs )
-		{
-			pos /= rhs;
-			return *this;
-		}
-		VSOutput operator/( float rhs ) const
-		{
-			return VSOutput( *this ) /= rhs;
+			return std::make_tuple();
 		}
 	public:
 		Vec4 pos;
@@ -132,7 +69,12 @@ public:
 	public:
 		Output operator()( const Vertex& v ) const
 		{
-			return{ Vec4( v.pos ) * worldViewProj,v.color };
+			return{ Position( v ),v.color };
+		}
+		// the clip space position alone, for culling before shading
+		Vec4 Position( const Vertex& v ) const
+		{
+			return Vec4( v.pos ) * worldViewProj;
 		}
 	};
 	// default gs passes vertices through and outputs triangle
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Pipeline.h"
+#include "Interpolant.h"
 #include "DefaultVertexShader.h"
 
 // solid color attribute taken from table in gs and not interpolated
@@ -8,7 +9,7 @@ class SolidGeometryEffect
 {
 public:
 	// the vertex type that will be input into the pipeline
-	class Vertex
+	class Vertex : public Interpolant<Vertex>
 	{
 	public:
 		Vertex() = default;
@@ -20,41 +21,9 @@ public:
 			:
 			pos( pos )
 		{}
-		Vertex& operator+=( const Vertex& rhs )
+		static constexpr auto Attributes()
 		{
-			pos += rhs.pos;
-			return *this;
-		}
-		Vertex operator+( const Vertex& rhs ) const
-		{
-			return Vertex( *this ) += rhs;
-		}
-		Vertex& operator-=( const Vertex& rhs )
-		{
-			pos -= rhs.pos;
-			return *this;
-		}
-		Vertex operator-( const Vertex& rhs ) const
-		{
-			return Vertex( *this ) -= rhs;
-		}
-		Vertex& operator*=( float rhs )
-		{
-			pos *= rhs;
-			return *this;
-		}
-		Vertex operator*( float rhs ) const
-		{
-			return Vertex( *this ) *= rhs;
-		}
-		Vertex& operator/=( float rhs )
-		{
-			pos /= rhs;
-			return *this;
-		}
-		Vertex operator/( float rhs ) const
-		{
-			return Vertex( *this ) /= rhs;
+			return std::make_tuple();
 		}
 	public:
 		Vec3 pos;
@@ -67,7 +36,7 @@ public:
 	class GeometryShader
 	{
 	public:
-		class Output
+		class Output : public Interpolant<Output>
 		{
 		public:
 			Output() = default;
@@ -85,41 +54,9 @@ public:
 				color( color ),
 				pos( pos )
 			{}
-			Output& operator+=( const Output& rhs )
-			{
-				pos += rhs.pos;
-				return *this;
-			}
-			Output operator+( const Output& rhs ) const
-			{
-				return Output( *this ) += rhs;
-			}
-			Output& operator-=( const Output& rhs )
-			{
-				pos -= rhs.pos;
-				return *this;
-			}
-			Output operator-( const Output& rhs ) const
-			{
-				return Output( *this ) -= rhs;
-			}
-			Output& operator*=( float rhs )
-			{
-				pos *= rhs;
-				return *this;
-			}
-			Output operator*( float rhs ) const
-			{
-				return Output( *this ) *= rhs;
-			}
-			Output& operator/=( float rhs )
-			{
-				pos /= rhs;
-				return *this;
-			}
-			Output operator/( float rhs ) const
+			static constexpr auto Attributes()
 			{
-				return Output( *this ) /= rhs;
+				return std::make_tuple();
 			}
 		public:
 			Vec3 pos;
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Pipeline.h"
+#include "Interpolant.h"
 #include "BaseVertexShader.h"
 #include "DefaultGeometryShader.h"
 #include "BasePhongShader.h"
@@ -35,7 +36,7 @@ public:
 	};
 	// vertex shader
 	// output interpolates position, normal, world position
-	class VSOutput
+	class VSOutput : public Interpolant<VSOutput>
 	{
 	public:
 		VSOutput() = default;
@@ -55,49 +56,9 @@ public:
 			pos( pos ),
 			worldPos( worldPos )
 		{}
-		VSOutput& operator+=( const VSOutput& rhs )
+		static constexpr auto Attributes()
 		{
-			pos += rhs.pos;
-			n += rhs.n;
-			worldPos += rhs.worldPos;
-			return *this;
-		}
-		VSOutput operator+( const VSOutput& rhs ) const
-		{
-			return VSOutput( *this ) += rhs;
-		}
-		VSOutput& operator-=( const VSOutput& rhs )
-		{
-			pos -= rhs.pos;
-			n -= rhs.n;
-			worldPos -= rhs.worldPos;
-			return *this;
-		}
-		VSOutput operator-( const VSOutput& rhs ) const
-		{
-			return VSOutput( *this ) -= rhs;
-		}
-		VSOutput& operator*=( float rhs )
-		{
-			pos *= rhs;
-			n *= rhs;
-			worldPos *= rhs;
-			return *this;
-		}
-		VSOutput operator*( float rhs ) const
-		{
-			return VSOutput( *this ) *= rhs;
-		}
-		VSOutput& operator/=( float rhs )
-		{
-			pos /= rhs;
-			n /= rhs;
-			worldPos /= rhs;
-			return *this;
-		}
-		VSOutput operator/( float rhs ) const
-		{
-			return VSOutput( *this ) /= rhs;
+			return std::make_tuple( &VSOutput::n,&VSOutput::worldPos );
 		}
 	public:
 		Vec4 pos;
@@ -112,6 +73,11 @@ public:
 			const auto p4 = Vec4( v.pos );
 			return { p4 * this->worldViewProj,Vec4{ v.n,0.0f } *this->worldView,p4 * this->worldView };
 		}
+		// the clip space position alone, for culling before shading
+		Vec4 Position( const Vertex& v ) const
+		{
+			return Vec4( v.pos ) * this->worldViewProj;
+		}
 	};
 	// default gs passes vertices through and outputs triangle
 	typedef DefaultGeometryShader<typename VertexShader::Output> GeometryShader;
@@ -127,6 +93,20 @@ public:
 		{
 			return this->Shade( in,material_color );
 		}
+		// packet version, shades FloatPacket::size pixels at once
+		template<class Input>
+		void operator()( const Input* in,Color* out ) const
+		{
+			this->ShadePacket( Vec3Packet::Gather( in,&Input::n ),Vec3Packet::Gather( in,&Input::worldPos ),material_color,out );
+		}
+		// g-buffer version for deferred shading, the lighting pass (BasePhongShader::Light) does the rest
+		template<class Input>
+		void operator()( const Input& in,GBufferTexel& out ) const
+		{
+			out.n = in.n;
+			out.worldPos = in.worldPos;
+			out.material = material_color;
+		}
 	private:
 		Vec3 material_color = { 0.8f,0.85f,1.0f };
 	};
@@ -28,15 +28,18 @@ struct SpecularParams
 
 class SpecularPhongPointScene : public Scene
 {
-	using SpecularPhongPointEffect = SpecularPhongPointEffect<PointDiffuseParams,SpecularParams>;
-	using VertexLightTexturedEffect = VertexLightTexturedEffect<PointDiffuseParams>;
-	using RippleVertexSpecularPhongEffect = RippleVertexSpecularPhongEffect<PointDiffuseParams,SpecularParams>;
+	using SpecularPhongPointEffect = ::SpecularPhongPointEffect<PointDiffuseParams,SpecularParams>;
+	// the room's textures are stretched over it (nearly every pixel is within a texel of the full
+	// size level), so they're point sampled per pixel rather than shaded in quads for mip levels
+	using VertexLightTexturedEffect = ::VertexLightTexturedEffect<PointDiffuseParams,TextureFilter::Point>;
+	using RippleVertexSpecularPhongEffect = ::RippleVertexSpecularPhongEffect<PointDiffuseParams,SpecularParams,TextureFilter::Point>;
 public:
+	// walls sharing a texture and mesh, drawn as instances of it
 	struct Wall
 	{
-		const Surface* pTex;
+		const MipTexture* pTex;
 		IndexedTriangleList<VertexLightTexturedEffect::Vertex> model;
-		Mat4 world;
+		std::vector<Mat4> worlds;
 	};
 public:
 	typedef ::Pipeline<SpecularPhongPointEffect> Pipeline;
@@ -45,15 +48,23 @@ public:
 	typedef ::Pipeline<RippleVertexSpecularPhongEffect> RipplePipeline;
 	typedef Pipeline::Vertex Vertex;
 public:
-	SpecularPhongPointScene( Graphics& gfx )
+	// the pipelines rasterize in tiles on the threads of pPool (shared with the other scenes)
+	SpecularPhongPointScene( Graphics& gfx,std::shared_ptr<ThreadPool> pPool_in )
 		:
+		Scene( "phong point shader scene free mesh" ),
 		pZb( std::make_shared<ZBuffer>( gfx.ScreenWidth,gfx.ScreenHeight ) ),
-		pipeline( gfx,pZb ),
-		liPipeline( gfx,pZb ),
-		wPipeline( gfx,pZb ),
-		rPipeline( gfx,pZb ),
-		Scene( "phong point shader scene free mesh" )
+		pPool( std::move( pPool_in ) ),
+		pArena( std::make_shared<FrameArena>() ),
+		pipeline( gfx,pZb,pArena ),
+		liPipeline( gfx,pZb,pArena ),
+		wPipeline( gfx,pZb,pArena ),
+		rPipeline( gfx,pZb,pArena )
 	{
+		pipeline.SetThreadPool( pPool );
+		liPipeline.SetThreadPool( pPool );
+		wPipeline.SetThreadPool( pPool );
+		rPipeline.SetThreadPool( pPool );
+		SetDepthPrepass( false );
 		// adjust suzanne model
 		itlist.AdjustToTrueCenter();
 		// set light sphere colors
@@ -65,26 +76,55 @@ public:
 		walls.push_back( {
 			&tCeiling,
 			Plane::GetSkinnedNormals<VertexLightTexturedEffect::Vertex>( 20,20,width,width,tScaleCeiling ),
-			Mat4::RotationX( -PI / 2.0f ) * Mat4::Translation( 0.0f,height / 2.0f,0.0f )
+			{ Mat4::RotationX( -PI / 2.0f ) * Mat4::Translation( 0.0f,height / 2.0f,0.0f ) }
+		} );
+		walls.push_back( {
+			&tWall,
+			Plane::GetSkinnedNormals<VertexLightTexturedEffect::Vertex>( 20,20,width,height,tScaleWall ),
+			{}
 		} );
 		for( int i = 0; i < 4; i++ )
 		{
-			walls.push_back( {
-				&tWall,
-				Plane::GetSkinnedNormals<VertexLightTexturedEffect::Vertex>( 20,20,width,height,tScaleWall ),
-				Mat4::Translation( 0.0f,0.0f,width / 2.0f ) * Mat4::RotationY( float( i ) * PI / 2.0f )
-			} );
+			walls.back().worlds.push_back( Mat4::Translation( 0.0f,0.0f,width / 2.0f ) * Mat4::RotationY( float( i ) * PI / 2.0f ) );
 		}
 		walls.push_back( {
 			&tFloor,
 			Plane::GetSkinnedNormals<VertexLightTexturedEffect::Vertex>( 20,20,width,width,tScaleFloor ),
-			Mat4::RotationX( PI / 2.0 ) * Mat4::Translation( 0.0f,-height / 2.0f,0.0f )
+			{ Mat4::RotationX( PI / 2.0 ) * Mat4::Translation( 0.0f,-height / 2.0f,0.0f ) }
 		} );
+		// bounds let draws of walls that are out of view be skipped
+		// (not for the ripple plane, its vertex shader moves the vertices)
+		for( auto& w : walls )
+		{
+			w.model.ComputeBounds();
+		}
+		lightIndicator.ComputeBounds();
+	}
+	// with the depth prepass everything gets its depth drawn first (see Draw) and is then shaded
+	// only where it's visible; that only pays off with more overdraw than this scene has
+	// (P toggles it)
+	void SetDepthPrepass( bool depthPrepass_in )
+	{
+		depthPrepass = depthPrepass_in;
+		pipeline.SetDepthTest( depthPrepass ? Pipeline::DepthTest::Equal : Pipeline::DepthTest::Less );
+		liPipeline.SetDepthTest( depthPrepass ? LightIndicatorPipeline::DepthTest::Equal : LightIndicatorPipeline::DepthTest::Less );
+		wPipeline.SetDepthTest( depthPrepass ? WallPipeline::DepthTest::Equal : WallPipeline::DepthTest::Less );
+		rPipeline.SetDepthTest( depthPrepass ? RipplePipeline::DepthTest::Equal : RipplePipeline::DepthTest::Less );
+		// phong lighting only for the pixels left visible (with the depth prepass it already runs
+		// once per pixel, deferring it would gain nothing); the light is set once per frame in Draw
+		pipeline.SetDeferredShading( !depthPrepass );
+		rPipeline.SetDeferredShading( !depthPrepass );
 	}
 	virtual void Update( Keyboard& kbd,Mouse& mouse,float dt ) override
 	{
 		t += dt;
 
+		if( kbd.KeyIsPressed( 'P' ) && !prepassKeyDown )
+		{
+			SetDepthPrepass( !depthPrepass );
+		}
+		prepassKeyDown = kbd.KeyIsPressed( 'P' );
+
 		if( kbd.KeyIsPressed( 'W' ) )
 		{
 			cam_pos += Vec4{ 0.0f,0.0f,1.0f,0.0f } * !cam_rot_inv * cam_speed * dt;
@@ -153,7 +193,35 @@ public:
 		const auto proj = Mat4::ProjectionHFOV( hfov,aspect_ratio,0.2f,6.0f );
 		const auto view = Mat4::Translation( -cam_pos ) * cam_rot_inv;
 
-		// render suzanne
+		// shading state
+		pipeline.effect.ps.SetLightPosition( l_pos * view );
+		pipeline.effect.ps.SetAmbientLight( l_ambient );
+		pipeline.effect.ps.SetDiffuseLight( l );
+		wPipeline.effect.vs.SetLightPosition( l_pos * view );
+		wPipeline.effect.vs.SetAmbientLight( l_ambient );
+		wPipeline.effect.vs.SetDiffuseLight( l );
+		rPipeline.effect.ps.BindTexture( tSauron );
+		rPipeline.effect.ps.SetLightPosition( l_pos * view );
+		rPipeline.effect.ps.SetAmbientLight( l_ambient );
+		rPipeline.effect.ps.SetDiffuseLight( l );
+
+		// with the depth prepass the expensive pixel shaders only run for the visible pixels
+		if( depthPrepass )
+		{
+			DrawMeshes( view,proj,true );
+		}
+		DrawMeshes( view,proj,false );
+	}
+	virtual PipelineStats GetPipelineStats() const override
+	{
+		return pipeline.GetStats() + liPipeline.GetStats() + wPipeline.GetStats() + rPipeline.GetStats();
+	}
+private:
+	// draws all of the scene, or only its depths
+	// (pipelines share the zbuffer, so there's no need to call BeginFrame on all of them)
+	void DrawMeshes( const Mat4& view,const Mat4& proj,bool depthOnly )
+	{
+		// suzanne
 		pipeline.effect.vs.BindWorldView(
 			Mat4::RotationX( theta_x ) *
 			Mat4::RotationY( theta_y ) *
@@ -163,38 +231,49 @@ public:
 			view
 		);
 		pipeline.effect.vs.BindProjection( proj );
-		pipeline.effect.ps.SetLightPosition( l_pos * view );
-		pipeline.effect.ps.SetAmbientLight( l_ambient );
-		pipeline.effect.ps.SetDiffuseLight( l );
-		pipeline.Draw( itlist );
+		DrawMesh( pipeline,itlist,depthOnly );
 
-		// draw light indicator with different pipeline
-		// don't call beginframe on this pipeline b/c wanna keep zbuffer contents
-		// (don't like this assymetry but we'll live with it for now)
+		// light indicator
 		liPipeline.effect.vs.BindWorldView( Mat4::Translation( l_pos ) * view );
 		liPipeline.effect.vs.BindProjection( proj );
-		liPipeline.Draw( lightIndicator );
+		DrawMesh( liPipeline,lightIndicator,depthOnly );
 
-		// draw walls (ceiling floor)
-		wPipeline.effect.vs.SetLightPosition( l_pos * view );
+		// walls (ceiling floor)
 		wPipeline.effect.vs.BindProjection( proj );
-		wPipeline.effect.vs.SetAmbientLight( l_ambient );
-		wPipeline.effect.vs.SetDiffuseLight( l );
 		for( const auto& w : walls )
 		{
-			wPipeline.effect.vs.BindWorldView( w.world * view );
+			wallWorldViews.clear();
+			for( const auto& world : w.worlds )
+			{
+				wallWorldViews.push_back( world * view );
+			}
 			wPipeline.effect.ps.BindTexture( *w.pTex );
-			wPipeline.Draw( w.model );
+			if( depthOnly )
+			{
+				wPipeline.DrawDepthInstanced( w.model,wallWorldViews );
+			}
+			else
+			{
+				wPipeline.DrawInstanced( w.model,wallWorldViews );
+			}
 		}
 
-		// draw ripple plane
-		rPipeline.effect.ps.BindTexture( tSauron );
-		rPipeline.effect.ps.SetLightPosition( l_pos * view );
+		// ripple plane
 		rPipeline.effect.vs.BindWorldView( sauronWorld * view );
 		rPipeline.effect.vs.BindProjection( proj );
-		rPipeline.effect.ps.SetAmbientLight( l_ambient );
-		rPipeline.effect.ps.SetDiffuseLight( l );
-		rPipeline.Draw( sauron );
+		DrawMesh( rPipeline,sauron,depthOnly );
+	}
+	template<class P,class Model>
+	static void DrawMesh( P& pipe,const Model& model,bool depthOnly )
+	{
+		if( depthOnly )
+		{
+			pipe.DrawDepth( model );
+		}
+		else
+		{
+			pipe.Draw( model );
+		}
 	}
 private:
 	float t = 0.0f;
@@ -203,10 +282,14 @@ private:
 	static constexpr float height = 1.75f;
 	// pipelines
 	std::shared_ptr<ZBuffer> pZb;
+	std::shared_ptr<ThreadPool> pPool;
+	std::shared_ptr<FrameArena> pArena;
 	Pipeline pipeline;
 	LightIndicatorPipeline liPipeline;
 	WallPipeline wPipeline;
 	RipplePipeline rPipeline;
+	bool depthPrepass = false;
+	bool prepassKeyDown = false;
 	// fov
 	static constexpr float aspect_ratio = 1.33333f;
 	static constexpr float hfov = 85.0f;
@@ -238,13 +321,16 @@ private:
 	static constexpr float tScaleCeiling = 0.5f;
 	static constexpr float tScaleWall = 0.65f;
 	static constexpr float tScaleFloor = 0.65f;
-	Surface tCeiling = Surface::FromFile( L"Images\\ceiling.png" );
-	Surface tWall = Surface::FromFile( L"Images\\stonewall.png" );
-	Surface tFloor = Surface::FromFile( L"Images\\floor.png" );
+	// tiled, the floor and ceiling are mostly seen at a slant
+	MipTexture tCeiling = MipTexture::FromFile( L"Images\\ceiling.png",TexelLayout::Tiled );
+	MipTexture tWall = MipTexture::FromFile( L"Images\\stonewall.png",TexelLayout::Tiled );
+	MipTexture tFloor = MipTexture::FromFile( L"Images\\floor.png",TexelLayout::Tiled );
 	std::vector<Wall> walls;
+	// per frame world-view transforms of the wall being drawn (kept to reuse its storage)
+	std::vector<Mat4> wallWorldViews;
 	// ripple stuff
 	static constexpr float sauronSize = 0.6f;
 	Mat4 sauronWorld = Mat4::RotationX( PI / 2.0f ) * Mat4::Translation( 0.3f,-0.8,0.0f );
-	Surface tSauron = Surface::FromFile( L"Images\\sauron-bhole-100x100.png" );
+	MipTexture tSauron = MipTexture::FromFile( L"Images\\sauron-bhole-100x100.png",TexelLayout::Tiled );
 	IndexedTriangleList<RippleVertexSpecularPhongEffect::Vertex> sauron = Plane::GetSkinned<RippleVertexSpecularPhongEffect::Vertex>( 50,10,sauronSize,sauronSize,0.6f );
 };
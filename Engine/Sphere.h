@@ -35,7 +35,7 @@ public:
 		
 		const auto calcIdx = [latDiv,longDiv]( int iLat,int iLong )
 			{ return iLat * longDiv + iLong; };
-		std::vector<size_t> indices;
+		IndexBuffer indices;
 		for( int iLat = 0; iLat < latDiv - 2; iLat++ )
 		{
 			for( int iLong = 0; iLong < longDiv - 1; iLong++ )
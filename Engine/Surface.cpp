@@ -18,10 +18,13 @@
 *	You should have received a copy of the GNU General Public License					  *
 *	along with The Chili DirectX Framework.  If not, see <http://www.gnu.org/licenses/>.  *
 ******************************************************************************************/
+#ifndef CHILI_HEADLESS
 #define FULL_WINTARD
 #include "ChiliWin.h"
+#endif
 #include "Surface.h"
 #include "ChiliException.h"
+#ifndef CHILI_HEADLESS
 namespace Gdiplus
 {
 	using std::min;
@@ -31,6 +34,7 @@ namespace Gdiplus
 #include <sstream>
 
 #pragma comment( lib,"gdiplus.lib" )
+#endif
 
 void Surface::PutPixelAlpha( unsigned int x,unsigned int y,Color c )
 {
@@ -50,6 +54,8 @@ void Surface::PutPixelAlpha( unsigned int x,unsigned int y,Color c )
 	PutPixel( x,y,{ rsltRed,rsltGreen,rsltBlue } );
 }
 
+// headless builds load and save images without gdi+ (see SurfaceHeadless.cpp)
+#ifndef CHILI_HEADLESS
 Surface Surface::FromFile( const std::wstring & name )
 {
 	unsigned int width = 0;
@@ -138,6 +144,7 @@ void Surface::Save( const std::wstring & filename ) const
 		throw Exception( _CRT_WIDE( __FILE__ ),__LINE__,ss.str() );
 	}
 }
+#endif
 
 void Surface::Copy( const Surface & src )
 {
@@ -19,13 +19,13 @@
 *	along with The Chili DirectX Framework.  If not, see <http://www.gnu.org/licenses/>.  *
 ******************************************************************************************/
 #pragma once
-#include "ChiliWin.h"
 #include "Colors.h"
 #include "Rect.h"
 #include "ChiliException.h"
 #include <string>
 #include <assert.h>
 #include <memory>
+#include <cstring>
 
 
 class Surface
@@ -74,7 +74,7 @@ public:
 	{
 		memset( pBuffer.get(),fillValue.dword,pitch * height * sizeof( Color ) );
 	}
-	void Present( unsigned int dstPitch,BYTE* const pDst ) const
+	void Present( unsigned int dstPitch,unsigned char* const pDst ) const
 	{
 		for( unsigned int y = 0; y < height; y++ )
 		{
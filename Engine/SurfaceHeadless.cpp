@@ -0,0 +1,541 @@
+/******************************************************************************************
+*	Chili DirectX Framework Version 16.10.01											  *
+*	SurfaceHeadless.cpp																	  *
+*	Copyright 2016 PlanetChili <http://www.planetchili.net>								  *
+*																						  *
+*	This file is part of The Chili DirectX Framework.									  *
+*																						  *
+*	The Chili DirectX Framework is free software: you can redistribute it and/or modify	  *
+*	it under the terms of the GNU General Public License as published by				  *
+*	the Free Software Foundation, either version 3 of the License, or					  *
+*	(at your option) any later version.													  *
+*																						  *
+*	The Chili DirectX Framework is distributed in the hope that it will be useful,		  *
+*	but WITHOUT ANY WARRANTY; without even the implied warranty of						  *
+*	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the						  *
+*	GNU General Public License for more details.										  *
+*																						  *
+*	You should have received a copy of the GNU General Public License					  *
+*	along with The Chili DirectX Framework.  If not, see <http://www.gnu.org/licenses/>.  *
+******************************************************************************************/
+// image loading / saving for headless builds (no gdi+)
+// FromFile reads non-interlaced 8-bit png (gray, rgb, palette, gray+alpha, rgba)
+// Save writes a 32-bit bmp, same as the gdi+ version
+#ifdef CHILI_HEADLESS
+#include "Surface.h"
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <cstdint>
+#include <cstdlib>
+#include <algorithm>
+#include <iterator>
+
+#define CHILI_WIDE2( s ) L##s
+#define CHILI_WIDE( s ) CHILI_WIDE2( s )
+
+namespace
+{
+	class PngError
+	{
+	public:
+		PngError( const wchar_t* msg )
+			:
+			msg( msg )
+		{}
+		const wchar_t* msg;
+	};
+
+	// paths in the code use windows separators ("Images\\floor.png")
+	std::string NarrowPath( const std::wstring& name )
+	{
+		std::string path;
+		for( wchar_t c : name )
+		{
+			path.push_back( c == L'\\' ? '/' : char( c ) );
+		}
+		return path;
+	}
+
+	uint32_t ReadBE32( const unsigned char* p )
+	{
+		return (uint32_t( p[0] ) << 24) | (uint32_t( p[1] ) << 16) | (uint32_t( p[2] ) << 8) | uint32_t( p[3] );
+	}
+
+	// zlib stream decoder (rfc 1950 / 1951)
+	class Inflater
+	{
+	private:
+		// canonical huffman code: number of codes of each length and symbols in code order
+		struct Huffman
+		{
+			unsigned short counts[16];
+			unsigned short symbols[288];
+		};
+	public:
+		Inflater( const std::vector<unsigned char>& src,std::vector<unsigned char>& out )
+			:
+			src( src ),
+			out( out )
+		{}
+		void Run()
+		{
+			if( src.size() < 2 || (src[0] & 0x0Fu) != 8u || ((src[0] << 8) | src[1]) % 31 != 0 || (src[1] & 0x20u) )
+			{
+				throw PngError( L"bad zlib header" );
+			}
+			pos = 2;
+			bool last;
+			do
+			{
+				last = Bits( 1 ) != 0;
+				switch( Bits( 2 ) )
+				{
+				case 0:
+					Stored();
+					break;
+				case 1:
+					Fixed();
+					break;
+				case 2:
+					Dynamic();
+					break;
+				default:
+					throw PngError( L"bad deflate block type" );
+				}
+			} while( !last );
+		}
+	private:
+		unsigned int Bits( int n )
+		{
+			while( bitCount < n )
+			{
+				if( pos >= src.size() )
+				{
+					throw PngError( L"truncated deflate stream" );
+				}
+				bitBuf |= unsigned( src[pos++] ) << bitCount;
+				bitCount += 8;
+			}
+			const unsigned int v = bitBuf & ((1u << n) - 1u);
+			bitBuf >>= n;
+			bitCount -= n;
+			return v;
+		}
+		static void Build( Huffman& h,const unsigned char* lengths,int n )
+		{
+			unsigned short offsets[16];
+			std::fill( std::begin( h.counts ),std::end( h.counts ),(unsigned short)0 );
+			for( int i = 0; i < n; i++ )
+			{
+				h.counts[lengths[i]]++;
+			}
+			h.counts[0] = 0;
+			offsets[1] = 0;
+			for( int len = 1; len < 15; len++ )
+			{
+				offsets[len + 1] = offsets[len] + h.counts[len];
+			}
+			for( int i = 0; i < n; i++ )
+			{
+				if( lengths[i] != 0 )
+				{
+					h.symbols[offsets[lengths[i]]++] = (unsigned short)i;
+				}
+			}
+		}
+		int Decode( const Huffman& h )
+		{
+			int code = 0;
+			int first = 0;
+			int index = 0;
+			for( int len = 1; len < 16; len++ )
+			{
+				code |= int( Bits( 1 ) );
+				const int count = h.counts[len];
+				if( code - first < count )
+				{
+					return h.symbols[index + code - first];
+				}
+				index += count;
+				first = (first + count) << 1;
+				code <<= 1;
+			}
+			throw PngError( L"bad huffman code" );
+		}
+		void Stored()
+		{
+			bitBuf = 0;
+			bitCount = 0;
+			if( pos + 4 > src.size() )
+			{
+				throw PngError( L"truncated stored block" );
+			}
+			const size_t len = src[pos] | (src[pos + 1] << 8);
+			pos += 4;
+			if( pos + len > src.size() )
+			{
+				throw PngError( L"truncated stored block" );
+			}
+			out.insert( out.end(),src.begin() + pos,src.begin() + pos + len );
+			pos += len;
+		}
+		void Fixed()
+		{
+			unsigned char lengths[288 + 30];
+			std::fill( lengths,lengths + 144,(unsigned char)8 );
+			std::fill( lengths + 144,lengths + 256,(unsigned char)9 );
+			std::fill( lengths + 256,lengths + 280,(unsigned char)7 );
+			std::fill( lengths + 280,lengths + 288,(unsigned char)8 );
+			std::fill( lengths + 288,lengths + 318,(unsigned char)5 );
+			Huffman lit;
+			Huffman dist;
+			Build( lit,lengths,288 );
+			Build( dist,lengths + 288,30 );
+			Codes( lit,dist );
+		}
+		void Dynamic()
+		{
+			static constexpr unsigned char order[19] = { 16,17,18,0,8,7,9,6,10,5,11,4,12,3,13,2,14,1,15 };
+			const int nLit = int( Bits( 5 ) ) + 257;
+			const int nDist = int( Bits( 5 ) ) + 1;
+			const int nCode = int( Bits( 4 ) ) + 4;
+			if( nLit > 286 || nDist > 30 )
+			{
+				throw PngError( L"bad dynamic block counts" );
+			}
+			unsigned char lengths[288 + 30] = {};
+			for( int i = 0; i < nCode; i++ )
+			{
+				lengths[order[i]] = (unsigned char)Bits( 3 );
+			}
+			Huffman lenCode;
+			Build( lenCode,lengths,19 );
+			int i = 0;
+			while( i < nLit + nDist )
+			{
+				int sym = Decode( lenCode );
+				if( sym < 16 )
+				{
+					lengths[i++] = (unsigned char)sym;
+					continue;
+				}
+				unsigned char repeated = 0;
+				int n;
+				if( sym == 16 )
+				{
+					if( i == 0 )
+					{
+						throw PngError( L"bad code length repeat" );
+					}
+					repeated = lengths[i - 1];
+					n = 3 + int( Bits( 2 ) );
+				}
+				else if( sym == 17 )
+				{
+					n = 3 + int( Bits( 3 ) );
+				}
+				else
+				{
+					n = 11 + int( Bits( 7 ) );
+				}
+				if( i + n > nLit + nDist )
+				{
+					throw PngError( L"bad code length repeat" );
+				}
+				while( n-- > 0 )
+				{
+					lengths[i++] = repeated;
+				}
+			}
+			Huffman lit;
+			Huffman dist;
+			Build( lit,lengths,nLit );
+			Build( dist,lengths + nLit,nDist );
+			Codes( lit,dist );
+		}
+		void Codes( const Huffman& lit,const Huffman& dist )
+		{
+			static constexpr unsigned short lenBase[29] = {
+				3,4,5,6,7,8,9,10,11,13,15,17,19,23,27,31,35,43,51,59,67,83,99,115,131,163,195,227,258 };
+			static constexpr unsigned char lenExtra[29] = {
+				0,0,0,0,0,0,0,0,1,1,1,1,2,2,2,2,3,3,3,3,4,4,4,4,5,5,5,5,0 };
+			static constexpr unsigned short distBase[30] = {
+				1,2,3,4,5,7,9,13,17,25,33,49,65,97,129,193,257,385,513,769,
+				1025,1537,2049,3073,4097,6145,8193,12289,16385,24577 };
+			static constexpr unsigned char distExtra[30] = {
+				0,0,0,0,1,1,2,2,3,3,4,4,5,5,6,6,7,7,8,8,9,9,10,10,11,11,12,12,13,13 };
+			for( ;; )
+			{
+				int sym = Decode( lit );
+				if( sym < 256 )
+				{
+					out.push_back( (unsigned char)sym );
+				}
+				else if( sym == 256 )
+				{
+					return;
+				}
+				else
+				{
+					sym -= 257;
+					if( sym >= 29 )
+					{
+						throw PngError( L"bad length symbol" );
+					}
+					const size_t len = lenBase[sym] + Bits( lenExtra[sym] );
+					const int dsym = Decode( dist );
+					if( dsym >= 30 )
+					{
+						throw PngError( L"bad distance symbol" );
+					}
+					const size_t d = distBase[dsym] + Bits( distExtra[dsym] );
+					if( d > out.size() )
+					{
+						throw PngError( L"distance too far back" );
+					}
+					// copy byte by byte, the source may overlap what is being written
+					for( size_t i = 0; i < len; i++ )
+					{
+						out.push_back( out[out.size() - d] );
+					}
+				}
+			}
+		}
+	private:
+		const std::vector<unsigned char>& src;
+		std::vector<unsigned char>& out;
+		size_t pos = 0;
+		unsigned int bitBuf = 0;
+		int bitCount = 0;
+	};
+
+	unsigned char Paeth( int a,int b,int c )
+	{
+		const int p = a + b - c;
+		const int pa = std::abs( p - a );
+		const int pb = std::abs( p - b );
+		const int pc = std::abs( p - c );
+		if( pa <= pb && pa <= pc )
+		{
+			return (unsigned char)a;
+		}
+		return (unsigned char)(pb <= pc ? b : c);
+	}
+
+	// decodes the png in file to argb pixels
+	std::vector<Color> DecodePng( std::ifstream& file,unsigned int& width,unsigned int& height )
+	{
+		const std::vector<unsigned char> data( (std::istreambuf_iterator<char>( file )),std::istreambuf_iterator<char>() );
+		static constexpr unsigned char signature[8] = { 137,80,78,71,13,10,26,10 };
+		if( data.size() < 8 || !std::equal( signature,signature + 8,data.begin() ) )
+		{
+			throw PngError( L"not a png file" );
+		}
+		int bitDepth = 0;
+		int colorType = -1;
+		std::vector<unsigned char> idat;
+		std::vector<Color> palette;
+		for( size_t pos = 8; pos + 12 <= data.size(); )
+		{
+			const size_t len = ReadBE32( &data[pos] );
+			if( pos + 12 + len > data.size() )
+			{
+				throw PngError( L"truncated chunk" );
+			}
+			const unsigned char* type = &data[pos + 4];
+			const unsigned char* body = &data[pos + 8];
+			if( std::equal( type,type + 4,"IHDR" ) )
+			{
+				width = ReadBE32( body );
+				height = ReadBE32( body + 4 );
+				bitDepth = body[8];
+				colorType = body[9];
+				if( body[12] != 0 )
+				{
+					throw PngError( L"interlaced png not supported" );
+				}
+			}
+			else if( std::equal( type,type + 4,"PLTE" ) )
+			{
+				for( size_t i = 0; i + 3 <= len; i += 3 )
+				{
+					palette.emplace_back( 255u,body[i],body[i + 1],body[i + 2] );
+				}
+			}
+			else if( std::equal( type,type + 4,"tRNS" ) )
+			{
+				for( size_t i = 0; i < len && i < palette.size(); i++ )
+				{
+					palette[i] = Color( Color( palette[i].dword & 0xFFFFFFu ),body[i] );
+				}
+			}
+			else if( std::equal( type,type + 4,"IDAT" ) )
+			{
+				idat.insert( idat.end(),body,body + len );
+			}
+			else if( std::equal( type,type + 4,"IEND" ) )
+			{
+				break;
+			}
+			pos += 12 + len;
+		}
+
+		int channels;
+		switch( colorType )
+		{
+		case 0: channels = 1; break;
+		case 2: channels = 3; break;
+		case 3: channels = 1; break;
+		case 4: channels = 2; break;
+		case 6: channels = 4; break;
+		default: throw PngError( L"missing or bad IHDR" );
+		}
+		if( bitDepth != 8 )
+		{
+			throw PngError( L"only 8-bit png supported" );
+		}
+		if( width == 0 || height == 0 )
+		{
+			throw PngError( L"empty image" );
+		}
+
+		std::vector<unsigned char> raw;
+		raw.reserve( size_t( width * channels + 1 ) * height );
+		Inflater( idat,raw ).Run();
+		const size_t stride = size_t( width ) * channels;
+		if( raw.size() < (stride + 1) * height )
+		{
+			throw PngError( L"not enough image data" );
+		}
+
+		// undo the per-scanline filters in place
+		for( size_t y = 0; y < height; y++ )
+		{
+			unsigned char* line = &raw[y * (stride + 1) + 1];
+			const unsigned char* prev = y > 0 ? &raw[(y - 1) * (stride + 1) + 1] : nullptr;
+			const int filter = line[-1];
+			for( size_t i = 0; i < stride; i++ )
+			{
+				const int a = i >= size_t( channels ) ? line[i - channels] : 0;
+				const int b = prev ? prev[i] : 0;
+				const int c = prev && i >= size_t( channels ) ? prev[i - channels] : 0;
+				switch( filter )
+				{
+				case 0: break;
+				case 1: line[i] += (unsigned char)a; break;
+				case 2: line[i] += (unsigned char)b; break;
+				case 3: line[i] += (unsigned char)((a + b) / 2); break;
+				case 4: line[i] += Paeth( a,b,c ); break;
+				default: throw PngError( L"bad scanline filter" );
+				}
+			}
+		}
+
+		std::vector<Color> pixels( size_t( width ) * height );
+		for( size_t y = 0; y < height; y++ )
+		{
+			const unsigned char* line = &raw[y * (stride + 1) + 1];
+			for( size_t x = 0; x < width; x++ )
+			{
+				const unsigned char* p = &line[x * channels];
+				Color c;
+				switch( colorType )
+				{
+				case 0: c = Color( 255u,p[0],p[0],p[0] ); break;
+				case 2: c = Color( 255u,p[0],p[1],p[2] ); break;
+				case 3:
+					if( p[0] >= palette.size() )
+					{
+						throw PngError( L"palette index out of range" );
+					}
+					c = palette[p[0]];
+					break;
+				case 4: c = Color( p[1],p[0],p[0],p[0] ); break;
+				case 6: c = Color( p[3],p[0],p[1],p[2] ); break;
+				}
+				pixels[y * width + x] = c;
+			}
+		}
+		return pixels;
+	}
+}
+
+Surface Surface::FromFile( const std::wstring & name )
+{
+	std::ifstream file( NarrowPath( name ),std::ios::binary );
+	if( !file )
+	{
+		std::wstringstream ss;
+		ss << L"Loading image [" << name << L"]: failed to load.";
+		throw Exception( CHILI_WIDE( __FILE__ ),__LINE__,ss.str() );
+	}
+	unsigned int width = 0;
+	unsigned int height = 0;
+	std::vector<Color> pixels;
+	try
+	{
+		pixels = DecodePng( file,width,height );
+	}
+	catch( const PngError& e )
+	{
+		std::wstringstream ss;
+		ss << L"Loading image [" << name << L"]: " << e.msg << L".";
+		throw Exception( CHILI_WIDE( __FILE__ ),__LINE__,ss.str() );
+	}
+
+	auto pBuffer = std::make_unique<Color[]>( width * height );
+	std::copy( pixels.begin(),pixels.end(),pBuffer.get() );
+	return Surface( width,height,width,std::move( pBuffer ) );
+}
+
+void Surface::Save( const std::wstring & filename ) const
+{
+	std::ofstream file( NarrowPath( filename ),std::ios::binary );
+	if( !file )
+	{
+		std::wstringstream ss;
+		ss << L"Saving surface to [" << filename << L"]: failed to open file.";
+		throw Exception( CHILI_WIDE( __FILE__ ),__LINE__,ss.str() );
+	}
+	// little endian header fields
+	auto put = [&file]( uint32_t v,int bytes )
+	{
+		for( int i = 0; i < bytes; i++ )
+		{
+			file.put( char( (v >> (8 * i)) & 0xFFu ) );
+		}
+	};
+	const uint32_t imageSize = width * height * sizeof( Color );
+	const uint32_t headerSize = 14u + 40u;
+	// file header
+	file.put( 'B' );
+	file.put( 'M' );
+	put( headerSize + imageSize,4 );
+	put( 0u,4 );
+	put( headerSize,4 );
+	// info header (negative height: rows are stored top-down)
+	put( 40u,4 );
+	put( width,4 );
+	put( uint32_t( -int32_t( height ) ),4 );
+	put( 1u,2 );
+	put( 32u,2 );
+	put( 0u,4 );
+	put( imageSize,4 );
+	put( 2835u,4 );
+	put( 2835u,4 );
+	put( 0u,4 );
+	put( 0u,4 );
+	// pixels are bgra in memory, which is what a 32-bit bmp wants
+	for( unsigned int y = 0; y < height; y++ )
+	{
+		file.write( reinterpret_cast<const char*>( &pBuffer[y * pitch] ),std::streamsize( width * sizeof( Color ) ) );
+	}
+	if( !file )
+	{
+		std::wstringstream ss;
+		ss << L"Saving surface to [" << filename << L"]: failed to save.";
+		throw Exception( CHILI_WIDE( __FILE__ ),__LINE__,ss.str() );
+	}
+}
+#endif
\ No newline at end of file
@@ -17,7 +17,7 @@ public:
 		vertices[1].pos = { 0.8f,-0.8f,0.0f };
 		vertices[2].pos = { -0.8f,-0.8f,0.0f };
 
-		std::vector<size_t> indices;
+		IndexBuffer indices;
 		indices.reserve( 3 );
 		indices.push_back( 0 );
 		indices.push_back( 1 );
@@ -1,10 +1,14 @@
 #pragma once
 
 #include "Pipeline.h"
-#include "DefaultVertexShader.h"
+#include "Interpolant.h"
+#include "BaseVertexShader.h"
 #include "DefaultGeometryShader.h"
+#include "Sampler.h"
 
 // basic texture effect
+// filter picks how the texture is read, as for VertexLightTexturedEffect (only trilinear shades in quads)
+template<TextureFilter filter = TextureFilter::Point>
 class TextureEffect
 {
 public:
@@ -27,55 +31,48 @@ public:
 			t( t ),
 			pos( pos )
 		{}
-		Vertex& operator+=( const Vertex& rhs )
-		{
-			pos += rhs.pos;
-			t += rhs.t;
-			return *this;
-		}
-		Vertex operator+( const Vertex& rhs ) const
-		{
-			return Vertex( *this ) += rhs;
-		}
-		Vertex& operator-=( const Vertex& rhs )
-		{
-			pos -= rhs.pos;
-			t -= rhs.t;
-			return *this;
-		}
-		Vertex operator-( const Vertex& rhs ) const
-		{
-			return Vertex( *this ) -= rhs;
-		}
-		Vertex& operator*=( float rhs )
-		{
-			pos *= rhs;
-			t *= rhs;
-			return *this;
-		}
-		Vertex operator*( float rhs ) const
-		{
-			return Vertex( *this ) *= rhs;
-		}
-		Vertex& operator/=( float rhs )
-		{
-			pos /= rhs;
-			t /= rhs;
-			return *this;
-		}
-		Vertex operator/( float rhs ) const
+	public:
+		Vec3 pos;
+		Vec2 t;
+	};
+	// clip space position and the tex coord
+	class VSOutput : public Interpolant<VSOutput>
+	{
+	public:
+		VSOutput() = default;
+		VSOutput( const Vec4& pos )
+			:
+			pos( pos )
+		{}
+		VSOutput( const Vec4& pos,const VSOutput& src )
+			:
+			t( src.t ),
+			pos( pos )
+		{}
+		VSOutput( const Vec4& pos,const Vec2& t )
+			:
+			t( t ),
+			pos( pos )
+		{}
+		static constexpr auto Attributes()
 		{
-			return Vertex( *this ) /= rhs;
+			return std::make_tuple( &VSOutput::t );
 		}
 	public:
-		Vec3 pos;
+		Vec4 pos;
 		Vec2 t;
 	};
-	// default vs rotates and translates vertices
-	// does not touch attributes
-	typedef DefaultVertexShader<Vertex> VertexShader;
+	// transforms the position, passes the tex coord through
+	class VertexShader : public BaseVertexShader<VSOutput>
+	{
+	public:
+		typename BaseVertexShader<VSOutput>::Output operator()( const Vertex& v ) const
+		{
+			return{ Vec4( v.pos ) * this->worldViewProj,v.t };
+		}
+	};
 	// default gs passes vertices through and outputs triangle
-	typedef DefaultGeometryShader<VertexShader::Output> GeometryShader;
+	typedef DefaultGeometryShader<typename VertexShader::Output> GeometryShader;
 	// invoked for each pixel of a triangle
 	// takes an input of attributes that are the
 	// result of interpolating vertex attributes
@@ -84,27 +81,34 @@ public:
 	{
 	public:
 		template<class Input>
-		Color operator()( const Input& in ) const
+		Color operator()( const Input& in ) const requires( filter != TextureFilter::Trilinear )
+		{
+			return Color( sampler.Sample( in.t ) * 255.0f );
+		}
+		// shades a 2x2 quad, the change in texture coordinates across it picks the mip level
+		template<class Input>
+		void operator()( const PixelQuad<Input>& in,Color* out ) const requires( filter == TextureFilter::Trilinear )
 		{
-			return pTex->GetPixel(
-				(unsigned int)std::min( in.t.x * tex_width + 0.5f,tex_xclamp ),
-				(unsigned int)std::min( in.t.y * tex_height + 0.5f,tex_yclamp )
-			);
+			const float lod = sampler.ComputeLod( in.Ddx( &Input::t ),in.Ddy( &Input::t ) );
+			Vec3 colors[4];
+			sampler.Sample( in,&Input::t,lod,colors );
+			for( int i = 0; i < 4; i++ )
+			{
+				if( in.IsLive( i ) )
+				{
+					out[i] = Color( colors[i] * 255.0f );
+				}
+			}
 		}
 		void BindTexture( const std::wstring& filename )
 		{
-			pTex = std::make_unique<Surface>( Surface::FromFile( filename ) );
-			tex_width = float( pTex->GetWidth() );
-			tex_height = float( pTex->GetHeight() );
-			tex_xclamp = tex_width - 1.0f;
-			tex_yclamp = tex_height - 1.0f;
+			pTex = std::make_unique<MipTexture>( MipTexture::FromFile( filename ) );
+			sampler = TextureSampler( *pTex );
 		}
 	private:
-		std::unique_ptr<Surface> pTex;
-		float tex_width;
-		float tex_height;
-		float tex_xclamp;
-		float tex_yclamp;
+		typedef Sampler<TextureAddress::Clamp,filter> TextureSampler;
+		std::unique_ptr<MipTexture> pTex;
+		TextureSampler sampler;
 	};
 public:
 	VertexShader vs;
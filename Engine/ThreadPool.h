@@ -0,0 +1,119 @@
+#pragma once
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <vector>
+#include <algorithm>
+
+// fixed set of worker threads for fork-join style parallel loops
+// the calling thread also takes part in the loop, so a pool with
+// n workers runs n + 1 iterations at a time
+class ThreadPool
+{
+public:
+	ThreadPool()
+		:
+		ThreadPool( std::max( std::thread::hardware_concurrency(),1u ) - 1u )
+	{}
+	ThreadPool( size_t nWorkers )
+	{
+		workers.reserve( nWorkers );
+		for( size_t i = 0; i < nWorkers; i++ )
+		{
+			workers.emplace_back( &ThreadPool::WorkerLoop,this );
+		}
+	}
+	~ThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock( mtx );
+			stopping = true;
+		}
+		cvWork.notify_all();
+		for( auto& w : workers )
+		{
+			w.join();
+		}
+	}
+	ThreadPool( const ThreadPool& ) = delete;
+	ThreadPool& operator=( const ThreadPool& ) = delete;
+	// invokes func( i ) for every i in [0,count) and returns when all calls are done
+	// iterations are handed out dynamically, so no ordering between them is guaranteed
+	template<class F>
+	void ParallelFor( size_t count,F&& func )
+	{
+		if( workers.empty() || count < 2 )
+		{
+			for( size_t i = 0; i < count; i++ )
+			{
+				func( i );
+			}
+			return;
+		}
+		// type-erase the functor without allocating (it lives on our stack until we return)
+		using Fn = std::remove_reference_t<F>;
+		{
+			std::lock_guard<std::mutex> lock( mtx );
+			pJobContext = const_cast<void*>( static_cast<const void*>( &func ) );
+			pJobThunk = []( void* pContext,size_t i ) { (*static_cast<Fn*>( pContext ))( i ); };
+			jobCount = count;
+			nextIndex = 0;
+			nBusy = workers.size();
+			generation++;
+		}
+		cvWork.notify_all();
+		RunJob();
+		// wait until every worker has checked in for this generation
+		std::unique_lock<std::mutex> lock( mtx );
+		cvDone.wait( lock,[this] { return nBusy == 0; } );
+	}
+	size_t GetWorkerCount() const
+	{
+		return workers.size();
+	}
+private:
+	void RunJob()
+	{
+		for( size_t i = nextIndex++; i < jobCount; i = nextIndex++ )
+		{
+			pJobThunk( pJobContext,i );
+		}
+	}
+	void WorkerLoop()
+	{
+		size_t seenGeneration = 0;
+		while( true )
+		{
+			{
+				std::unique_lock<std::mutex> lock( mtx );
+				cvWork.wait( lock,[&] { return stopping || generation != seenGeneration; } );
+				if( stopping )
+				{
+					return;
+				}
+				seenGeneration = generation;
+			}
+			RunJob();
+			{
+				std::lock_guard<std::mutex> lock( mtx );
+				nBusy--;
+			}
+			cvDone.notify_one();
+		}
+	}
+private:
+	std::vector<std::thread> workers;
+	std::mutex mtx;
+	std::condition_variable cvWork;
+	std::condition_variable cvDone;
+	// current job (guarded by mtx when published, read-only while running)
+	void( *pJobThunk )(void*,size_t) = nullptr;
+	void* pJobContext = nullptr;
+	size_t jobCount = 0;
+	std::atomic<size_t> nextIndex = 0;
+	size_t nBusy = 0;
+	size_t generation = 0;
+	bool stopping = false;
+};
\ No newline at end of file
@@ -62,12 +62,7 @@ public:
 	{
 		return _Vec2( -x,-y );
 	}
-	_Vec2&	operator=( const _Vec2 &rhs )
-	{
-		x = rhs.x;
-		y = rhs.y;
-		return *this;
-	}
+	_Vec2&	operator=( const _Vec2 &rhs ) = default;
 	_Vec2&	operator+=( const _Vec2 &rhs )
 	{
 		x += rhs.x;
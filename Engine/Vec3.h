@@ -65,13 +65,7 @@ public:
 	{
 		return _Vec3( -this->x,-this->y,-z );
 	}
-	_Vec3&	operator=( const _Vec3 &rhs )
-	{
-		this->x = rhs.x;
-		this->y = rhs.y;
-		z = rhs.z;
-		return *this;
-	}
+	_Vec3&	operator=( const _Vec3 &rhs ) = default;
 	_Vec3&	operator+=( const _Vec3 &rhs )
 	{
 		this->x += rhs.x;
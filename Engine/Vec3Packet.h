@@ -0,0 +1,139 @@
+#pragma once
+
+#include "FloatPacket.h"
+#include "Vec3.h"
+#include "Colors.h"
+
+// FloatPacket::size 3d vectors in SoA form
+// mirrors the Vec3 interface (* is dot product) so shading code reads the same
+class Vec3Packet
+{
+public:
+	Vec3Packet() = default;
+	Vec3Packet( const FloatPacket& x,const FloatPacket& y,const FloatPacket& z )
+		:
+		x( x ),
+		y( y ),
+		z( z )
+	{}
+	// same vector in every lane
+	Vec3Packet( const Vec3& v )
+		:
+		x( v.x ),
+		y( v.y ),
+		z( v.z )
+	{}
+	// one vector per lane from an array of FloatPacket::size vectors
+	static Vec3Packet Gather( const Vec3* pVecs )
+	{
+		return {
+			{ pVecs[0].x,pVecs[1].x,pVecs[2].x,pVecs[3].x },
+			{ pVecs[0].y,pVecs[1].y,pVecs[2].y,pVecs[3].y },
+			{ pVecs[0].z,pVecs[1].z,pVecs[2].z,pVecs[3].z }
+		};
+	}
+	// one vector per lane from a member of an array of FloatPacket::size structs
+	template<class S>
+	static Vec3Packet Gather( const S* pStructs,Vec3 S::* pMember )
+	{
+		return {
+			{ (pStructs[0].*pMember).x,(pStructs[1].*pMember).x,(pStructs[2].*pMember).x,(pStructs[3].*pMember).x },
+			{ (pStructs[0].*pMember).y,(pStructs[1].*pMember).y,(pStructs[2].*pMember).y,(pStructs[3].*pMember).y },
+			{ (pStructs[0].*pMember).z,(pStructs[1].*pMember).z,(pStructs[2].*pMember).z,(pStructs[3].*pMember).z }
+		};
+	}
+	FloatPacket	LenSq() const
+	{
+		return *this * *this;
+	}
+	FloatPacket	Len() const
+	{
+		return sqrt( LenSq() );
+	}
+	Vec3Packet&	Normalize()
+	{
+		return *this /= Len();
+	}
+	Vec3Packet	GetNormalized() const
+	{
+		return Vec3Packet( *this ).Normalize();
+	}
+	Vec3Packet	operator-() const
+	{
+		return { -x,-y,-z };
+	}
+	Vec3Packet&	operator+=( const Vec3Packet& rhs )
+	{
+		x += rhs.x;
+		y += rhs.y;
+		z += rhs.z;
+		return *this;
+	}
+	Vec3Packet&	operator-=( const Vec3Packet& rhs )
+	{
+		x -= rhs.x;
+		y -= rhs.y;
+		z -= rhs.z;
+		return *this;
+	}
+	FloatPacket	operator*( const Vec3Packet& rhs ) const
+	{
+		return x * rhs.x + y * rhs.y + z * rhs.z;
+	}
+	Vec3Packet	operator+( const Vec3Packet& rhs ) const
+	{
+		return Vec3Packet( *this ) += rhs;
+	}
+	Vec3Packet	operator-( const Vec3Packet& rhs ) const
+	{
+		return Vec3Packet( *this ) -= rhs;
+	}
+	Vec3Packet&	operator*=( const FloatPacket& rhs )
+	{
+		x *= rhs;
+		y *= rhs;
+		z *= rhs;
+		return *this;
+	}
+	Vec3Packet	operator*( const FloatPacket& rhs ) const
+	{
+		return Vec3Packet( *this ) *= rhs;
+	}
+	Vec3Packet&	operator/=( const FloatPacket& rhs )
+	{
+		x /= rhs;
+		y /= rhs;
+		z /= rhs;
+		return *this;
+	}
+	Vec3Packet	operator/( const FloatPacket& rhs ) const
+	{
+		return Vec3Packet( *this ) /= rhs;
+	}
+	// clamp to between 0.0 ~ 1.0
+	Vec3Packet&	Saturate()
+	{
+		x = min( 1.0f,max( 0.0f,x ) );
+		y = min( 1.0f,max( 0.0f,y ) );
+		z = min( 1.0f,max( 0.0f,z ) );
+		return *this;
+	}
+	// x3 = x1 * x2 etc.
+	Vec3Packet	GetHadamard( const Vec3Packet& rhs ) const
+	{
+		return { x * rhs.x,y * rhs.y,z * rhs.z };
+	}
+	// converts 0-255 rgb lanes to colors (truncating, same as Color( const Vec3& ))
+	void StoreColors( Color* pOut ) const
+	{
+		const __m128i r = _mm_cvttps_epi32( x.v );
+		const __m128i g = _mm_cvttps_epi32( y.v );
+		const __m128i b = _mm_cvttps_epi32( z.v );
+		const __m128i rgb = _mm_or_si128( _mm_or_si128( _mm_slli_epi32( r,16 ),_mm_slli_epi32( g,8 ) ),b );
+		_mm_storeu_si128( reinterpret_cast<__m128i*>( pOut ),rgb );
+	}
+public:
+	FloatPacket x;
+	FloatPacket y;
+	FloatPacket z;
+};
\ No newline at end of file
@@ -70,14 +70,7 @@ public:
 	{
 		return _Vec4( -this->x,-this->y,-this->z,-w );
 	}
-	_Vec4&	operator=( const _Vec4 &rhs )
-	{
-		this->x = rhs.x;
-		this->y = rhs.y;
-		this->z = rhs.z;
-		w = rhs.w;
-		return *this;
-	}
+	_Vec4&	operator=( const _Vec4 &rhs ) = default;
 	_Vec4&	operator+=( const _Vec4 &rhs )
 	{
 		this->x += rhs.x;
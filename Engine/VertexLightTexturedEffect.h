@@ -1,13 +1,18 @@
 #pragma once
 
 #include "Pipeline.h"
+#include "Interpolant.h"
 #include "BaseVertexShader.h"
 #include "DefaultGeometryShader.h"
 #include "BasePhongShader.h"
+#include "Sampler.h"
 
 
 // flat shading with vertex normals
-template<class Diffuse>
+// filter picks how the texture is read: point and bilinear shade pixel by pixel from the full
+// size texture, trilinear shades 2x2 quads so it can pick mip levels (worth it for surfaces
+// seen far off or at grazing angles, pure cost on ones close up)
+template<class Diffuse,TextureFilter filter = TextureFilter::Point>
 class VertexLightTexturedEffect
 {
 public:
@@ -37,7 +42,7 @@ public:
 	};
 	// vertex shader
 	// output interpolates position, light, and tex coord
-	class VSOutput
+	class VSOutput : public Interpolant<VSOutput>
 	{
 	public:
 		VSOutput() = default;
@@ -57,49 +62,9 @@ public:
 			pos( pos ),
 			l( l )
 		{}
-		VSOutput& operator+=( const VSOutput& rhs )
+		static constexpr auto Attributes()
 		{
-			pos += rhs.pos;
-			t += rhs.t;
-			l += rhs.l;
-			return *this;
-		}
-		VSOutput operator+( const VSOutput& rhs ) const
-		{
-			return VSOutput( *this ) += rhs;
-		}
-		VSOutput& operator-=( const VSOutput& rhs )
-		{
-			pos -= rhs.pos;
-			t -= rhs.t;
-			l -= rhs.l;
-			return *this;
-		}
-		VSOutput operator-( const VSOutput& rhs ) const
-		{
-			return VSOutput( *this ) -= rhs;
-		}
-		VSOutput& operator*=( float rhs )
-		{
-			pos *= rhs;
-			t *= rhs;
-			l *= rhs;
-			return *this;
-		}
-		VSOutput operator*( float rhs ) const
-		{
-			return VSOutput( *this ) *= rhs;
-		}
-		VSOutput& operator/=( float rhs )
-		{
-			pos /= rhs;
-			t /= rhs;
-			l /= rhs;
-			return *this;
-		}
-		VSOutput operator/( float rhs ) const
-		{
-			return VSOutput( *this ) /= rhs;
+			return std::make_tuple( &VSOutput::t,&VSOutput::l );
 		}
 	public:
 		Vec4 pos;
@@ -155,24 +120,32 @@ public:
 	{
 	public:
 		template<class Input>
-		Color operator()( const Input& in ) const
+		Color operator()( const Input& in ) const requires( filter != TextureFilter::Trilinear )
+		{
+			return Color( sampler.Sample( in.t ).GetHadamard( in.l ).GetSaturated() * 255.0f );
+		}
+		// shades a 2x2 quad, the change in texture coordinates across it picks the mip level
+		template<class Input>
+		void operator()( const PixelQuad<Input>& in,Color* out ) const requires( filter == TextureFilter::Trilinear )
 		{
-			const auto material_color = Vec3( pTex->GetPixel(
-				static_cast<unsigned int>( in.t.x * tex_width  + 0.5f ) % tex_width,
-				static_cast<unsigned int>( in.t.y * tex_height + 0.5f ) % tex_width
-			) ) / 255.0f;
-			return Color( material_color.GetHadamard( in.l ).GetSaturated() * 255.0f );
+			const float lod = sampler.ComputeLod( in.Ddx( &Input::t ),in.Ddy( &Input::t ) );
+			Vec3 material_colors[4];
+			sampler.Sample( in,&Input::t,lod,material_colors );
+			for( int i = 0; i < 4; i++ )
+			{
+				if( in.IsLive( i ) )
+				{
+					out[i] = Color( material_colors[i].GetHadamard( in.lanes[i].l ).GetSaturated() * 255.0f );
+				}
+			}
 		}
-		void BindTexture( const Surface& tex )
+		void BindTexture( const MipTexture& tex )
 		{
-			pTex = &tex;
-			tex_width = pTex->GetWidth();
-			tex_height = pTex->GetHeight();
+			sampler = TextureSampler( tex );
 		}
 	private:
-		const Surface* pTex = nullptr;
-		unsigned int tex_width;
-		unsigned int tex_height;
+		typedef Sampler<TextureAddress::Wrap,filter> TextureSampler;
+		TextureSampler sampler;
 	};
 public:
 	VertexShader vs;
@@ -12,18 +12,18 @@
 class VertexWaveScene : public Scene
 {
 public:
-	typedef Pipeline<WaveVertexTextureEffect> Pipeline;
+	typedef ::Pipeline<WaveVertexTextureEffect> Pipeline;
 	typedef Pipeline::Vertex Vertex;
 public:
 	VertexWaveScene( Graphics& gfx )
 		:
+		Scene( "Test Plane Rippling VS" ),
 		itlist( Plane::GetSkinned<Vertex>( 20 ) ),
-		pipeline( gfx ),
-		Scene( "Test Plane Rippling VS" )
+		pipeline( gfx )
 	{
-		pipeline.effect.ps.BindTexture( L"images\\sauron-bhole-100x100.png" );
+		pipeline.effect.ps.BindTexture( L"Images\\sauron-bhole-100x100.png" );
 	}
-	virtual void Update( Keyboard& kbd,Mouse& mouse,float dt ) override
+	virtual void Update( Keyboard& kbd,Mouse&,float dt ) override
 	{
 		if( kbd.KeyIsPressed( 'Q' ) )
 		{
@@ -88,27 +88,32 @@ public:
 		pipeline.BeginFrame();
 		// generate rotation matrix from euler angles
 		// translation from offset
-		const Mat3 rot =
-			Mat3::RotationX( theta_x ) *
-			Mat3::RotationY( theta_y ) *
-			Mat3::RotationZ( theta_z );
+		const Mat4 rot =
+			Mat4::RotationX( theta_x ) *
+			Mat4::RotationY( theta_y ) *
+			Mat4::RotationZ( theta_z );
 		const Mat3 rot_phi =
 			Mat3::RotationX( phi_x ) *
 			Mat3::RotationY( phi_y ) *
 			Mat3::RotationZ( phi_z );
-		const Vec3 trans = { 0.0f,0.0f,offset_z };
 		// set pipeline transform
-		pipeline.effect.vs.BindRotation( rot );
-		pipeline.effect.vs.BindTranslation( trans );
+		pipeline.effect.vs.BindWorldView( rot * Mat4::Translation( 0.0f,0.0f,offset_z ) );
+		pipeline.effect.vs.BindProjection( Mat4::ProjectionHFOV( hfov,aspect_ratio,0.5f,4.0f ) );
 		pipeline.effect.vs.SetTime( time );
 		pipeline.effect.gs.SetLightDirection( light_dir * rot_phi );
 		// render triangles
 		pipeline.Draw( itlist );
 	}
+	virtual PipelineStats GetPipelineStats() const override
+	{
+		return pipeline.GetStats();
+	}
 private:
 	IndexedTriangleList<Vertex> itlist;
 	Pipeline pipeline;
 	static constexpr float dTheta = PI;
+	static constexpr float aspect_ratio = 1.33333f;
+	static constexpr float hfov = 100.0f;
 	float offset_z = 2.0f;
 	float theta_x = 0.0f;
 	float theta_y = 0.0f;
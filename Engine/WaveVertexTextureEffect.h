@@ -1,7 +1,9 @@
 #pragma once
 
 #include "Pipeline.h"
-#include "DefaultGeometryShader.h"
+#include "Interpolant.h"
+#include "BaseVertexShader.h"
+#include "Sampler.h"
 
 class WaveVertexTextureEffect
 {
@@ -24,78 +26,57 @@ public:
 			t( t ),
 			pos( pos )
 		{}
-		Vertex& operator+=( const Vertex& rhs )
-		{
-			pos += rhs.pos;
-			t += rhs.t;
-			return *this;
-		}
-		Vertex operator+( const Vertex& rhs ) const
-		{
-			return Vertex( *this ) += rhs;
-		}
-		Vertex& operator-=( const Vertex& rhs )
-		{
-			pos -= rhs.pos;
-			t -= rhs.t;
-			return *this;
-		}
-		Vertex operator-( const Vertex& rhs ) const
-		{
-			return Vertex( *this ) -= rhs;
-		}
-		Vertex& operator*=( float rhs )
-		{
-			pos *= rhs;
-			t *= rhs;
-			return *this;
-		}
-		Vertex operator*( float rhs ) const
-		{
-			return Vertex( *this ) *= rhs;
-		}
-		Vertex& operator/=( float rhs )
-		{
-			pos /= rhs;
-			t /= rhs;
-			return *this;
-		}
-		Vertex operator/( float rhs ) const
+	public:
+		Vec3 pos;
+		Vec2 t;
+	};
+	// clip space position and tex coord, plus the view space position
+	// the geometry shader takes the face normal from (not interpolated)
+	class VSOutput : public Interpolant<VSOutput>
+	{
+	public:
+		VSOutput() = default;
+		VSOutput( const Vec4& pos )
+			:
+			pos( pos )
+		{}
+		VSOutput( const Vec4& pos,const VSOutput& src )
+			:
+			t( src.t ),
+			viewPos( src.viewPos ),
+			pos( pos )
+		{}
+		VSOutput( const Vec4& pos,const Vec2& t,const Vec3& viewPos )
+			:
+			t( t ),
+			viewPos( viewPos ),
+			pos( pos )
+		{}
+		static constexpr auto Attributes()
 		{
-			return Vertex( *this ) /= rhs;
+			return std::make_tuple( &VSOutput::t );
 		}
 	public:
-		Vec3 pos;
+		Vec4 pos;
 		Vec2 t;
+		Vec3 viewPos;
 	};
 	// perturbes vertices in y axis in sin wave based on
 	// x position and time
-	class VertexShader
+	class VertexShader : public BaseVertexShader<VSOutput>
 	{
 	public:
-		typedef Vertex Output;
-	public:
-		void BindRotation( const Mat3& rotation_in )
-		{
-			rotation = rotation_in;
-		}
-		void BindTranslation( const Vec3& translation_in )
-		{
-			translation = translation_in;
-		}
 		Output operator()( const Vertex& in ) const
 		{
-			Vec3 pos = in.pos * rotation + translation;
+			Vec4 pos = Vec4( in.pos ) * worldView;
 			pos.y += amplitude * std::sin( time * freqScroll + pos.x * freqWave );
-			return{ pos,in.t };
+			return{ pos * proj,in.t,Vec3( pos ) };
 		}
 		void SetTime( float t )
 		{
 			time = t;
 		}
 	private:
-		Mat3 rotation;
-		Vec3 translation;
 		float time = 0.0f;
 		float freqWave = 10.0f;
 		float freqScroll = 5.0f;
@@ -106,68 +87,32 @@ public:
 	class GeometryShader
 	{
 	public:
-		class Output
+		class Output : public Interpolant<Output>
 		{
 		public:
 			Output() = default;
-			Output( const Vec3& pos )
+			Output( const Vec4& pos )
 				:
 				pos( pos )
 			{}
-			Output( const Vec3& pos,const Output& src )
+			Output( const Vec4& pos,const Output& src )
 				:
 				t( src.t ),
 				l( src.l ),
 				pos( pos )
 			{}
-			Output( const Vec3& pos,const Vec2& t,float l )
+			Output( const Vec4& pos,const Vec2& t,float l )
 				:
 				t( t ),
 				l( l ),
 				pos( pos )
 			{}
-			Output& operator+=( const Output& rhs )
-			{
-				pos += rhs.pos;
-				t += rhs.t;
-				return *this;
-			}
-			Output operator+( const Output& rhs ) const
-			{
-				return Output( *this ) += rhs;
-			}
-			Output& operator-=( const Output& rhs )
-			{
-				pos -= rhs.pos;
-				t -= rhs.t;
-				return *this;
-			}
-			Output operator-( const Output& rhs ) const
-			{
-				return Output( *this ) -= rhs;
-			}
-			Output& operator*=( float rhs )
-			{
-				pos *= rhs;
-				t *= rhs;
-				return *this;
-			}
-			Output operator*( float rhs ) const
-			{
-				return Output( *this ) *= rhs;
-			}
-			Output& operator/=( float rhs )
-			{
-				pos /= rhs;
-				t /= rhs;
-				return *this;
-			}
-			Output operator/( float rhs ) const
+			static constexpr auto Attributes()
 			{
-				return Output( *this ) /= rhs;
+				return std::make_tuple( &Output::t );
 			}
 		public:
-			Vec3 pos;
+			Vec4 pos;
 			Vec2 t;
 			float l;
 		};
@@ -175,7 +120,7 @@ public:
 		Triangle<Output> operator()( const VertexShader::Output& in0,const VertexShader::Output& in1,const VertexShader::Output& in2,size_t triangle_index ) const
 		{
 			// calculate face normal
-			const auto n = ((in1.pos - in0.pos) % (in2.pos - in0.pos)).GetNormalized();
+			const auto n = ((in1.viewPos - in0.viewPos) % (in2.viewPos - in0.viewPos)).GetNormalized();
 			// calculate intensity based on angle of incidence plus ambient and saturate
 			const auto l = std::min( 1.0f,diffuse * std::max( 0.0f,-n * dir ) + ambient );
 			return{ { in0.pos,in0.t,l },{ in1.pos,in1.t,l },{ in2.pos,in2.t,l } };
@@ -194,8 +139,6 @@ public:
 			dir = dl.GetNormalized();
 		}
 	private:
-		Mat3 rotation;
-		Vec3 translation;
 		// direction of travel of light rays
 		Vec3 dir = { 0.0f,0.0f,1.0f };
 		// this is the intensity if direct light from source
@@ -213,28 +156,20 @@ public:
 		Color operator()( const Input& in ) const
 		{
 			// lookup color in texture
-			const Vec3 color = Vec3( pTex->GetPixel(
-				(unsigned int)std::min( in.t.x * tex_width + 0.5f,tex_xclamp ),
-				(unsigned int)std::min( in.t.y * tex_height + 0.5f,tex_yclamp )
-			) );
+			const Vec3 color = sampler.Sample( in.t ) * 255.0f;
 			// use texture color as material to determine ratio / magnitude
 			// of the different color components diffuse reflected from triangle at this pt.
 			return Color( color * in.l );
 		}
 		void BindTexture( const std::wstring& filename )
 		{
-			pTex = std::make_unique<Surface>( Surface::FromFile( filename ) );
-			tex_width = float( pTex->GetWidth() );
-			tex_height = float( pTex->GetHeight() );
-			tex_xclamp = tex_width - 1.0f;
-			tex_yclamp = tex_height - 1.0f;
+			pTex = std::make_unique<MipTexture>( MipTexture::FromFile( filename ) );
+			sampler = TextureSampler( *pTex );
 		}
 	private:
-		std::unique_ptr<Surface> pTex;
-		float tex_width;
-		float tex_height;
-		float tex_xclamp;
-		float tex_yclamp;
+		typedef Sampler<TextureAddress::Clamp,TextureFilter::Point> TextureSampler;
+		std::unique_ptr<MipTexture> pTex;
+		TextureSampler sampler;
 	};
 public:
 	VertexShader vs;
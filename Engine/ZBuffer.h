@@ -3,15 +3,31 @@
 #include <limits>
 #include <cassert>
 #include <algorithm>
+#include <vector>
+#include <cstdint>
 
+// depth buffer with a hierarchical z level on top
+// the hi-z level stores, for each tileSize x tileSize tile, an upper bound on the
+// depths in that tile so that rasterizers can reject whole blocks / spans of a
+// triangle that are behind everything already drawn there
+// next to it, an occluder level holds the same kind of bound for the depths the tile will
+// have once the frame's occluders are drawn (masked occlusion culling, see AddOccluder),
+// so whole draws behind them can be skipped before they are even vertex shaded
 class ZBuffer
 {
+public:
+	static constexpr int tileSize = 8;
 public:
 	ZBuffer( int width,int height )
 		:
 		width( width ),
 		height( height ),
-		pBuffer( new float[width*height] )
+		pBuffer( new float[width*height] ),
+		tilesX( (width + tileSize - 1) / tileSize ),
+		tilesY( (height + tileSize - 1) / tileSize ),
+		tileMax( tilesX * tilesY,std::numeric_limits<float>::infinity() ),
+		tileStale( tilesX * tilesY ),
+		occluderTiles( tilesX * tilesY )
 	{}
 	~ZBuffer()
 	{
@@ -27,7 +43,12 @@ public:
 		{
 			pBuffer[i] = std::numeric_limits<float>::infinity();
 		}
+		std::fill( tileMax.begin(),tileMax.end(),std::numeric_limits<float>::infinity() );
+		std::fill( tileStale.begin(),tileStale.end(),(unsigned char)0 );
+		std::fill( occluderTiles.begin(),occluderTiles.end(),OccluderTile{} );
 	}
+	// note: writing through At bypasses the hi-z level, only ever write a depth
+	// that is nearer than the one already there (or Clear afterwards)
 	float& At( int x,int y )
 	{
 		assert( x >= 0 );
@@ -45,11 +66,89 @@ public:
 		float& depthInBuffer = At( x,y );
 		if( depth < depthInBuffer )
 		{
+			// if we just overwrote the farthest depth of the tile, its max is now too far
+			// (which is still a valid bound); flag it to be tightened when next queried
+			const int iTile = (y / tileSize) * tilesX + x / tileSize;
+			if( depthInBuffer >= tileMax[iTile] )
+			{
+				tileStale[iTile] = 1;
+			}
 			depthInBuffer = depth;
 			return true;
 		}
 		return false;
 	}
+	// depth test that passes only the depth already in the buffer, and leaves it as is
+	// (for shading after a depth prepass has put the final depths in)
+	bool TestEqual( int x,int y,float depth ) const
+	{
+		return depth == At( x,y );
+	}
+	// hi-z test for the tile containing pixel x,y
+	// returns true if nothing at nearestDepth or farther can pass TestAndSet anywhere
+	// in the tile, i.e. the caller can skip all of its pixels in that tile
+	// (only one thread may touch a given tile at a time, same as for TestAndSet)
+	bool TileRejects( int x,int y,float nearestDepth )
+	{
+		return nearestDepth >= TileMax( x,y );
+	}
+	// hi-z test for TestEqual, the tile's farthest depth itself can still pass
+	bool TileRejectsEqual( int x,int y,float nearestDepth )
+	{
+		return nearestDepth > TileMax( x,y );
+	}
+	// adds an occluder triangle's coverage of tile tx,ty, a mask of its pixels (bit
+	// (y % tileSize) * tileSize + x % tileSize) that will end up at maxDepth or nearer
+	// coverage is gathered in a working layer until it covers the whole tile, then its
+	// farthest depth becomes the tile's occluder depth (if nearer than the one it has)
+	void AddOccluder( int tx,int ty,uint64_t mask,float maxDepth )
+	{
+		OccluderTile& tile = occluderTiles[ty * tilesX + tx];
+		if( maxDepth >= tile.depth || mask == 0u )
+		{
+			return;
+		}
+		tile.workingDepth = tile.workingMask == 0u ? maxDepth : std::max( tile.workingDepth,maxDepth );
+		tile.workingMask |= mask;
+		const uint64_t full = GetTileMask( tx,ty );
+		if( (tile.workingMask & full) == full )
+		{
+			tile.depth = tile.workingDepth;
+			tile.workingMask = 0u;
+		}
+	}
+	// true if nothing at nearestDepth or farther can end up visible anywhere in the pixel
+	// rect x0,y0 - x1,y1 (inclusive, on screen), going by the occluders and the hi-z level
+	// (not while a frame's rasterization is running on other threads)
+	bool RectOccluded( int x0,int y0,int x1,int y1,float nearestDepth )
+	{
+		for( int ty = y0 / tileSize; ty <= y1 / tileSize; ty++ )
+		{
+			for( int tx = x0 / tileSize; tx <= x1 / tileSize; tx++ )
+			{
+				// strictly behind, an occluder drawn later can't hide a pixel at its own depth
+				const float bound = std::min( occluderTiles[ty * tilesX + tx].depth,TileMax( tx * tileSize,ty * tileSize ) );
+				if( nearestDepth <= bound )
+				{
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+	// bits of the pixels of tile tx,ty that are on the screen
+	uint64_t GetTileMask( int tx,int ty ) const
+	{
+		const int w = std::min( width - tx * tileSize,tileSize );
+		const int h = std::min( height - ty * tileSize,tileSize );
+		const uint64_t row = (uint64_t( 1 ) << w) - 1u;
+		uint64_t mask = 0u;
+		for( int y = 0; y < h; y++ )
+		{
+			mask |= row << (y * tileSize);
+		}
+		return mask;
+	}
 	int GetWidth() const
 	{
 		return width;
@@ -62,8 +161,55 @@ public:
 	{
 		return std::minmax_element( pBuffer,pBuffer + width * height );
 	}
+private:
+	// max depth of the tile containing pixel x,y (tightened first if it went stale)
+	float TileMax( int x,int y )
+	{
+		assert( x >= 0 );
+		assert( x < width );
+		assert( y >= 0 );
+		assert( y < height );
+		const int tx = x / tileSize;
+		const int ty = y / tileSize;
+		const int iTile = ty * tilesX + tx;
+		if( tileStale[iTile] )
+		{
+			// recompute the tile's true max depth
+			const int xEnd = std::min( (tx + 1) * tileSize,width );
+			const int yEnd = std::min( (ty + 1) * tileSize,height );
+			float maxDepth = -std::numeric_limits<float>::infinity();
+			for( int yt = ty * tileSize; yt < yEnd; yt++ )
+			{
+				const float* pRow = &pBuffer[yt * width];
+				for( int xt = tx * tileSize; xt < xEnd; xt++ )
+				{
+					maxDepth = std::max( maxDepth,pRow[xt] );
+				}
+			}
+			tileMax[iTile] = maxDepth;
+			tileStale[iTile] = 0;
+		}
+		return tileMax[iTile];
+	}
 private:
 	int width;
 	int height;
 	float* pBuffer = nullptr;
+	// hi-z level: max depth per tile, and whether that max needs recomputing
+	// (a stale max is always >= the true max, so it is still safe to test against)
+	int tilesX;
+	int tilesY;
+	std::vector<float> tileMax;
+	std::vector<unsigned char> tileStale;
+	// occluder level
+	struct OccluderTile
+	{
+		// every pixel of the tile ends up at this depth or nearer
+		float depth = std::numeric_limits<float>::infinity();
+		// coverage gathered towards the next depth, and its farthest depth
+		uint64_t workingMask = 0u;
+		float workingDepth = 0.0f;
+	};
+	static_assert( tileSize * tileSize == 64,"occluder coverage masks are 64 bit" );
+	std::vector<OccluderTile> occluderTiles;
 };
\ No newline at end of file